@@ -28,6 +28,25 @@ namespace rocket {
 
 static Config* g_config = NULL;
 
+// 读取可选的整型子节点，节点不存在时保留默认值
+static void readOptionalInt(TiXmlElement* parent, const char* name, int& value) {
+  TiXmlElement* node = parent->FirstChildElement(name);
+  if (node && node->GetText()) {
+    value = std::atoi(node->GetText());
+  }
+}
+
+static void readCodelConfig(TiXmlElement* node, CodelConfig& config) {
+  int enable = config.enable ? 1 : 0;
+  int lifo = config.lifo ? 1 : 0;
+  readOptionalInt(node, "enable", enable);
+  readOptionalInt(node, "target_ms", config.target_ms);
+  readOptionalInt(node, "interval_ms", config.interval_ms);
+  readOptionalInt(node, "lifo", lifo);
+  config.enable = (enable != 0);
+  config.lifo = (lifo != 0);
+}
+
 
 Config* Config::GetGlobalConfig() {
   return g_config;
@@ -90,6 +109,11 @@ Config::Config(const char* xmlfile) {
   io_threads_ = std::atoi(io_threads_str.c_str());
 
 
+  TiXmlElement* client_id_node = root_node->FirstChildElement("client_id");
+  if (client_id_node && client_id_node->GetText()) {
+    client_id_ = std::string(client_id_node->GetText());
+  }
+
   TiXmlElement* stubs_node = root_node->FirstChildElement("stubs");
 
   if (stubs_node) {
@@ -145,6 +169,187 @@ Config::Config(const char* xmlfile) {
 		etcd_config_.password = etcd_password;
 	}
 
+  TiXmlElement* outlier_node = root_node->FirstChildElement("outlier_detection");
+  if (outlier_node) {
+    int enable = outlier_config_.enable ? 1 : 0;
+    readOptionalInt(outlier_node, "enable", enable);
+    outlier_config_.enable = (enable != 0);
+    readOptionalInt(outlier_node, "window_ms", outlier_config_.window_ms);
+    readOptionalInt(outlier_node, "min_requests", outlier_config_.min_requests);
+    readOptionalInt(outlier_node, "error_rate_percent", outlier_config_.error_rate_percent);
+    readOptionalInt(outlier_node, "timeout_rate_percent", outlier_config_.timeout_rate_percent);
+    readOptionalInt(outlier_node, "latency_factor", outlier_config_.latency_factor);
+    readOptionalInt(outlier_node, "base_eject_ms", outlier_config_.base_eject_ms);
+    readOptionalInt(outlier_node, "max_eject_ms", outlier_config_.max_eject_ms);
+  }
+
+  TiXmlElement* limit_node = root_node->FirstChildElement("concurrency_limit");
+  if (limit_node) {
+    ConcurrencyLimitConfig& limit = concurrency_limit_config_;
+    int enable = limit.enable ? 1 : 0;
+    readOptionalInt(limit_node, "enable", enable);
+    limit.enable = (enable != 0);
+    readOptionalInt(limit_node, "initial_limit", limit.initial_limit);
+    readOptionalInt(limit_node, "min_limit", limit.min_limit);
+    readOptionalInt(limit_node, "max_limit", limit.max_limit);
+    readOptionalInt(limit_node, "rtt_tolerance_percent", limit.rtt_tolerance_percent);
+    readOptionalInt(limit_node, "backoff_percent", limit.backoff_percent);
+    readOptionalInt(limit_node, "min_rtt_window_ms", limit.min_rtt_window_ms);
+    readOptionalInt(limit_node, "max_queue_wait_ms", limit.max_queue_wait_ms);
+  }
+
+  TiXmlElement* scheduler_node = root_node->FirstChildElement("scheduler");
+  if (scheduler_node) {
+    SchedulerConfig& scheduler = scheduler_config_;
+    readOptionalInt(scheduler_node, "max_pending", scheduler.max_pending);
+    readOptionalInt(scheduler_node, "dispatch_batch", scheduler.dispatch_batch);
+    readOptionalInt(scheduler_node, "weight_high", scheduler.weight_high);
+    readOptionalInt(scheduler_node, "weight_normal", scheduler.weight_normal);
+    readOptionalInt(scheduler_node, "weight_low", scheduler.weight_low);
+    readOptionalInt(scheduler_node, "fair_quantum", scheduler.fair_quantum);
+    readOptionalInt(scheduler_node, "max_inflight_per_caller", scheduler.max_inflight_per_caller);
+  }
+
+  TiXmlElement* admission_node = root_node->FirstChildElement("admission");
+  if (admission_node) {
+    AdmissionConfig& admission = admission_config_;
+    readOptionalInt(admission_node, "max_connections", admission.max_connections);
+    readOptionalInt(admission_node, "max_connections_per_thread", admission.max_connections_per_thread);
+    readOptionalInt(admission_node, "max_inflight", admission.max_inflight);
+    readOptionalInt(admission_node, "max_inflight_per_connection", admission.max_inflight_per_connection);
+    readOptionalInt(admission_node, "max_pending_bytes", admission.max_pending_bytes);
+  }
+
+  TiXmlElement* stream_node = root_node->FirstChildElement("stream");
+  if (stream_node) {
+    readOptionalInt(stream_node, "window", stream_config_.window);
+  }
+
+  TiXmlElement* arena_node = root_node->FirstChildElement("arena");
+  if (arena_node) {
+    readOptionalInt(arena_node, "initial_block", arena_config_.initial_block);
+  }
+
+  TiXmlElement* pool_node = root_node->FirstChildElement("pool");
+  if (pool_node) {
+    readOptionalInt(pool_node, "max_per_thread", pool_config_.max_per_thread);
+  }
+
+  TiXmlElement* response_cache_node = root_node->FirstChildElement("response_cache");
+  if (response_cache_node) {
+    readOptionalInt(response_cache_node, "max_bytes", response_cache_config_.max_bytes);
+    readOptionalInt(response_cache_node, "shards", response_cache_config_.shards);
+    for (TiXmlElement* method_node = response_cache_node->FirstChildElement("method");
+         method_node != NULL; method_node = method_node->NextSiblingElement("method")) {
+      TiXmlElement* name_node = method_node->FirstChildElement("name");
+      if (!name_node || !name_node->GetText()) {
+        continue;
+      }
+      int ttl_ms = 0;
+      readOptionalInt(method_node, "ttl_ms", ttl_ms);
+      if (ttl_ms > 0) {
+        response_cache_config_.method_ttl_ms[std::string(name_node->GetText())] = ttl_ms;
+      }
+    }
+  }
+
+  TiXmlElement* single_flight_node = root_node->FirstChildElement("singleflight");
+  if (single_flight_node) {
+    for (TiXmlElement* method_node = single_flight_node->FirstChildElement("method");
+         method_node != NULL; method_node = method_node->NextSiblingElement("method")) {
+      if (method_node->GetText()) {
+        single_flight_config_.methods.insert(std::string(method_node->GetText()));
+      }
+    }
+  }
+
+  TiXmlElement* client_cache_node = root_node->FirstChildElement("client_cache");
+  if (client_cache_node) {
+    readOptionalInt(client_cache_node, "max_bytes", client_cache_config_.max_bytes);
+    for (TiXmlElement* method_node = client_cache_node->FirstChildElement("method");
+         method_node != NULL; method_node = method_node->NextSiblingElement("method")) {
+      TiXmlElement* name_node = method_node->FirstChildElement("name");
+      if (!name_node || !name_node->GetText()) {
+        continue;
+      }
+      ClientCacheMethod method;
+      readOptionalInt(method_node, "ttl_ms", method.ttl_ms);
+      readOptionalInt(method_node, "stale_ms", method.stale_ms);
+      if (method.ttl_ms > 0) {
+        client_cache_config_.methods[std::string(name_node->GetText())] = method;
+      }
+    }
+  }
+
+  TiXmlElement* protocol_node = root_node->FirstChildElement("protocol");
+  if (protocol_node) {
+    int hello = protocol_config_.hello ? 1 : 0;
+    int method_id = protocol_config_.method_id ? 1 : 0;
+    readOptionalInt(protocol_node, "max_version", protocol_config_.max_version);
+    readOptionalInt(protocol_node, "hello", hello);
+    readOptionalInt(protocol_node, "max_frame_size", protocol_config_.max_frame_size);
+    readOptionalInt(protocol_node, "method_id", method_id);
+    protocol_config_.hello = (hello != 0);
+    protocol_config_.method_id = (method_id != 0);
+  }
+
+  TiXmlElement* checksum_node = root_node->FirstChildElement("checksum");
+  if (checksum_node) {
+    int enable = checksum_config_.enable ? 1 : 0;
+    int verify = checksum_config_.verify ? 1 : 0;
+    int skip_loopback = checksum_config_.skip_loopback ? 1 : 0;
+    readOptionalInt(checksum_node, "enable", enable);
+    readOptionalInt(checksum_node, "verify", verify);
+    readOptionalInt(checksum_node, "skip_loopback", skip_loopback);
+    checksum_config_.enable = (enable != 0);
+    checksum_config_.verify = (verify != 0);
+    checksum_config_.skip_loopback = (skip_loopback != 0);
+  }
+
+  TiXmlElement* compress_node = root_node->FirstChildElement("compress");
+  if (compress_node) {
+    int enable = compress_config_.enable ? 1 : 0;
+    readOptionalInt(compress_node, "enable", enable);
+    compress_config_.enable = (enable != 0);
+    readOptionalInt(compress_node, "threshold", compress_config_.threshold);
+    readOptionalInt(compress_node, "zlib_level", compress_config_.zlib_level);
+    // 逗号分隔的算法名，按优先级排列
+    TiXmlElement* codecs_node = compress_node->FirstChildElement("codecs");
+    if (codecs_node && codecs_node->GetText()) {
+      compress_config_.codecs.clear();
+      std::string codecs = codecs_node->GetText();
+      size_t begin = 0;
+      while (begin <= codecs.length()) {
+        size_t end = codecs.find(',', begin);
+        if (end == std::string::npos) {
+          end = codecs.length();
+        }
+        std::string name = codecs.substr(begin, end - begin);
+        name.erase(0, name.find_first_not_of(" \t\n"));
+        name.erase(name.find_last_not_of(" \t\n") + 1);
+        if (!name.empty()) {
+          compress_config_.codecs.push_back(name);
+        }
+        begin = end + 1;
+      }
+    }
+  }
+
+  TiXmlElement* codel_node = root_node->FirstChildElement("codel");
+  if (codel_node) {
+    readCodelConfig(codel_node, codel_config_);
+    for (TiXmlElement* service_node = codel_node->FirstChildElement("service");
+         service_node != NULL; service_node = service_node->NextSiblingElement("service")) {
+      TiXmlElement* name_node = service_node->FirstChildElement("name");
+      if (!name_node || !name_node->GetText()) {
+        continue;
+      }
+      // 未配置的字段沿用默认配置
+      CodelConfig service_config = codel_config_;
+      readCodelConfig(service_node, service_config);
+      service_codel_config_[std::string(name_node->GetText())] = service_config;
+    }
+  }
 
   printf("Server -- PORT[%d], IO Threads[%d]\n", port_, io_threads_);
 
@@ -3,6 +3,9 @@
 
 #include <asio/ip/tcp.hpp>
 #include <map>
+#include <set>
+#include <string>
+#include <vector>
 #include <tinyxml/tinyxml.h>
 
 namespace rocket {
@@ -22,6 +25,120 @@ struct ServiceConfig {
   int port{0};       // 服务端口
 };
 
+// 客户端按节点做异常检测(熔断)的配置
+struct OutlierDetectionConfig {
+  bool enable{true};
+  int window_ms{10000};          // 统计窗口长度
+  int min_requests{20};          // 窗口内请求数少于该值时不做判定
+  int error_rate_percent{50};    // 错误率阈值
+  int timeout_rate_percent{30};  // 超时率阈值
+  int latency_factor{3};         // 平均延迟超过同组节点中位数的倍数即视为异常
+  int base_eject_ms{5000};       // 首次驱逐时长，连续驱逐时指数退避
+  int max_eject_ms{60000};       // 驱逐时长上限
+};
+
+// 客户端按节点的自适应并发限制(AIMD)配置
+struct ConcurrencyLimitConfig {
+  bool enable{true};
+  int initial_limit{64};          // 初始并发上限
+  int min_limit{4};
+  int max_limit{1024};
+  int rtt_tolerance_percent{200}; // RTT 超过最小 RTT 的该百分比视为拥塞
+  int backoff_percent{90};        // 拥塞时上限乘以该百分比
+  int min_rtt_window_ms{10000};   // 最小 RTT 的统计周期，周期结束后重新探测
+  int max_queue_wait_ms{0};       // 超过上限时排队等待的最长时间，0 表示直接失败
+};
+
+// 服务端请求调度配置，每个 IO 线程维护一个待分发队列
+struct SchedulerConfig {
+  int max_pending{4096};     // 每个 IO 线程排队请求数上限，超过后优先丢弃低优先级请求
+  int dispatch_batch{32};    // 每轮最多分发的请求数，之后让出 IO 线程处理新到达的请求
+  int weight_high{8};        // critical 严格优先，其余优先级按权重加权轮询
+  int weight_normal{4};
+  int weight_low{1};
+  int fair_quantum{16};              // 同一优先级内按调用方 DRR 调度，每轮额度，单位 KB
+  int max_inflight_per_caller{0};    // 每个调用方正在处理的请求数上限，0 表示不限制
+};
+
+// 服务端准入控制配置，0 表示不限制
+struct AdmissionConfig {
+  int max_connections{0};              // 全局连接数上限
+  int max_connections_per_thread{0};   // 每个 IO 线程的连接数上限
+  int max_inflight{0};                 // 正在处理(排队+执行)的请求数上限
+  int max_inflight_per_connection{0};  // 每个连接正在处理的请求数上限
+  int max_pending_bytes{0};            // 正在处理的请求占用的字节数上限
+};
+
+// 服务端按排队时延丢弃请求(CoDel)，排队时延在一个 interval 内始终高于 target 时进入过载状态
+struct CodelConfig {
+  bool enable{false};
+  int target_ms{5};       // 可接受的排队时延
+  int interval_ms{100};   // 统计最小排队时延的周期
+  bool lifo{false};       // 过载时改为后到先服务，让新请求尽快得到处理
+};
+
+// 流式调用配置
+struct StreamConfig {
+  int window{32};   // 接收窗口，对端最多可以连续发送的消息数，读取过半后补充额度
+};
+
+// 报文压缩配置，可用的算法按连接协商，双方都开启并且都支持时才压缩
+struct CompressConfig {
+  bool enable{false};
+  std::vector<std::string> codecs{"lz4", "zlib"};  // 发送时按顺序选择对端支持的第一个
+  int threshold{1024};   // pb_data 小于该字节数时不压缩
+  int zlib_level{1};
+};
+
+// 报文格式配置
+struct ProtocolConfig {
+  int max_version{2};   // 支持的最高报文版本，双方都支持 v2 时使用紧凑的 v2 格式，设为 1 时只使用 v1
+  bool hello{true};     // 客户端连接建立时发送握手帧协商报文版本、压缩算法等特性
+  int max_frame_size{16 * 1024 * 1024};  // 可以接收的最大报文，超过时丢弃，0 表示不限制
+  bool method_id{true}; // 服务端在握手中声明支持时，请求只携带 4 字节的方法 id 而不携带方法名
+};
+
+// 报文校验配置，校验和为 CRC32C
+struct ChecksumConfig {
+  bool enable{true};          // 发送时计算校验和，关闭时按旧版本写入固定值
+  bool verify{true};          // 接收时校验，对端没有计算校验和的报文不校验
+  bool skip_loopback{true};   // 本机回环连接不校验
+};
+
+// 服务端请求内存配置，每个请求的消息从 protobuf Arena 分配
+struct ArenaConfig {
+  int initial_block{8192};   // 每个线程复用的 Arena 初始内存块字节数，0 表示不复用
+};
+
+// 对象池配置，TinyPBProtocol、RpcController 等热路径对象按线程复用
+struct PoolConfig {
+  int max_per_thread{1024};   // 每个线程每种对象最多缓存的个数，0 表示不缓存
+};
+
+// 服务端响应缓存，只对配置了 TTL 的幂等方法生效
+struct ResponseCacheConfig {
+  int max_bytes{64 * 1024 * 1024};   // 所有缓存项(请求 + 响应)占用的字节数上限，0 表示关闭
+  int shards{16};                    // 分片数，每个分片独立加锁和淘汰
+  std::map<std::string, int> method_ttl_ms;   // 方法全名(如 Order.makeOrder) -> TTL(ms)
+};
+
+// 客户端合并相同的在途调用(singleflight)，只对列出的幂等方法生效
+struct SingleFlightConfig {
+  std::set<std::string> methods;   // 方法全名，如 Order.makeOrder
+};
+
+// 客户端结果缓存中单个方法的配置
+struct ClientCacheMethod {
+  int ttl_ms{0};     // 结果在 ttl 内直接返回
+  int stale_ms{0};   // 过期后再过 stale_ms 仍先返回旧结果，同时在后台刷新
+};
+
+// 客户端结果缓存，只对配置了 ttl 的方法生效
+struct ClientCacheConfig {
+  int max_bytes{16 * 1024 * 1024};   // 所有缓存项(key + 响应)占用的字节数上限，0 表示关闭
+  std::map<std::string, ClientCacheMethod> methods;   // 方法全名 -> 配置
+};
+
 struct EtcdConfig {
   std::string ip;
   int port{0};
@@ -51,6 +168,8 @@ public:
   int port_{0};
   int io_threads_{0};
 
+  std::string client_id_;   // 作为客户端时携带的调用方标识，服务端据此做公平调度
+
   TiXmlDocument *xml_document_{NULL};
 
   // 客户端调用的下游服务配置(用于服务发现)
@@ -60,6 +179,35 @@ public:
   std::vector<ServiceConfig> provided_services_;
 
 	EtcdConfig etcd_config_;
+
+  OutlierDetectionConfig outlier_config_;
+
+  ConcurrencyLimitConfig concurrency_limit_config_;
+
+  SchedulerConfig scheduler_config_;
+
+  AdmissionConfig admission_config_;
+
+  CodelConfig codel_config_;                                 // 默认配置
+  std::map<std::string, CodelConfig> service_codel_config_;  // 按服务覆盖，key 为服务名
+
+  StreamConfig stream_config_;
+
+  CompressConfig compress_config_;
+
+  ChecksumConfig checksum_config_;
+
+  ProtocolConfig protocol_config_;
+
+  ArenaConfig arena_config_;
+
+  PoolConfig pool_config_;
+
+  ResponseCacheConfig response_cache_config_;
+
+  SingleFlightConfig single_flight_config_;
+
+  ClientCacheConfig client_cache_config_;
 };
 
 } // namespace rocket
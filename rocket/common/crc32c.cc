@@ -0,0 +1,139 @@
+#include <string.h>
+#include "rocket/common/crc32c.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <nmmintrin.h>
+#define ROCKET_CRC32C_X86 1
+#elif defined(__aarch64__) && defined(__ARM_FEATURE_CRC32)
+#include <arm_acle.h>
+#define ROCKET_CRC32C_ARM 1
+#endif
+
+namespace rocket {
+
+static const uint32_t kCrc32cPoly = 0x82f63b78;   // 反射后的 Castagnoli 多项式
+
+// slicing-by-8 查表，每次处理 8 个字节
+struct Crc32cTable {
+  uint32_t table[8][256];
+
+  Crc32cTable() {
+    for (uint32_t i = 0; i < 256; ++i) {
+      uint32_t crc = i;
+      for (int k = 0; k < 8; ++k) {
+        crc = (crc >> 1) ^ ((crc & 1) ? kCrc32cPoly : 0);
+      }
+      table[0][i] = crc;
+    }
+    for (uint32_t i = 0; i < 256; ++i) {
+      for (int k = 1; k < 8; ++k) {
+        table[k][i] = (table[k - 1][i] >> 8) ^ table[0][table[k - 1][i] & 0xff];
+      }
+    }
+  }
+};
+
+static uint32_t crc32cSoftware(uint32_t crc, const char* data, size_t len) {
+  static const Crc32cTable s_table;
+  const uint32_t (*t)[256] = s_table.table;
+  const uint8_t* p = reinterpret_cast<const uint8_t*>(data);
+
+  while (len >= 8) {
+    uint32_t lo;
+    uint32_t hi;
+    memcpy(&lo, p, sizeof(lo));
+    memcpy(&hi, p + 4, sizeof(hi));
+    lo ^= crc;
+    crc = t[7][lo & 0xff] ^ t[6][(lo >> 8) & 0xff] ^ t[5][(lo >> 16) & 0xff] ^ t[4][lo >> 24]
+        ^ t[3][hi & 0xff] ^ t[2][(hi >> 8) & 0xff] ^ t[1][(hi >> 16) & 0xff] ^ t[0][hi >> 24];
+    p += 8;
+    len -= 8;
+  }
+  while (len--) {
+    crc = (crc >> 8) ^ t[0][(crc ^ *p++) & 0xff];
+  }
+  return crc;
+}
+
+#if defined(ROCKET_CRC32C_X86)
+
+__attribute__((target("sse4.2")))
+static uint32_t crc32cHardware(uint32_t crc, const char* data, size_t len) {
+  const uint8_t* p = reinterpret_cast<const uint8_t*>(data);
+#if defined(__x86_64__)
+  uint64_t crc64 = crc;
+  while (len >= 8) {
+    uint64_t v;
+    memcpy(&v, p, sizeof(v));
+    crc64 = _mm_crc32_u64(crc64, v);
+    p += 8;
+    len -= 8;
+  }
+  crc = static_cast<uint32_t>(crc64);
+#endif
+  while (len >= 4) {
+    uint32_t v;
+    memcpy(&v, p, sizeof(v));
+    crc = _mm_crc32_u32(crc, v);
+    p += 4;
+    len -= 4;
+  }
+  while (len--) {
+    crc = _mm_crc32_u8(crc, *p++);
+  }
+  return crc;
+}
+
+bool crc32cHardwareSupported() {
+  static const bool s_supported = __builtin_cpu_supports("sse4.2");
+  return s_supported;
+}
+
+#elif defined(ROCKET_CRC32C_ARM)
+
+static uint32_t crc32cHardware(uint32_t crc, const char* data, size_t len) {
+  const uint8_t* p = reinterpret_cast<const uint8_t*>(data);
+  while (len >= 8) {
+    uint64_t v;
+    memcpy(&v, p, sizeof(v));
+    crc = __crc32cd(crc, v);
+    p += 8;
+    len -= 8;
+  }
+  while (len--) {
+    crc = __crc32cb(crc, *p++);
+  }
+  return crc;
+}
+
+bool crc32cHardwareSupported() {
+  return true;
+}
+
+#else
+
+static uint32_t crc32cHardware(uint32_t crc, const char* data, size_t len) {
+  return crc32cSoftware(crc, data, len);
+}
+
+bool crc32cHardwareSupported() {
+  return false;
+}
+
+#endif
+
+uint32_t crc32cExtend(uint32_t crc, const char* data, size_t len) {
+  typedef uint32_t (*Crc32cFunc)(uint32_t, const char*, size_t);
+  static const Crc32cFunc s_func = crc32cHardwareSupported() ? &crc32cHardware : &crc32cSoftware;
+  return ~s_func(~crc, data, len);
+}
+
+uint32_t crc32c(const char* data, size_t len) {
+  return crc32cExtend(0, data, len);
+}
+
+uint32_t crc32cPortable(const char* data, size_t len) {
+  return ~crc32cSoftware(~0u, data, len);
+}
+
+}
@@ -0,0 +1,23 @@
+#ifndef ROCKET_COMMON_CRC32C_H
+#define ROCKET_COMMON_CRC32C_H
+
+#include <cstddef>
+#include <cstdint>
+
+namespace rocket {
+
+// CRC32C(Castagnoli)，x86 支持 SSE4.2 时使用 crc32 指令，aarch64 编译时开启 crc 扩展时使用 crc32c 指令，
+// 否则使用查表实现。指令集在第一次调用时检测
+uint32_t crc32c(const char* data, size_t len);
+
+// 在已有结果上继续计算，用于分段数据
+uint32_t crc32cExtend(uint32_t crc, const char* data, size_t len);
+
+// 查表实现，用于对比测试
+uint32_t crc32cPortable(const char* data, size_t len);
+
+bool crc32cHardwareSupported();
+
+}
+
+#endif
@@ -22,6 +22,13 @@ const int ERROR_METHOD_NOT_FOUND = SYS_ERROR_PREFIX(0009);    // method 不存
 const int ERROR_PARSE_SERVICE_NAME = SYS_ERROR_PREFIX(0010);    // service name 解析失败
 const int ERROR_RPC_CHANNEL_INIT = SYS_ERROR_PREFIX(0011);    // rpc channel 初始化失败
 const int ERROR_RPC_PEER_ADDR = SYS_ERROR_PREFIX(0012);    // rpc 调用时候对端地址异常
+const int ERROR_RPC_CONCURRENCY_LIMIT = SYS_ERROR_PREFIX(0013);    // 超过节点并发上限，客户端拒绝发送
+const int ERROR_RPC_DEADLINE_EXCEEDED = SYS_ERROR_PREFIX(0014);    // 发起调用前上游 deadline 已经耗尽
+const int ERROR_RPC_SERVER_OVERLOAD = SYS_ERROR_PREFIX(0015);    // 服务端过载，请求被拒绝
+const int ERROR_RPC_BATCH_MISSING = SYS_ERROR_PREFIX(0016);    // 批量响应中缺少该调用的结果
+const int ERROR_RPC_STREAM_CLOSED = SYS_ERROR_PREFIX(0017);    // 流已关闭或被取消
+const int ERROR_RPC_STREAM_FLOW_CONTROL = SYS_ERROR_PREFIX(0018);    // 对端超过流控额度发送
+const int ERROR_RPC_CANCELED = SYS_ERROR_PREFIX(0019);    // 调用方主动取消，例如扇出调用已经拿到足够的结果
 
 
 #endif
\ No newline at end of file
@@ -0,0 +1,85 @@
+#include "rocket/common/metrics.h"
+#include <algorithm>
+
+namespace rocket {
+
+Histogram::Histogram(const std::vector<int64_t> &bounds)
+    : bounds_(bounds), buckets_(new std::atomic<int64_t>[bounds.size() + 1]) {
+  std::sort(bounds_.begin(), bounds_.end());
+  for (size_t i = 0; i <= bounds_.size(); ++i) {
+    buckets_[i].store(0, std::memory_order_relaxed);
+  }
+}
+
+void Histogram::observe(int64_t v) {
+  size_t i = std::lower_bound(bounds_.begin(), bounds_.end(), v) - bounds_.begin();
+  buckets_[i].fetch_add(1, std::memory_order_relaxed);
+  sum_.fetch_add(v, std::memory_order_relaxed);
+  count_.fetch_add(1, std::memory_order_relaxed);
+}
+
+void Histogram::dump(const std::string &name, std::stringstream &ss) const {
+  // name{a="b"} 拆成 name 和 a="b"，桶的 le 标签追加在已有标签之后
+  std::string base = name;
+  std::string labels;
+  size_t pos = name.find('{');
+  if (pos != std::string::npos && name.back() == '}') {
+    base = name.substr(0, pos);
+    labels = name.substr(pos + 1, name.length() - pos - 2) + ",";
+  }
+
+  int64_t cumulative = 0;
+  for (size_t i = 0; i <= bounds_.size(); ++i) {
+    cumulative += buckets_[i].load(std::memory_order_relaxed);
+    std::string le = i < bounds_.size() ? std::to_string(bounds_[i]) : "+Inf";
+    ss << base << "_bucket{" << labels << "le=\"" << le << "\"} " << cumulative << "\n";
+  }
+  std::string suffix = labels.empty() ? "" : "{" + labels.substr(0, labels.length() - 1) + "}";
+  ss << base << "_sum" << suffix << " " << sum_.load(std::memory_order_relaxed) << "\n";
+  ss << base << "_count" << suffix << " " << count_.load(std::memory_order_relaxed) << "\n";
+}
+
+Counter *MetricsRegistry::getCounter(const std::string &name) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto &counter = counters_[name];
+  if (!counter) {
+    counter = std::make_unique<Counter>();
+  }
+  return counter.get();
+}
+
+Gauge *MetricsRegistry::getGauge(const std::string &name) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto &gauge = gauges_[name];
+  if (!gauge) {
+    gauge = std::make_unique<Gauge>();
+  }
+  return gauge.get();
+}
+
+Histogram *MetricsRegistry::getHistogram(const std::string &name,
+                                         const std::vector<int64_t> &bounds) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto &histogram = histograms_[name];
+  if (!histogram) {
+    histogram = std::make_unique<Histogram>(bounds);
+  }
+  return histogram.get();
+}
+
+std::string MetricsRegistry::dump() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  std::stringstream ss;
+  for (auto &it : counters_) {
+    ss << it.first << " " << it.second->value() << "\n";
+  }
+  for (auto &it : gauges_) {
+    ss << it.first << " " << it.second->value() << "\n";
+  }
+  for (auto &it : histograms_) {
+    it.second->dump(it.first, ss);
+  }
+  return ss.str();
+}
+
+} // namespace rocket
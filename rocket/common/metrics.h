@@ -0,0 +1,95 @@
+#ifndef ROCKET_COMMON_METRICS_H
+#define ROCKET_COMMON_METRICS_H
+
+#include <atomic>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "rocket/common/singleton.h"
+
+namespace rocket {
+
+/**
+ * @brief 单调递增计数器
+ */
+class Counter {
+public:
+  void inc(int64_t n = 1) { value_.fetch_add(n, std::memory_order_relaxed); }
+
+  int64_t value() const { return value_.load(std::memory_order_relaxed); }
+
+private:
+  std::atomic<int64_t> value_{0};
+};
+
+/**
+ * @brief 可增可减的瞬时值
+ */
+class Gauge {
+public:
+  void set(int64_t v) { value_.store(v, std::memory_order_relaxed); }
+
+  void add(int64_t n) { value_.fetch_add(n, std::memory_order_relaxed); }
+
+  int64_t value() const { return value_.load(std::memory_order_relaxed); }
+
+private:
+  std::atomic<int64_t> value_{0};
+};
+
+/**
+ * @brief 直方图，桶边界在创建时确定，观测时只做原子加
+ */
+class Histogram {
+public:
+  explicit Histogram(const std::vector<int64_t> &bounds);
+
+  void observe(int64_t v);
+
+  // 以 prometheus 文本格式导出，name 可以带标签
+  void dump(const std::string &name, std::stringstream &ss) const;
+
+private:
+  std::vector<int64_t> bounds_;                          // 升序，不含 +Inf
+  std::unique_ptr<std::atomic<int64_t>[]> buckets_;      // 每个桶单独计数，导出时累加
+  std::atomic<int64_t> sum_{0};
+  std::atomic<int64_t> count_{0};
+};
+
+/**
+ * @brief 指标注册表
+ *
+ * 按名字创建并持有指标对象，返回的指针在进程生命周期内有效，
+ * 调用方通常用函数内 static 变量缓存指针，热路径上只做原子加减。
+ * 名字可以带 prometheus 风格的标签，如 name{peer="1.2.3.4:80"}
+ */
+class MetricsRegistry : public Singleton<MetricsRegistry> {
+public:
+  MetricsRegistry() = default;
+
+  Counter *getCounter(const std::string &name);
+
+  Gauge *getGauge(const std::string &name);
+
+  // 同名直方图只在第一次创建时使用 bounds
+  Histogram *getHistogram(const std::string &name,
+                          const std::vector<int64_t> &bounds);
+
+  // 以 prometheus 文本格式导出所有指标
+  std::string dump();
+
+private:
+  std::mutex mutex_;
+  std::map<std::string, std::unique_ptr<Counter>> counters_;
+  std::map<std::string, std::unique_ptr<Gauge>> gauges_;
+  std::map<std::string, std::unique_ptr<Histogram>> histograms_;
+};
+
+} // namespace rocket
+
+#endif
@@ -1,49 +1,38 @@
-#include <fcntl.h>
 #include <unistd.h>
-#include <sys/stat.h>
+#include <atomic>
+#include <chrono>
 #include "rocket/common/msg_id_util.h"
-#include "rocket/logger/log.h"
 
 namespace rocket {
 
 
-static int g_msg_id_length = 20;
-static int g_random_fd = -1;
-
-static thread_local std::string t_msg_id_no;
-static thread_local std::string t_max_msg_id_no;
+// 进程位由 pid 和启动时间混合得到，只计算一次，不同进程的请求号在日志中可以区分
+static uint64_t processBits() {
+  static uint64_t bits = []() {
+    uint64_t x = static_cast<uint64_t>(getpid()) ^ static_cast<uint64_t>(std::chrono::steady_clock::now().time_since_epoch().count());
+    // splitmix64
+    x += 0x9e3779b97f4a7c15ULL;
+    x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+    x ^= x >> 31;
+    return x & 0xffff000000000000ULL;
+  }();
+  return bits;
+}
 
-std::string MsgIDUtil::GenMsgID() {
-  if (t_msg_id_no.empty() || t_msg_id_no == t_max_msg_id_no) {
-    if (g_random_fd == -1) {
-      g_random_fd = open("/dev/urandom", O_RDONLY);
-    }
-    std::string res(g_msg_id_length, 0);
-    if ((read(g_random_fd, &res[0], g_msg_id_length)) != g_msg_id_length) {
-      ERRORLOG("read form /dev/urandom error");
-      return "";
-    }
-    for (int i = 0; i < g_msg_id_length; ++i) {
-      uint8_t x = ((uint8_t)(res[i])) % 10;
-      res[i] = x + '0';
-      t_max_msg_id_no += "9";
-    }
-    t_msg_id_no = res;
-  } else {
-    size_t i = t_msg_id_no.length() - 1;
-    while (t_msg_id_no[i] == '9' && i >= 0) {
-      i--;
-    }
-    if (i >= 0) {
-      t_msg_id_no[i] += 1;
-      for (size_t j = i + 1; j < t_msg_id_no.length(); ++j) {
-        t_msg_id_no[j] = '0';
-      }
-    }
-  }
+static std::atomic<uint32_t> g_thread_index {0};
 
-  return t_msg_id_no;
+static thread_local uint64_t t_prefix = 0;
+static thread_local uint32_t t_seq = 0;
 
+uint64_t MsgIDUtil::GenReqId() {
+  if (t_prefix == 0) {
+    // 线程位从 1 开始，保证请求号不为 0
+    uint64_t thread_bits = g_thread_index.fetch_add(1, std::memory_order_relaxed) % 0xffff + 1;
+    t_prefix = processBits() | (thread_bits << 32);
+  }
+  // 序号回绕时同一连接上仍在途的请求不可能有 2^32 个，不会冲突
+  return t_prefix | ++t_seq;
 }
 
 }
@@ -1,7 +1,7 @@
 #ifndef ROCKET_COMMON_MSGID_UTIL_H
 #define ROCKET_COMMON_MSGID_UTIL_H
 
-#include <string>
+#include <cstdint>
 
 
 namespace rocket {
@@ -9,11 +9,13 @@ namespace rocket {
 class MsgIDUtil {
 
  public:
-  static std::string GenMsgID();
+  // 生成 64 位请求号：[进程 16 位][线程 16 位][线程内序号 32 位]，不会返回 0
+  // 除进程内第一次调用外不需要系统调用和原子操作
+  static uint64_t GenReqId();
 
 };
 
 }
 
 
-#endif
\ No newline at end of file
+#endif
@@ -0,0 +1,36 @@
+#include "rocket/common/object_pool.h"
+#include "rocket/common/config.h"
+
+namespace rocket {
+
+size_t objectPoolCapacity() {
+  static size_t capacity = []() {
+    int max_per_thread = 1024;
+    if (Config::GetGlobalConfig()) {
+      max_per_thread = Config::GetGlobalConfig()->pool_config_.max_per_thread;
+    }
+    return static_cast<size_t>(max_per_thread > 0 ? max_per_thread : 0);
+  }();
+  return capacity;
+}
+
+PoolStats::PoolStats(const char* name) {
+  MetricsRegistry* registry = MetricsRegistry::GetInstance();
+  std::string label = std::string("{type=\"") + name + "\"}";
+  hit_counter_ = registry->getCounter("rocket_pool_hits_total" + label);
+  miss_counter_ = registry->getCounter("rocket_pool_misses_total" + label);
+}
+
+PoolStats::~PoolStats() {
+  flush();
+}
+
+void PoolStats::flush() {
+  hit_counter_->inc(hits_);
+  miss_counter_->inc(misses_);
+  hits_ = 0;
+  misses_ = 0;
+  pending_ = 0;
+}
+
+}
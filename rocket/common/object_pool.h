@@ -0,0 +1,231 @@
+#ifndef ROCKET_COMMON_OBJECT_POOL_H
+#define ROCKET_COMMON_OBJECT_POOL_H
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <vector>
+#include "rocket/common/metrics.h"
+
+namespace rocket {
+
+/**
+ * 使用 ObjectPool 的类型需要特化 PoolTraits，并且可以默认构造：
+ *   static const char* name();      // 统计标签
+ *   static void reset(T* obj);      // 归还时重置对象，应保留字符串等成员的容量
+ */
+template <typename T>
+struct PoolTraits;
+
+// 每个线程每种对象最多缓存的个数，由 <pool><max_per_thread> 配置，0 表示不缓存
+size_t objectPoolCapacity();
+
+/**
+ * @brief 对象池的命中/未命中统计
+ * 先在线程内累积，攒够一批或线程退出时再加到全局计数器上，避免热路径上的原子操作
+ */
+class PoolStats {
+public:
+  explicit PoolStats(const char* name);
+
+  ~PoolStats();
+
+  void hit() {
+    hits_++;
+    if (++pending_ >= kFlushInterval) {
+      flush();
+    }
+  }
+
+  void miss() {
+    misses_++;
+    if (++pending_ >= kFlushInterval) {
+      flush();
+    }
+  }
+
+private:
+  void flush();
+
+  static const int kFlushInterval = 256;
+
+  Counter* hit_counter_{nullptr};
+  Counter* miss_counter_{nullptr};
+  int64_t hits_{0};
+  int64_t misses_{0};
+  int pending_{0};
+};
+
+/**
+ * @brief 线程本地缓存，线程退出时销毁，销毁之后 get 返回 nullptr
+ * 对象可能在其他线程的 thread_local 析构过程中归还，所以不能直接使用 thread_local 对象
+ */
+template <typename L>
+class ThreadCache {
+public:
+  static L* get() {
+    if (t_cache == nullptr && !t_exited) {
+      static thread_local Cleaner cleaner;
+      (void)cleaner;
+      t_cache = new L();
+    }
+    return t_cache;
+  }
+
+private:
+  struct Cleaner {
+    ~Cleaner() {
+      L* cache = t_cache;
+      t_cache = nullptr;
+      t_exited = true;
+      delete cache;
+    }
+  };
+
+  static thread_local L* t_cache;
+  static thread_local bool t_exited;
+};
+
+template <typename L>
+thread_local L* ThreadCache<L>::t_cache = nullptr;
+
+template <typename L>
+thread_local bool ThreadCache<L>::t_exited = false;
+
+/**
+ * @brief 固定大小内存块的线程本地缓存，用于 shared_ptr 的控制块
+ */
+template <size_t Size>
+class BlockCache {
+public:
+  static void* allocate() {
+    Local* local = ThreadCache<Local>::get();
+    if (local && local->head) {
+      Node* node = local->head;
+      local->head = node->next;
+      local->count--;
+      return node;
+    }
+    return ::operator new(Size);
+  }
+
+  static void deallocate(void* p) {
+    Local* local = ThreadCache<Local>::get();
+    if (local && local->count < local->capacity) {
+      Node* node = static_cast<Node*>(p);
+      node->next = local->head;
+      local->head = node;
+      local->count++;
+      return;
+    }
+    ::operator delete(p);
+  }
+
+private:
+  struct Node {
+    Node* next;
+  };
+
+  static_assert(Size >= sizeof(Node), "block too small");
+
+  struct Local {
+    Node* head{nullptr};
+    size_t count{0};
+    size_t capacity{objectPoolCapacity()};
+
+    ~Local() {
+      while (head) {
+        Node* next = head->next;
+        ::operator delete(head);
+        head = next;
+      }
+    }
+  };
+};
+
+// 单个对象从 BlockCache 分配的 allocator，用于 shared_ptr 的控制块
+template <typename U>
+struct PoolAllocator {
+  typedef U value_type;
+
+  PoolAllocator() = default;
+
+  template <typename V>
+  PoolAllocator(const PoolAllocator<V>&) {}
+
+  U* allocate(size_t n) {
+    if (n == 1) {
+      return static_cast<U*>(BlockCache<sizeof(U)>::allocate());
+    }
+    return static_cast<U*>(::operator new(n * sizeof(U)));
+  }
+
+  void deallocate(U* p, size_t n) {
+    if (n == 1) {
+      BlockCache<sizeof(U)>::deallocate(p);
+      return;
+    }
+    ::operator delete(p);
+  }
+
+  template <typename V>
+  bool operator==(const PoolAllocator<V>&) const { return true; }
+
+  template <typename V>
+  bool operator!=(const PoolAllocator<V>&) const { return false; }
+};
+
+/**
+ * @brief 线程本地的对象池，无锁
+ *
+ * Get 优先从本线程缓存中取出对象，缓存为空时新建；最后一个引用释放时对象被重置并放回
+ * 释放所在线程的缓存，缓存已满时直接析构。shared_ptr 的控制块同样在线程内复用，
+ * 命中时整个过程不需要调用 malloc。
+ */
+template <typename T>
+class ObjectPool {
+public:
+  static std::shared_ptr<T> Get() {
+    Local* local = ThreadCache<Local>::get();
+    T* obj = nullptr;
+    if (local && !local->free.empty()) {
+      obj = local->free.back();
+      local->free.pop_back();
+      local->stats.hit();
+    } else {
+      obj = new T();
+      if (local) {
+        local->stats.miss();
+      }
+    }
+    return std::shared_ptr<T>(obj, &ObjectPool<T>::Recycle, PoolAllocator<T>());
+  }
+
+private:
+  static void Recycle(T* obj) {
+    Local* local = ThreadCache<Local>::get();
+    if (local == nullptr || local->free.size() >= local->capacity) {
+      delete obj;
+      return;
+    }
+    PoolTraits<T>::reset(obj);
+    local->free.push_back(obj);
+  }
+
+  struct Local {
+    std::vector<T*> free;
+    size_t capacity{objectPoolCapacity()};
+    PoolStats stats{PoolTraits<T>::name()};
+
+    ~Local() {
+      for (T* obj : free) {
+        delete obj;
+      }
+    }
+  };
+};
+
+}
+
+#endif
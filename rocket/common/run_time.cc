@@ -20,4 +20,26 @@ RpcInterface* RunTime::getRpcInterface() {
   return rpc_interface_;
 }
 
-}
\ No newline at end of file
+
+ScopedRunTime::ScopedRunTime(const RequestContext& context) {
+  RunTime* run_time = RunTime::GetRunTime();
+  saved_.req_id = run_time->req_id_;
+  saved_.msgid.swap(run_time->msgid_);
+  saved_.method_name.swap(run_time->method_name_);
+  saved_.deadline_ms = run_time->deadline_ms_;
+
+  run_time->req_id_ = context.req_id;
+  run_time->msgid_ = context.msgid;
+  run_time->method_name_ = context.method_name;
+  run_time->deadline_ms_ = context.deadline_ms;
+}
+
+ScopedRunTime::~ScopedRunTime() {
+  RunTime* run_time = RunTime::GetRunTime();
+  run_time->req_id_ = saved_.req_id;
+  run_time->msgid_.swap(saved_.msgid);
+  run_time->method_name_.swap(saved_.method_name);
+  run_time->deadline_ms_ = saved_.deadline_ms;
+}
+
+}
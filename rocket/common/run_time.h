@@ -2,12 +2,21 @@
 #define ROCKET_COMMON_RUN_TIME_H
 
 
+#include <cstdint>
 #include <string>
 
 namespace rocket {
 
 class RpcInterface;
 
+// 一个请求的上下文，处理该请求期间写入 RunTime
+struct RequestContext {
+  uint64_t req_id {0};
+  std::string msgid;
+  std::string method_name;
+  int64_t deadline_ms {0};
+};
+
 class RunTime {
  public:
   RpcInterface* getRpcInterface();
@@ -17,12 +26,28 @@ class RunTime {
 
 
  public:
-  std::string msgid_;
+  uint64_t req_id_ {0};       // 当前处理的请求号，日志中没有 trace id 时输出
+  std::string msgid_;         // 当前处理请求的 trace id，下游调用继承
   std::string method_name_;
+  int64_t deadline_ms_ {0};   // 当前处理请求的 deadline，下游调用据此继承剩余超时时间
   RpcInterface* rpc_interface_ {NULL};
 
 };
 
+// 作用域内把 RunTime 设置为给定请求的上下文，离开作用域时恢复原来的值
+class ScopedRunTime {
+ public:
+  explicit ScopedRunTime(const RequestContext& context);
+
+  ~ScopedRunTime();
+
+  ScopedRunTime(const ScopedRunTime&) = delete;
+  ScopedRunTime& operator=(const ScopedRunTime&) = delete;
+
+ private:
+  RequestContext saved_;
+};
+
 }
 
 
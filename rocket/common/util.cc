@@ -2,6 +2,7 @@
 #include <unistd.h>
 #include <sys/syscall.h>
 #include <sys/time.h>
+#include <time.h>
 #include <string.h>
 #include <arpa/inet.h>
 #include <filesystem>
@@ -14,18 +15,21 @@ static int g_pid = 0;
 
 static thread_local int t_thread_id = 0;
 
+// 进程号和线程号在第一次获取后缓存，每行日志都会用到，避免每次都做系统调用
 pid_t getPid() {
   if (g_pid != 0) {
     return g_pid;
   }
-  return getpid();
+  g_pid = getpid();
+  return g_pid;
 }
 
 pid_t getThreadId() {
   if (t_thread_id != 0) {
     return t_thread_id;
   }
-  return syscall(SYS_gettid);
+  t_thread_id = syscall(SYS_gettid);
+  return t_thread_id;
 }
 
 
@@ -38,6 +42,13 @@ int64_t getNowMs() {
 }
 
 
+int64_t getSteadyNowUs() {
+  timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+
 int32_t getInt32FromNetByte(const char* buf) {
   int32_t re;
   memcpy(&re, buf, sizeof(re));
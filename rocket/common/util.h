@@ -13,6 +13,9 @@ pid_t getThreadId();
 
 int64_t getNowMs();
 
+// 单调时钟，微秒，用于计算耗时
+int64_t getSteadyNowUs();
+
 int32_t getInt32FromNetByte(const char* buf);
 
 // 创建目录（递归创建，类似 mkdir -p）
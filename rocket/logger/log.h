@@ -5,6 +5,7 @@
 #include "rocket/logger/thread_local_buffer.h"
 #include <atomic>
 #include <condition_variable>
+#include <cstdio>
 #include <mutex>
 #include <sched.h>
 #include <semaphore>
@@ -20,42 +21,27 @@
 namespace rocket {
 
 
-template<typename... Args>
-std::string formatString(const char* str, Args&&... args) {
-
-  int size = snprintf(nullptr, 0, str, args...);
-
-  std::string result;
-  if (size > 0) {
-    result.resize(size);
-    snprintf(&result[0], size + 1, str, args...);
-  }
+// 编译期的最低日志级别，低于该级别的日志宏不生成任何代码：1 DEBUG，2 INFO，3 ERROR
+#ifndef ROCKET_MIN_LOG_LEVEL
+#define ROCKET_MIN_LOG_LEVEL 1
+#endif
 
-  return result;
-}
+// 参数只在这一行日志确实会输出时才求值和格式化
+#define ROCKET_LOG(level, str, ...) \
+  do { \
+    if constexpr (rocket::level >= ROCKET_MIN_LOG_LEVEL) { \
+      if (rocket::Logger::GetGlobalLogger()->isEnabled(rocket::level)) { \
+        static const rocket::LogSite rocket_log_site(rocket::level, __FILE__, __LINE__, str); \
+        rocket::writeLog(rocket_log_site, ##__VA_ARGS__); \
+      } \
+    } \
+  } while (0)
 
+#define DEBUGLOG(str, ...) ROCKET_LOG(Debug, str, ##__VA_ARGS__)
 
-#define DEBUGLOG(str, ...) \
-  if (rocket::Logger::GetGlobalLogger()->getLogLevel() && rocket::Logger::GetGlobalLogger()->getLogLevel() <= rocket::Debug) \
-  { \
-    rocket::Logger::GetGlobalLogger()->pushLog(rocket::LogEvent(rocket::LogLevel::Debug).toString() \
-      + "[" + std::string(__FILE__) + ":" + std::to_string(__LINE__) + "]\t" + rocket::formatString(str, ##__VA_ARGS__) + "\n");\
-  } \
+#define INFOLOG(str, ...) ROCKET_LOG(Info, str, ##__VA_ARGS__)
 
-
-#define INFOLOG(str, ...) \
-  if (rocket::Logger::GetGlobalLogger()->getLogLevel() <= rocket::Info) \
-  { \
-    rocket::Logger::GetGlobalLogger()->pushLog(rocket::LogEvent(rocket::LogLevel::Info).toString() \
-    + "[" + std::string(__FILE__) + ":" + std::to_string(__LINE__) + "]\t" + rocket::formatString(str, ##__VA_ARGS__) + "\n");\
-  } \
-
-#define ERRORLOG(str, ...) \
-  if (rocket::Logger::GetGlobalLogger()->getLogLevel() <= rocket::Error) \
-  { \
-    rocket::Logger::GetGlobalLogger()->pushLog(rocket::LogEvent(rocket::LogLevel::Error).toString() \
-      + "[" + std::string(__FILE__) + ":" + std::to_string(__LINE__) + "]\t" + rocket::formatString(str, ##__VA_ARGS__) + "\n");\
-  } \
+#define ERRORLOG(str, ...) ROCKET_LOG(Error, str, ##__VA_ARGS__)
 
 
 enum LogLevel {
@@ -68,6 +54,8 @@ enum LogLevel {
 
 std::string LogLevelToString(LogLevel level);
 
+const char* LogLevelName(LogLevel level);
+
 LogLevel StringToLogLevel(const std::string& log_level);
 
 class AsyncLogger {
@@ -132,6 +120,8 @@ class Logger {
 
   void pushLog(const std::string& msg);
 
+  void pushLog(std::string&& msg);
+
   void init();
 
   void log();
@@ -140,6 +130,11 @@ class Logger {
     return set_level_;
   }
 
+  // 日志级别未知时只关闭 DEBUG 日志
+  bool isEnabled(LogLevel level) const {
+    return set_level_ <= level && (set_level_ != Unknown || level != Debug);
+  }
+
   AsyncLogger::s_ptr getAsyncLopger() {
     return asnyc_logger_;
   }
@@ -209,6 +204,9 @@ class LogEvent {
 
   std::string toString();
 
+  // 把日志头追加到 out 中，与 toString 的结果相同
+  void appendTo(std::string& out);
+
 
  private:
   std::string file_name_;  // 文件名
@@ -221,7 +219,54 @@ class LogEvent {
 };
 
 
+// 日志调用点的静态信息，每个调用点第一次输出日志时创建一次
+struct LogSite {
+  LogSite(LogLevel level, const char* file, int line, const char* format);
+
+  LogLevel level;
+  const char* format;
+  std::string location;   // [file:line]\t
+};
+
+// 按 format 格式化后追加到 out 中，较短的结果只调用一次 snprintf
+template<typename... Args>
+void appendFormat(std::string& out, const char* format, Args&&... args) {
+  if constexpr (sizeof...(Args) == 0) {
+    out.append(format);
+  } else {
+    char buf[512];
+    int size = snprintf(buf, sizeof(buf), format, args...);
+    if (size <= 0) {
+      return;
+    }
+    if (static_cast<size_t>(size) < sizeof(buf)) {
+      out.append(buf, size);
+      return;
+    }
+    size_t offset = out.size();
+    out.resize(offset + size);
+    snprintf(&out[offset], size + 1, format, args...);
+  }
+}
+
+template<typename... Args>
+std::string formatString(const char* str, Args&&... args) {
+  std::string result;
+  appendFormat(result, str, args...);
+  return result;
+}
+
+template<typename... Args>
+void writeLog(const LogSite& site, Args&&... args) {
+  std::string msg;
+  msg.reserve(256);
+  LogEvent(site.level).appendTo(msg);
+  msg.append(site.location);
+  appendFormat(msg, site.format, args...);
+  msg.push_back('\n');
+  Logger::GetGlobalLogger()->pushLog(std::move(msg));
+}
 
 }
 
-#endif
\ No newline at end of file
+#endif
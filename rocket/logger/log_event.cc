@@ -1,46 +1,62 @@
 #include "rocket/logger/log.h"
 #include "rocket/common/run_time.h"
 #include "rocket/common/util.h"
-#include <sstream>
 #include <sys/time.h>
 
 namespace rocket {
 
+LogSite::LogSite(LogLevel level, const char* file, int line, const char* format)
+    : level(level), format(format) {
+  location.append("[").append(file).append(":").append(std::to_string(line)).append("]\t");
+}
+
 std::string LogEvent::toString() {
+  std::string result;
+  appendTo(result);
+  return result;
+}
+
+void LogEvent::appendTo(std::string& out) {
   struct timeval now_time;
 
   gettimeofday(&now_time, nullptr);
 
-  struct tm now_time_t;
-  localtime_r(&(now_time.tv_sec), &now_time_t);
-
-  char buf[128];
-  strftime(&buf[0], 128, "%y-%m-%d %H:%M:%S", &now_time_t);
-  std::string time_str(buf);
+  // 同一秒内的日志复用格式化好的时间
+  static thread_local time_t t_last_second = 0;
+  static thread_local char t_time_buf[64];
+  if (now_time.tv_sec != t_last_second) {
+    struct tm now_time_t;
+    localtime_r(&(now_time.tv_sec), &now_time_t);
+    strftime(&t_time_buf[0], sizeof(t_time_buf), "%y-%m-%d %H:%M:%S", &now_time_t);
+    t_last_second = now_time.tv_sec;
+  }
   int ms = now_time.tv_usec / 1000;
-  time_str = time_str + "." + std::to_string(ms);
 
   pid_ = getPid();
   thread_id_ = getThreadId();
 
-  std::stringstream ss;
+  // 进程号和线程号不变，每个线程格式化一次
+  static thread_local std::string t_thread_str;
+  if (t_thread_str.empty()) {
+    t_thread_str = "[" + std::to_string(pid_) + ":" + std::to_string(thread_id_) + "]\t";
+  }
 
-  ss << "[" << LogLevelToString(level_) << "]\t"
-     << "[" << time_str << "]\t"
-     << "[" << pid_ << ":" << thread_id_ << "]\t";
+  out.append("[").append(LogLevelName(level_)).append("]\t");
+  out.append("[").append(t_time_buf).append(".").append(std::to_string(ms)).append("]\t");
+  out.append(t_thread_str);
 
-  // 获取当前线程处理的请求的 msgid
+  // 获取当前线程处理的请求的 trace id，没有时输出请求号
 
-  std::string msgid = RunTime::GetRunTime()->msgid_;
-  std::string method_name = RunTime::GetRunTime()->method_name_;
-  if (!msgid.empty()) {
-    ss << "[" << msgid << "]\t";
+  RunTime* run_time = RunTime::GetRunTime();
+  if (!run_time->msgid_.empty()) {
+    out.append("[").append(run_time->msgid_).append("]\t");
+  } else if (run_time->req_id_ != 0) {
+    out.append("[").append(std::to_string(run_time->req_id_)).append("]\t");
   }
 
-  if (!method_name.empty()) {
-    ss << "[" << method_name << "]\t";
+  if (!run_time->method_name_.empty()) {
+    out.append("[").append(run_time->method_name_).append("]\t");
   }
-  return ss.str();
 }
 
 } // namespace rocket
@@ -194,6 +194,10 @@ void Logger::InitGlobalLogger(int type /*=1*/) {
 }
 
 std::string LogLevelToString(LogLevel level) {
+  return LogLevelName(level);
+}
+
+const char *LogLevelName(LogLevel level) {
   switch (level) {
   case Debug:
     return "DEBUG";
@@ -231,6 +235,16 @@ void Logger::pushLog(const std::string &msg) {
   t_buffer_guard->buffer_->push(msg);
 }
 
+void Logger::pushLog(std::string &&msg) {
+  if (type_ == 0) {
+    std::cout << msg.c_str() << std::endl;
+    return;
+  }
+
+  auto t_buffer_guard = ThreadLocalLogBufferGuard::getGuard();
+  t_buffer_guard->buffer_->push(std::move(msg));
+}
+
 void Logger::flushThreadLocalBuffer(
     const std::vector<std::string> &thread_buffer) {
   // 批量刷新日志
@@ -29,6 +29,11 @@ void ThreadLocalLogBuffer::push(const std::string &msg) {
   buffer.push_back(msg);
 }
 
+void ThreadLocalLogBuffer::push(std::string &&msg) {
+  std::scoped_lock<std::mutex> lock(buffer_mutex);
+  buffer.push_back(std::move(msg));
+}
+
 // ThreadLocalLogBufferGuard 实现
 ThreadLocalLogBufferGuard::ThreadLocalLogBufferGuard()
     : buffer_(std::make_shared<ThreadLocalLogBuffer>()) {
@@ -26,6 +26,8 @@ struct ThreadLocalLogBuffer {
 
   void push(const std::string& msg);
 
+  void push(std::string&& msg);
+
   // 禁止拷贝和移动
   ThreadLocalLogBuffer(const ThreadLocalLogBuffer&) = delete;
   ThreadLocalLogBuffer& operator=(const ThreadLocalLogBuffer&) = delete;
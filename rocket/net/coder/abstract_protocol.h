@@ -1,6 +1,7 @@
 #ifndef ROCKET_NET_ABSTRACT_PROTOCOL_H
 #define ROCKET_NET_ABSTRACT_PROTOCOL_H
 
+#include <cstdint>
 #include <memory>
 #include <string>
 
@@ -14,7 +15,8 @@ struct AbstractProtocol : public std::enable_shared_from_this<AbstractProtocol>
   virtual ~AbstractProtocol() {}
 
  public:
-  std::string msg_id_;     // 请求号，唯一标识一个请求或者响应
+  uint64_t req_id_ {0};    // 请求号，在一条连接上唯一标识一个请求和它的响应，见 MsgIDUtil::GenReqId
+  std::string msg_id_;     // 可选的 trace id，只用于日志关联，可以为空
 
 
 };
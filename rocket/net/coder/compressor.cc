@@ -0,0 +1,278 @@
+#include <string.h>
+#include <zlib.h>
+#include <algorithm>
+#include "rocket/net/coder/compressor.h"
+#include "rocket/common/config.h"
+#include "rocket/logger/log.h"
+
+namespace rocket {
+
+/**
+ * LZ4 块格式：由若干 sequence 组成，每个 sequence 为
+ * [token][字面量长度扩展][字面量][offset:2 小端][匹配长度扩展]
+ * token 高 4 位为字面量长度，低 4 位为匹配长度 - 4，等于 15 时后面追加 255 累加的扩展字节
+ * 最后一个 sequence 只有字面量，最后 5 个字节总是字面量
+ */
+static const int kLz4HashLog = 12;
+static const size_t kLz4MinMatch = 4;
+static const size_t kLz4LastLiterals = 5;
+static const size_t kLz4MfLimit = 12;      // 距离结尾不足该长度时不再查找匹配
+static const size_t kLz4MaxOffset = 65535;
+static const int kLz4SkipTrigger = 6;      // 连续未命中时逐渐加大步长，快速跳过不可压缩的数据
+
+static inline uint32_t lz4Read32(const char* p) {
+  uint32_t v;
+  memcpy(&v, p, sizeof(v));
+  return v;
+}
+
+static inline uint32_t lz4Hash(uint32_t v) {
+  return (v * 2654435761U) >> (32 - kLz4HashLog);
+}
+
+static inline char* lz4WriteLength(char* op, size_t len) {
+  while (len >= 255) {
+    *op++ = static_cast<char>(255);
+    len -= 255;
+  }
+  *op++ = static_cast<char>(len);
+  return op;
+}
+
+static inline bool lz4ReadLength(const uint8_t*& ip, const uint8_t* end, size_t& len) {
+  uint8_t b = 0;
+  do {
+    if (ip >= end) {
+      return false;
+    }
+    b = *ip++;
+    len += b;
+  } while (b == 255);
+  return true;
+}
+
+static char* lz4WriteSequence(char* op, const char* literal, size_t literal_len,
+                              size_t offset, size_t match_len) {
+  uint8_t token = static_cast<uint8_t>(std::min<size_t>(literal_len, 15) << 4);
+  if (offset != 0) {
+    token |= static_cast<uint8_t>(std::min<size_t>(match_len - kLz4MinMatch, 15));
+  }
+  *op++ = static_cast<char>(token);
+  if (literal_len >= 15) {
+    op = lz4WriteLength(op, literal_len - 15);
+  }
+  memcpy(op, literal, literal_len);
+  op += literal_len;
+  if (offset == 0) {
+    return op;
+  }
+  *op++ = static_cast<char>(offset & 0xff);
+  *op++ = static_cast<char>(offset >> 8);
+  if (match_len - kLz4MinMatch >= 15) {
+    op = lz4WriteLength(op, match_len - kLz4MinMatch - 15);
+  }
+  return op;
+}
+
+class Lz4Compressor : public Compressor {
+public:
+  uint8_t type() const override { return COMPRESS_LZ4; }
+
+  const char* name() const override { return "lz4"; }
+
+  size_t maxCompressedLength(size_t len) const override {
+    return len + len / 255 + 16;
+  }
+
+  bool compress(const char* in, size_t len, char* out, size_t& out_len) const override {
+    char* op = out;
+    size_t anchor = 0;
+
+    if (len > kLz4MfLimit) {
+      // 保存的是位置，哈希冲突时通过比较内容排除
+      uint32_t table[1 << kLz4HashLog];
+      memset(table, 0, sizeof(table));
+
+      size_t limit = len - kLz4MfLimit;
+      size_t match_limit = len - kLz4LastLiterals;
+      size_t ip = 0;
+      size_t misses = 0;
+      while (ip < limit) {
+        uint32_t seq = lz4Read32(in + ip);
+        uint32_t h = lz4Hash(seq);
+        size_t ref = table[h];
+        table[h] = static_cast<uint32_t>(ip);
+
+        if (ref >= ip || ip - ref > kLz4MaxOffset || lz4Read32(in + ref) != seq) {
+          ip += 1 + (misses++ >> kLz4SkipTrigger);
+          continue;
+        }
+        misses = 0;
+
+        // 向后扩展匹配，再向前合并还没有输出的字面量
+        size_t end = ip + kLz4MinMatch;
+        while (end < match_limit && in[end] == in[ref + end - ip]) {
+          end++;
+        }
+        while (ip > anchor && ref > 0 && in[ip - 1] == in[ref - 1]) {
+          ip--;
+          ref--;
+        }
+
+        op = lz4WriteSequence(op, in + anchor, ip - anchor, ip - ref, end - ip);
+        ip = end;
+        anchor = end;
+        if (ip - 2 < limit) {
+          table[lz4Hash(lz4Read32(in + ip - 2))] = static_cast<uint32_t>(ip - 2);
+        }
+      }
+    }
+
+    op = lz4WriteSequence(op, in + anchor, len - anchor, 0, 0);
+    out_len = op - out;
+    return true;
+  }
+
+  bool decompress(const char* in, size_t len, char* out, size_t raw_len) const override {
+    const uint8_t* ip = reinterpret_cast<const uint8_t*>(in);
+    const uint8_t* end = ip + len;
+    char* op = out;
+    char* oend = out + raw_len;
+
+    while (ip < end) {
+      uint8_t token = *ip++;
+      size_t literal_len = token >> 4;
+      if (literal_len == 15 && !lz4ReadLength(ip, end, literal_len)) {
+        return false;
+      }
+      if (literal_len > static_cast<size_t>(end - ip) || literal_len > static_cast<size_t>(oend - op)) {
+        return false;
+      }
+      memcpy(op, ip, literal_len);
+      op += literal_len;
+      ip += literal_len;
+      if (ip == end) {
+        break;
+      }
+
+      if (end - ip < 2) {
+        return false;
+      }
+      size_t offset = ip[0] | (ip[1] << 8);
+      ip += 2;
+      size_t match_len = token & 0x0f;
+      if (match_len == 15 && !lz4ReadLength(ip, end, match_len)) {
+        return false;
+      }
+      match_len += kLz4MinMatch;
+      if (offset == 0 || offset > static_cast<size_t>(op - out) || match_len > static_cast<size_t>(oend - op)) {
+        return false;
+      }
+
+      const char* match = op - offset;
+      if (offset >= match_len) {
+        memcpy(op, match, match_len);
+      } else {
+        // 重叠拷贝，必须逐字节向前复制
+        for (size_t i = 0; i < match_len; ++i) {
+          op[i] = match[i];
+        }
+      }
+      op += match_len;
+    }
+    return op == oend;
+  }
+};
+
+class ZlibCompressor : public Compressor {
+public:
+  explicit ZlibCompressor(int level) : level_(level) {}
+
+  uint8_t type() const override { return COMPRESS_ZLIB; }
+
+  const char* name() const override { return "zlib"; }
+
+  size_t maxCompressedLength(size_t len) const override {
+    return compressBound(len);
+  }
+
+  bool compress(const char* in, size_t len, char* out, size_t& out_len) const override {
+    uLongf dest_len = compressBound(len);
+    int rt = compress2(reinterpret_cast<Bytef*>(out), &dest_len,
+                       reinterpret_cast<const Bytef*>(in), len, level_);
+    if (rt != Z_OK) {
+      ERRORLOG("zlib compress error, rt[%d]", rt);
+      return false;
+    }
+    out_len = dest_len;
+    return true;
+  }
+
+  bool decompress(const char* in, size_t len, char* out, size_t raw_len) const override {
+    uLongf dest_len = raw_len;
+    int rt = uncompress(reinterpret_cast<Bytef*>(out), &dest_len,
+                        reinterpret_cast<const Bytef*>(in), len);
+    return rt == Z_OK && dest_len == raw_len;
+  }
+
+private:
+  int level_{Z_BEST_SPEED};
+};
+
+CompressorRegistry::CompressorRegistry() {
+  int zlib_level = Z_BEST_SPEED;
+  if (Config::GetGlobalConfig()) {
+    zlib_level = Config::GetGlobalConfig()->compress_config_.zlib_level;
+  }
+  registerCompressor(std::make_unique<Lz4Compressor>());
+  registerCompressor(std::make_unique<ZlibCompressor>(zlib_level));
+}
+
+void CompressorRegistry::registerCompressor(std::unique_ptr<Compressor> compressor) {
+  uint8_t type = compressor->type();
+  if (type == COMPRESS_NONE || type >= 8) {
+    ERRORLOG("register compressor[%s] error, invalid type[%d]", compressor->name(), type);
+    return;
+  }
+
+  MetricsRegistry* registry = MetricsRegistry::GetInstance();
+  std::string label = std::string("{codec=\"") + compressor->name() + "\"}";
+  raw_bytes_[type] = registry->getCounter("rocket_compress_raw_bytes_total" + label);
+  wire_bytes_[type] = registry->getCounter("rocket_compress_wire_bytes_total" + label);
+  compressors_[type] = std::move(compressor);
+}
+
+const Compressor* CompressorRegistry::get(uint8_t type) const {
+  if (type >= 8) {
+    return nullptr;
+  }
+  return compressors_[type].get();
+}
+
+const Compressor* CompressorRegistry::get(const std::string& name) const {
+  for (auto& compressor : compressors_) {
+    if (compressor && name == compressor->name()) {
+      return compressor.get();
+    }
+  }
+  return nullptr;
+}
+
+uint8_t CompressorRegistry::supportedMask() const {
+  uint8_t mask = 0;
+  for (int i = 1; i < 8; ++i) {
+    if (compressors_[i]) {
+      mask |= static_cast<uint8_t>(1 << i);
+    }
+  }
+  return mask;
+}
+
+void CompressorRegistry::recordCompressed(uint8_t type, size_t raw_len, size_t wire_len) {
+  if (type < 8 && raw_bytes_[type]) {
+    raw_bytes_[type]->inc(raw_len);
+    wire_bytes_[type]->inc(wire_len);
+  }
+}
+
+}
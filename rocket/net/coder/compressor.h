@@ -0,0 +1,70 @@
+#ifndef ROCKET_NET_CODER_COMPRESSOR_H
+#define ROCKET_NET_CODER_COMPRESSOR_H
+
+#include "rocket/common/metrics.h"
+#include "rocket/common/singleton.h"
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+
+namespace rocket {
+
+// 压缩算法编号，同时用作协商掩码的位序号，取值不能超过 7
+enum CompressType : uint8_t {
+  COMPRESS_NONE = 0,
+  COMPRESS_LZ4 = 1,    // 内置的 LZ4 块格式实现，速度优先
+  COMPRESS_ZLIB = 2,   // zlib deflate，压缩率优先
+};
+
+/**
+ * @brief 压缩算法接口，实现必须是无状态的，可以被多个线程同时调用
+ */
+class Compressor {
+public:
+  virtual ~Compressor() {}
+
+  virtual uint8_t type() const = 0;
+
+  virtual const char* name() const = 0;
+
+  // 压缩 len 字节的输入最多需要的输出空间
+  virtual size_t maxCompressedLength(size_t len) const = 0;
+
+  // 压缩到调用方提供的 out(容量至少为 maxCompressedLength)，out_len 返回实际长度
+  virtual bool compress(const char* in, size_t len, char* out, size_t& out_len) const = 0;
+
+  // 解压到调用方提供的 out，原始数据长度必须恰好为 raw_len
+  virtual bool decompress(const char* in, size_t len, char* out, size_t raw_len) const = 0;
+};
+
+/**
+ * @brief 压缩算法注册表，内置 lz4 和 zlib，可以在启动时注册自定义实现
+ */
+class CompressorRegistry : public Singleton<CompressorRegistry> {
+public:
+  CompressorRegistry();
+
+  // 同一编号重复注册时覆盖，需要在连接建立之前调用
+  void registerCompressor(std::unique_ptr<Compressor> compressor);
+
+  // 不存在时返回 nullptr
+  const Compressor* get(uint8_t type) const;
+
+  const Compressor* get(const std::string& name) const;
+
+  // 本端可以解压的算法掩码，第 type 位表示支持该算法
+  uint8_t supportedMask() const;
+
+  // 统计压缩前后的字节数
+  void recordCompressed(uint8_t type, size_t raw_len, size_t wire_len);
+
+private:
+  std::unique_ptr<Compressor> compressors_[8];
+  Counter* raw_bytes_[8] = {nullptr};
+  Counter* wire_bytes_[8] = {nullptr};
+};
+
+}
+
+#endif
@@ -35,7 +35,7 @@ class StringCoder : public AbstractCoder {
 
     std::shared_ptr<StringProtocol> msg = std::make_shared<StringProtocol>();
     msg->info = info;
-    msg->msg_id_ = "123456";
+    msg->req_id_ = 123456;
     out_messages.push_back(msg);
   }
 
@@ -1,21 +1,119 @@
 #include <asio/buffer.hpp>
+#include <algorithm>
 #include <vector>
 #include <string.h>
 #include <arpa/inet.h>
 #include "rocket/net/coder/tinypb_coder.h"
 #include "rocket/net/coder/tinypb_protocol.h"
+#include "rocket/common/config.h"
+#include "rocket/common/crc32c.h"
+#include "rocket/common/metrics.h"
 #include "rocket/common/util.h"
 #include "rocket/logger/log.h"
 
 namespace rocket {
 
+// 没有配置最大报文长度时解压后 pb_data 的长度上限，避免恶意数据申请过大的内存
+static const int32_t kMaxDecompressLength = 64 * 1024 * 1024;
+
+// v1 报文除各字符串字段外的固定长度：PB_START、5 个 int32 字段、check_sum 和 PB_END
+static const int32_t kMinV1FrameLength = 2 + 6 * sizeof(int32_t);
+
+// 不计算校验和时 check_sum 写入的固定值
+static const int32_t kNoChecksumValue = 1;
+
+TinyPBCoder::TinyPBCoder() {
+  Config* config = Config::GetGlobalConfig();
+  if (config == NULL) {
+    return;
+  }
+  write_checksum_ = config->checksum_config_.enable;
+  verify_checksum_ = config->checksum_config_.verify;
+  max_version_ = static_cast<uint8_t>(std::clamp<int>(config->protocol_config_.max_version,
+      TinyPBProtocol::VERSION_1, TinyPBProtocol::VERSION_2));
+  max_frame_size_ = std::max(config->protocol_config_.max_frame_size, 0);
+  method_id_enable_ = config->protocol_config_.method_id;
+
+  if (!config->compress_config_.enable) {
+    return;
+  }
+  CompressorRegistry* registry = CompressorRegistry::GetInstance();
+  for (auto& name : config->compress_config_.codecs) {
+    const Compressor* compressor = registry->get(name);
+    if (compressor == nullptr) {
+      ERRORLOG("unknown compress codec[%s], ignore it", name.c_str());
+      continue;
+    }
+    preferred_.push_back(compressor->type());
+    local_mask_ |= static_cast<uint8_t>(1 << compressor->type());
+  }
+  threshold_ = config->compress_config_.threshold;
+}
+
+// v1 报文和批量帧中 req_id 以十进制字符串传输，与旧版本的 msg_id 兼容
+static const int kMaxReqIdDigits = 20;
+
+static bool parseReqId(const char* data, size_t len, uint64_t& id) {
+  if (len == 0 || len > kMaxReqIdDigits || (data[0] == '0' && len > 1)) {
+    return false;
+  }
+  id = 0;
+  for (size_t i = 0; i < len; ++i) {
+    if (data[i] < '0' || data[i] > '9') {
+      return false;
+    }
+    uint64_t digit = data[i] - '0';
+    if (id > (UINT64_MAX - digit) / 10) {
+      return false;
+    }
+    id = id * 10 + digit;
+  }
+  return true;
+}
+
+// buf 至少 kMaxReqIdDigits 字节，返回写入的长度
+static int formatReqId(uint64_t id, char* buf) {
+  char digits[kMaxReqIdDigits];
+  int len = 0;
+  do {
+    digits[len++] = static_cast<char>('0' + id % 10);
+    id /= 10;
+  } while (id != 0);
+  for (int i = 0; i < len; ++i) {
+    buf[i] = digits[len - 1 - i];
+  }
+  return len;
+}
+
+// 旧版本对端的 msg_id 不是合法的请求号时原样保存在 legacy_id_ 中(同时作为 trace id)，
+// req_id 使用 legacy_seq 分配的本地请求号。本地请求号小于 2^32，
+// MsgIDUtil::GenReqId 生成的请求号线程位不为 0，两者不会冲突；0 保留给握手帧
+static void setReqId(TinyPBProtocol& message, const char* data, size_t len, uint32_t& legacy_seq) {
+  if (!parseReqId(data, len, message.req_id_)) {
+    if (++legacy_seq == 0) {
+      legacy_seq = 1;
+    }
+    message.req_id_ = legacy_seq;
+    message.legacy_id_.assign(data, len);
+    message.msg_id_.assign(data, len);
+  }
+}
+
+static bool legacyId(const TinyPBProtocol& message) {
+  return !message.legacy_id_.empty();
+}
+
 // 将 message 对象转化为字节流，写入到 buffer
 void TinyPBCoder::encode(std::vector<AbstractProtocol::s_ptr>& messages, TcpBuffer& out_buffer) {
   for (auto &i : messages) {
     std::shared_ptr<TinyPBProtocol> msg = std::dynamic_pointer_cast<TinyPBProtocol>(i);
     int len = 0;
     const char* buf = encodeTinyPB(msg, len);
-    if (buf != NULL && len != 0) {
+    int32_t peer_max_frame_size = peer_max_frame_size_.load(std::memory_order_relaxed);
+    if (peer_max_frame_size > 0 && len > peer_max_frame_size) {
+      // 对端会丢弃超过上限的报文，不再发送
+      ERRORLOG("%lu | frame_len[%d] exceeds peer max frame size[%d], drop it", msg->req_id_, len, peer_max_frame_size);
+    } else if (buf != NULL && len != 0) {
       out_buffer.writeToBuffer(buf, len);
     }
     if (buf) {
@@ -28,128 +126,794 @@ void TinyPBCoder::encode(std::vector<AbstractProtocol::s_ptr>& messages, TcpBuff
 
 // 将 buffer 里面的字节流转换为 message 对象
 void TinyPBCoder::decode(std::vector<AbstractProtocol::s_ptr>& out_messages, TcpBuffer& buffer) {
-  while(1) {
-    // 遍历 buffer，找到 PB_START，找到之后，解析出整包的长度。然后得到结束符的位置，判断是否为 PB_END
-    std::vector<char> tmp = buffer.getBufferVecCopy();
-    int start_index = 0;
-    int end_index = -1;
-
-    int pk_len = 0;
-    bool parse_success = false;
-    int i = 0;
-    for (i = start_index; i < tmp.size(); ++i) {
-      if (tmp[i] == TinyPBProtocol::PB_START) {
-        // 读下去四个字节。由于是网络字节序，需要转为主机字节序  
-        if (i + 1 < tmp.size()) {
-          pk_len = getInt32FromNetByte(&tmp[i+1]);
-          DEBUGLOG("get pk_len = %d", pk_len);
-
-          // 结束符的索引
-          int j = i + pk_len - 1;
-          if (j >= tmp.size()) {
-            continue;
-          }
-          if (tmp[j] == TinyPBProtocol::PB_END) {
-            start_index = i;
-            end_index = j;
-            parse_success = true;
-            break;
-          }
-          
-        }
-      }
+  // 按首字节区分 v1 和 v2 报文，同一连接上两种报文可以混合出现
+  while (buffer.dataSize() > 0) {
+    const char* data = asio::buffer_cast<const char*>(buffer.getBuffer().data());
+    bool progress = false;
+    if (data[0] == TinyPBProtocol::PB_V2_MAGIC) {
+      progress = decodeV2(out_messages, buffer);
+    } else {
+      progress = decodeV1(out_messages, buffer);
     }
-
-    if (i >= tmp.size()) {
-      DEBUGLOG("decode end, read all buffer data");
+    if (!progress) {
       return;
     }
+  }
+}
 
-    if (parse_success) {
-      buffer.consume(end_index - start_index + 1);
-      std::shared_ptr<TinyPBProtocol> message = std::make_shared<TinyPBProtocol>(); 
-      message->pk_len_ = pk_len;
+// 解码一个 v1 报文，数据不完整时返回 false
+bool TinyPBCoder::decodeV1(std::vector<AbstractProtocol::s_ptr>& out_messages, TcpBuffer& buffer) {
+  // 遍历 buffer，找到 PB_START，找到之后，解析出整包的长度。然后得到结束符的位置，判断是否为 PB_END
+  std::vector<char> tmp = buffer.getBufferVecCopy();
+  int start_index = 0;
+  int end_index = -1;
 
-      int msg_id_len_index = start_index + sizeof(char) + sizeof(message->pk_len_);
-      if (msg_id_len_index >= end_index) {
-        message->parse_success = false;
-        ERRORLOG("parse error, msg_id_len_index[%d] >= end_index[%d]", msg_id_len_index, end_index);
-        continue;
+  int pk_len = 0;
+  bool parse_success = false;
+  size_t i = 0;
+  for (i = 0; i < tmp.size(); ++i) {
+    if (tmp[i] == TinyPBProtocol::PB_START) {
+      // 读下去四个字节。由于是网络字节序，需要转为主机字节序，长度字段不完整时等待更多数据
+      if (i + sizeof(int32_t) < tmp.size()) {
+        pk_len = getInt32FromNetByte(&tmp[i+1]);
+        DEBUGLOG("get pk_len = %d", pk_len);
+        if (pk_len < kMinV1FrameLength) {
+          continue;
+        }
+        if (max_frame_size_ > 0 && pk_len > max_frame_size_) {
+          ERRORLOG("pk_len[%d] exceeds max frame size[%d], skip it", pk_len, max_frame_size_);
+          continue;
+        }
+
+        // 结束符的索引，在 size_t 上计算，不会因为 pk_len 过大而溢出
+        size_t j = i + static_cast<size_t>(pk_len) - 1;
+        if (j >= tmp.size()) {
+          continue;
+        }
+        if (tmp[j] == TinyPBProtocol::PB_END) {
+          start_index = static_cast<int>(i);
+          end_index = static_cast<int>(j);
+          parse_success = true;
+          break;
+        }
+        
       }
-      message->msg_id_len_ = getInt32FromNetByte(&tmp[msg_id_len_index]);
-      DEBUGLOG("parse msg_id_len=%d", message->msg_id_len_);
-
-      int msg_id_index = msg_id_len_index + sizeof(message->msg_id_len_);
-      
-      char msg_id[100] = {0};
-      memcpy(&msg_id[0], &tmp[msg_id_index], message->msg_id_len_);
-      message->msg_id_ = std::string(msg_id);
-      DEBUGLOG("parse msg_id=%s", message->msg_id_.c_str());
-
-      int method_name_len_index = msg_id_index + message->msg_id_len_;
-      if (method_name_len_index >= end_index) {
+    }
+  }
+
+  if (i >= tmp.size()) {
+    DEBUGLOG("decode end, read all buffer data");
+    return false;
+  }
+
+  if (parse_success) {
+    buffer.consume(end_index - start_index + 1);
+    std::shared_ptr<TinyPBProtocol> message = ObjectPool<TinyPBProtocol>::Get(); 
+    message->pk_len_ = pk_len;
+
+    // 边界确定后先校验，校验失败的报文直接丢弃，不读取其中的任何长度字段
+    // 旧版本报文的 check_sum 为固定值，只有确认报文没有声明校验算法之后才放行
+    message->check_sum_ = getInt32FromNetByte(&tmp[end_index - sizeof(int32_t)]);
+    bool checksum_verified = false;
+    if (verify_checksum_) {
+      uint32_t check_sum = crc32c(&tmp[start_index + 1], pk_len - 2 - sizeof(int32_t));
+      checksum_verified = static_cast<uint32_t>(message->check_sum_) == check_sum;
+      if (!checksum_verified && message->check_sum_ != kNoChecksumValue) {
+        static Counter* s_checksum_errors = MetricsRegistry::GetInstance()->getCounter("rocket_checksum_errors_total");
+        s_checksum_errors->inc();
         message->parse_success = false;
-        ERRORLOG("parse error, method_name_len_index[%d] >= end_index[%d]", method_name_len_index, end_index);
-        continue;
+        ERRORLOG("checksum mismatch, expect[%u], actual[%u]", check_sum, static_cast<uint32_t>(message->check_sum_));
+        return true;
       }
-      message->method_name_len_ = getInt32FromNetByte(&tmp[method_name_len_index]);
+    }
+
+    int msg_id_len_index = start_index + sizeof(char) + sizeof(message->pk_len_);
+    if (msg_id_len_index >= end_index) {
+      message->parse_success = false;
+      ERRORLOG("parse error, msg_id_len_index[%d] >= end_index[%d]", msg_id_len_index, end_index);
+      return true;
+    }
+    message->msg_id_len_ = getInt32FromNetByte(&tmp[msg_id_len_index]);
+    DEBUGLOG("parse msg_id_len=%d", message->msg_id_len_);
 
-      int method_name_index = method_name_len_index + sizeof(message->method_name_len_);
-      char method_name[512] = {0};
-      memcpy(&method_name[0], &tmp[method_name_index], message->method_name_len_);
-      message->method_name_ = std::string(method_name);
-      DEBUGLOG("parse method_name=%s", message->method_name_.c_str());
+    int msg_id_index = msg_id_len_index + sizeof(message->msg_id_len_);
+    if (message->msg_id_len_ < 0 || msg_id_index + message->msg_id_len_ >= end_index) {
+      message->parse_success = false;
+      ERRORLOG("parse error, msg_id_len[%d] out of range", message->msg_id_len_);
+      return true;
+    }
+    setReqId(*message, &tmp[msg_id_index], message->msg_id_len_, legacy_seq_);
+    DEBUGLOG("parse req_id=%lu", message->req_id_);
+
+    int method_name_len_index = msg_id_index + message->msg_id_len_;
+    if (method_name_len_index >= end_index) {
+      message->parse_success = false;
+      ERRORLOG("parse error, method_name_len_index[%d] >= end_index[%d]", method_name_len_index, end_index);
+      return true;
+    }
+    message->method_name_len_ = getInt32FromNetByte(&tmp[method_name_len_index]);
+
+    int method_name_index = method_name_len_index + sizeof(message->method_name_len_);
+    if (message->method_name_len_ < 0 || method_name_index + message->method_name_len_ >= end_index) {
+      message->parse_success = false;
+      ERRORLOG("parse error, method_name_len[%d] out of range", message->method_name_len_);
+      return true;
+    }
+    // method_name 字段中 '\0' 之后是扩展字段
+    const char* method_name = &tmp[method_name_index];
+    const char* sep = reinterpret_cast<const char*>(memchr(method_name, '\0', message->method_name_len_));
+    if (sep == NULL) {
+      message->method_name_ = std::string(method_name, message->method_name_len_);
+    } else {
+      message->method_name_ = std::string(method_name, sep - method_name);
+      decodeExtension(message, sep + 1, method_name + message->method_name_len_ - sep - 1);
+    }
+    DEBUGLOG("parse method_name=%s", message->method_name_.c_str());
+
+    int err_code_index = method_name_index + message->method_name_len_;
+    if (err_code_index >= end_index) {
+      message->parse_success = false;
+      ERRORLOG("parse error, err_code_index[%d] >= end_index[%d]", err_code_index, end_index);
+      return true;
+    }
+    message->err_code_ = getInt32FromNetByte(&tmp[err_code_index]);
 
-      int err_code_index = method_name_index + message->method_name_len_;
-      if (err_code_index >= end_index) {
+
+    int error_info_len_index = err_code_index + sizeof(message->err_code_);
+    if (error_info_len_index >= end_index) {
+      message->parse_success = false;
+      ERRORLOG("parse error, error_info_len_index[%d] >= end_index[%d]", error_info_len_index, end_index);
+      return true;
+    }
+    message->err_info_len_ = getInt32FromNetByte(&tmp[error_info_len_index]);
+
+    int err_info_index = error_info_len_index + sizeof(message->err_info_len_);
+    if (message->err_info_len_ < 0 || err_info_index + message->err_info_len_ >= end_index) {
+      message->parse_success = false;
+      ERRORLOG("parse error, err_info_len[%d] out of range", message->err_info_len_);
+      return true;
+    }
+    message->err_info_.assign(&tmp[err_info_index], message->err_info_len_);
+    DEBUGLOG("parse error_info=%s", message->err_info_.c_str());
+
+    // 声明了校验算法的报文必须通过校验
+    if (verify_checksum_ && !checksum_verified && message->checksum_type_ == TinyPBProtocol::CHECKSUM_CRC32C) {
+      static Counter* s_checksum_errors = MetricsRegistry::GetInstance()->getCounter("rocket_checksum_errors_total");
+      s_checksum_errors->inc();
+      message->parse_success = false;
+      ERRORLOG("%lu | checksum mismatch, actual[%u]", message->req_id_, static_cast<uint32_t>(message->check_sum_));
+      return true;
+    }
+
+    int pd_data_index = err_info_index + message->err_info_len_;
+    int pb_data_len = end_index - static_cast<int>(sizeof(int32_t)) - pd_data_index;
+    if (pb_data_len < 0) {
+      message->parse_success = false;
+      ERRORLOG("%lu | parse error, pb_data_len[%d] out of range", message->req_id_, pb_data_len);
+      return true;
+    }
+    if (message->compress_type_ != COMPRESS_NONE) {
+      // 直接从接收缓冲区解压，不额外拷贝压缩数据
+      if (!decompressData(message, &tmp[pd_data_index], pb_data_len)) {
         message->parse_success = false;
-        ERRORLOG("parse error, err_code_index[%d] >= end_index[%d]", err_code_index, end_index);
-        continue;
+        ERRORLOG("%lu | decompress pb_data error, compress type[%d]", message->req_id_, message->compress_type_);
+        return true;
       }
-      message->err_code_ = getInt32FromNetByte(&tmp[err_code_index]);
+    } else {
+      message->pb_data_ = std::string(&tmp[pd_data_index], pb_data_len);
+    }
 
+    learnPeer(message, TinyPBProtocol::VERSION_1);
 
-      int error_info_len_index = err_code_index + sizeof(message->err_code_);
-      if (error_info_len_index >= end_index) {
-        message->parse_success = false;
-        ERRORLOG("parse error, error_info_len_index[%d] >= end_index[%d]", error_info_len_index, end_index);
-        continue;
+    // 这里校验和去解析
+    message->parse_success = true;
+
+    out_messages.push_back(message);
+  }
+  return true;
+}
+
+static char* writeVarint(char* out, uint64_t value) {
+  while (value >= 0x80) {
+    *out++ = static_cast<char>(value | 0x80);
+    value >>= 7;
+  }
+  *out++ = static_cast<char>(value);
+  return out;
+}
+
+static bool readVarint(const char*& p, const char* end, uint64_t& value) {
+  value = 0;
+  for (int shift = 0; shift < 64; shift += 7) {
+    if (p >= end) {
+      return false;
+    }
+    uint8_t b = static_cast<uint8_t>(*p++);
+    value |= static_cast<uint64_t>(b & 0x7f) << shift;
+    if ((b & 0x80) == 0) {
+      return true;
+    }
+  }
+  return false;
+}
+
+static bool readVarintString(const char*& p, const char* end, std::string& value) {
+  uint64_t len = 0;
+  if (!readVarint(p, end, len) || len > static_cast<uint64_t>(end - p)) {
+    return false;
+  }
+  value.assign(p, len);
+  p += len;
+  return true;
+}
+
+// 解码一个 v2 报文，数据不完整时返回 false
+bool TinyPBCoder::decodeV2(std::vector<AbstractProtocol::s_ptr>& out_messages, TcpBuffer& buffer) {
+  size_t size = buffer.dataSize();
+  if (size < TinyPBProtocol::V2_HEADER_LEN) {
+    return false;
+  }
+  const char* data = asio::buffer_cast<const char*>(buffer.getBuffer().data());
+  uint8_t flags = static_cast<uint8_t>(data[2]);
+  int32_t frame_len = getInt32FromNetByte(&data[3]);
+  if (static_cast<uint8_t>(data[1]) != TinyPBProtocol::VERSION_2 || frame_len < TinyPBProtocol::V2_HEADER_LEN
+      || (max_frame_size_ > 0 && frame_len > max_frame_size_)) {
+    // 头部已经损坏，无法确定报文边界，跳过一个字节重新查找
+    ERRORLOG("parse v2 header error, version[%d], frame_len[%d]", static_cast<uint8_t>(data[1]), frame_len);
+    buffer.consume(1);
+    return true;
+  }
+  if (size < static_cast<size_t>(frame_len)) {
+    return false;
+  }
+
+  // 直接从接收缓冲区解析，不拷贝整个缓冲区
+  std::shared_ptr<TinyPBProtocol> message = ObjectPool<TinyPBProtocol>::Get();
+  message->pk_len_ = frame_len;
+  bool ok = parseV2(message, data, frame_len, flags);
+  buffer.consume(frame_len);
+  if (ok) {
+    learnPeer(message, TinyPBProtocol::VERSION_2);
+    message->parse_success = true;
+    out_messages.push_back(message);
+  }
+  return true;
+}
+
+bool TinyPBCoder::parseV2(std::shared_ptr<TinyPBProtocol> message, const char* data, int frame_len, uint8_t flags) {
+  const char* p = data + TinyPBProtocol::V2_HEADER_LEN;
+  const char* end = data + frame_len;
+
+  if (flags & TinyPBProtocol::V2_CHECKSUM) {
+    if (end - p < static_cast<int>(sizeof(int32_t))) {
+      ERRORLOG("parse v2 error, frame_len[%d] too short for checksum", frame_len);
+      return false;
+    }
+    end -= sizeof(int32_t);
+    message->check_sum_ = getInt32FromNetByte(end);
+    message->checksum_type_ = TinyPBProtocol::CHECKSUM_CRC32C;
+    if (verify_checksum_) {
+      uint32_t check_sum = crc32c(data, end - data);
+      if (static_cast<uint32_t>(message->check_sum_) != check_sum) {
+        static Counter* s_checksum_errors = MetricsRegistry::GetInstance()->getCounter("rocket_checksum_errors_total");
+        s_checksum_errors->inc();
+        ERRORLOG("checksum mismatch, expect[%u], actual[%u]", check_sum, static_cast<uint32_t>(message->check_sum_));
+        return false;
       }
-      message->err_info_len_ = getInt32FromNetByte(&tmp[error_info_len_index]);
+    }
+  }
 
-      int err_info_index = error_info_len_index + sizeof(message->err_info_len_);
-      char error_info[512] = {0};
-      memcpy(&error_info[0], &tmp[err_info_index], message->err_info_len_);
-      message->err_info_ = std::string(error_info);
-      DEBUGLOG("parse error_info=%s", message->err_info_.c_str());
+  if (flags & TinyPBProtocol::V2_BINARY_ID) {
+    if (end - p < static_cast<int>(sizeof(uint64_t))) {
+      ERRORLOG("parse v2 error, req_id out of range");
+      return false;
+    }
+    uint64_t id = 0;
+    for (size_t i = 0; i < sizeof(uint64_t); ++i) {
+      id = (id << 8) | static_cast<uint8_t>(p[i]);
+    }
+    p += sizeof(uint64_t);
+    message->req_id_ = id;
+  } else {
+    uint64_t len = 0;
+    if (!readVarint(p, end, len) || len > static_cast<uint64_t>(end - p)) {
+      ERRORLOG("parse v2 error, msg_id out of range");
+      return false;
+    }
+    setReqId(*message, p, len, legacy_seq_);
+    p += len;
+  }
 
-      int pb_data_len = message->pk_len_ - message->method_name_len_ - message->msg_id_len_ - message->err_info_len_ - 2 - 24;
+  if (flags & TinyPBProtocol::V2_METHOD_ID) {
+    if (end - p < static_cast<int>(sizeof(uint32_t))) {
+      ERRORLOG("%lu | parse v2 error, method_id out of range", message->req_id_);
+      return false;
+    }
+    uint32_t method_id = 0;
+    for (size_t i = 0; i < sizeof(uint32_t); ++i) {
+      method_id = (method_id << 8) | static_cast<uint8_t>(p[i]);
+    }
+    p += sizeof(uint32_t);
+    message->method_id_ = method_id;
+  }
 
-      int pd_data_index = err_info_index + message->err_info_len_;
-      message->pb_data_ = std::string(&tmp[pd_data_index], pb_data_len);
+  if ((flags & TinyPBProtocol::V2_METHOD) && !readVarintString(p, end, message->method_name_)) {
+    ERRORLOG("%lu | parse v2 error, method_name out of range", message->req_id_);
+    return false;
+  }
 
-      // 这里校验和去解析
-      message->parse_success = true;
+  if (flags & TinyPBProtocol::V2_ERROR) {
+    uint64_t err_code = 0;
+    if (!readVarint(p, end, err_code) || !readVarintString(p, end, message->err_info_)) {
+      ERRORLOG("%lu | parse v2 error, err_info out of range", message->req_id_);
+      return false;
+    }
+    // zigzag 编码，负数错误码也只占少量字节
+    message->err_code_ = static_cast<int32_t>((err_code >> 1) ^ (~(err_code & 1) + 1));
+  }
 
-      out_messages.push_back(message);
+  if (flags & TinyPBProtocol::V2_EXT) {
+    uint64_t ext_len = 0;
+    if (!readVarint(p, end, ext_len) || ext_len > static_cast<uint64_t>(end - p)) {
+      ERRORLOG("%lu | parse v2 error, extension out of range", message->req_id_);
+      return false;
     }
+    decodeExtension(message, p, ext_len);
+    p += ext_len;
+  }
 
+  // 剩余部分都是 pb_data
+  if (message->compress_type_ != COMPRESS_NONE) {
+    if (!decompressData(message, p, end - p)) {
+      ERRORLOG("%lu | decompress pb_data error, compress type[%d]", message->req_id_, message->compress_type_);
+      return false;
+    }
+  } else {
+    message->pb_data_.assign(p, end - p);
   }
 
+  message->msg_id_len_ = (flags & TinyPBProtocol::V2_BINARY_ID) ? sizeof(uint64_t) : message->legacy_id_.length();
+  message->method_name_len_ = message->method_name_.length();
+  message->err_info_len_ = message->err_info_.length();
+  return true;
+}
 
+void TinyPBCoder::learnPeer(const std::shared_ptr<TinyPBProtocol>& message, uint8_t frame_version) {
+  bool learned = false;
+  if (message->accept_compress_ != 0) {
+    peer_mask_.store(message->accept_compress_, std::memory_order_relaxed);
+    learned = true;
+  }
+  // 对端发来 v2 报文或声明支持 v2 时，之后按双方都支持的最高版本编码
+  uint8_t version = std::max(frame_version, message->max_version_);
+  if (version > TinyPBProtocol::VERSION_1) {
+    uint8_t agreed = std::min(version, max_version_);
+    if (agreed > peer_version_.load(std::memory_order_relaxed)) {
+      peer_version_.store(agreed, std::memory_order_release);
+    }
+    learned = true;
+  }
+  if (learned) {
+    peer_known_.store(true, std::memory_order_release);
+  }
 }
 
 
+void TinyPBCoder::decodeExtension(std::shared_ptr<TinyPBProtocol> message, const char* buf, int len) {
+  int i = 0;
+  while (i + 2 <= len) {
+    uint8_t tag = static_cast<uint8_t>(buf[i]);
+    int value_len = static_cast<uint8_t>(buf[i + 1]);
+    const char* value = &buf[i + 2];
+    i += 2 + value_len;
+    if (i > len) {
+      ERRORLOG("parse extension error, tag[%d] value_len[%d] out of range", tag, value_len);
+      return;
+    }
+
+    switch (tag) {
+      case TinyPBProtocol::EXT_TIMEOUT:
+        if (value_len == sizeof(int32_t)) {
+          message->timeout_ms_ = getInt32FromNetByte(value);
+          if (message->timeout_ms_ > 0) {
+            message->deadline_ms_ = getNowMs() + message->timeout_ms_;
+          }
+        }
+        break;
+      case TinyPBProtocol::EXT_MSG_TYPE:
+        if (value_len == sizeof(uint8_t)) {
+          message->msg_type_ = static_cast<uint8_t>(value[0]);
+        }
+        break;
+      case TinyPBProtocol::EXT_PRIORITY:
+        if (value_len == sizeof(uint8_t) && static_cast<uint8_t>(value[0]) < TinyPBProtocol::PRIORITY_COUNT) {
+          message->priority_ = static_cast<uint8_t>(value[0]);
+        }
+        break;
+      case TinyPBProtocol::EXT_CLIENT_ID:
+        message->client_id_ = std::string(value, value_len);
+        break;
+      case TinyPBProtocol::EXT_CREDIT:
+        if (value_len == sizeof(int32_t)) {
+          message->credit_ = getInt32FromNetByte(value);
+        }
+        break;
+      case TinyPBProtocol::EXT_COMPRESS:
+        if (value_len == sizeof(uint8_t)) {
+          message->compress_type_ = static_cast<uint8_t>(value[0]);
+        }
+        break;
+      case TinyPBProtocol::EXT_ACCEPT_COMPRESS:
+        if (value_len == sizeof(uint8_t)) {
+          message->accept_compress_ = static_cast<uint8_t>(value[0]);
+        }
+        break;
+      case TinyPBProtocol::EXT_CHECKSUM:
+        if (value_len == sizeof(uint8_t)) {
+          message->checksum_type_ = static_cast<uint8_t>(value[0]);
+        }
+        break;
+      case TinyPBProtocol::EXT_VERSION:
+        if (value_len == sizeof(uint8_t)) {
+          message->max_version_ = static_cast<uint8_t>(value[0]);
+        }
+        break;
+      case TinyPBProtocol::EXT_MAX_FRAME:
+        if (value_len == sizeof(int32_t)) {
+          message->max_frame_size_ = getInt32FromNetByte(value);
+        }
+        break;
+      case TinyPBProtocol::EXT_FEATURES:
+        if (value_len == sizeof(uint8_t)) {
+          message->features_ = static_cast<uint8_t>(value[0]);
+        }
+        break;
+      case TinyPBProtocol::EXT_METHOD_ID:
+        if (value_len == sizeof(uint32_t)) {
+          message->method_id_ = static_cast<uint32_t>(getInt32FromNetByte(value));
+        }
+        break;
+      case TinyPBProtocol::EXT_TRACE_ID:
+        message->msg_id_.assign(value, value_len);
+        break;
+      default:
+        // 不认识的扩展字段直接跳过，便于以后继续扩展
+        DEBUGLOG("skip unknown extension tag[%d]", tag);
+        break;
+    }
+  }
+}
+
+void TinyPBCoder::encodeExtension(std::shared_ptr<TinyPBProtocol> message, bool method_id, std::string& out) {
+  if (method_id) {
+    int32_t method_id_net = htonl(message->method_id_);
+    out.push_back(static_cast<char>(TinyPBProtocol::EXT_METHOD_ID));
+    out.push_back(static_cast<char>(sizeof(method_id_net)));
+    out.append(reinterpret_cast<const char*>(&method_id_net), sizeof(method_id_net));
+  }
+  if (message->timeout_ms_ > 0) {
+    int32_t timeout_net = htonl(message->timeout_ms_);
+    out.push_back(static_cast<char>(TinyPBProtocol::EXT_TIMEOUT));
+    out.push_back(static_cast<char>(sizeof(timeout_net)));
+    out.append(reinterpret_cast<const char*>(&timeout_net), sizeof(timeout_net));
+  }
+  if (message->msg_type_ != TinyPBProtocol::MSG_NORMAL) {
+    out.push_back(static_cast<char>(TinyPBProtocol::EXT_MSG_TYPE));
+    out.push_back(static_cast<char>(sizeof(uint8_t)));
+    out.push_back(static_cast<char>(message->msg_type_));
+  }
+  if (message->priority_ != TinyPBProtocol::PRIORITY_NORMAL) {
+    out.push_back(static_cast<char>(TinyPBProtocol::EXT_PRIORITY));
+    out.push_back(static_cast<char>(sizeof(uint8_t)));
+    out.push_back(static_cast<char>(message->priority_));
+  }
+  if (message->credit_ > 0) {
+    int32_t credit_net = htonl(message->credit_);
+    out.push_back(static_cast<char>(TinyPBProtocol::EXT_CREDIT));
+    out.push_back(static_cast<char>(sizeof(credit_net)));
+    out.append(reinterpret_cast<const char*>(&credit_net), sizeof(credit_net));
+  }
+  if (message->accept_compress_ != 0) {
+    out.push_back(static_cast<char>(TinyPBProtocol::EXT_ACCEPT_COMPRESS));
+    out.push_back(static_cast<char>(sizeof(uint8_t)));
+    out.push_back(static_cast<char>(message->accept_compress_));
+  }
+  if (message->max_version_ > TinyPBProtocol::VERSION_1) {
+    out.push_back(static_cast<char>(TinyPBProtocol::EXT_VERSION));
+    out.push_back(static_cast<char>(sizeof(uint8_t)));
+    out.push_back(static_cast<char>(message->max_version_));
+  }
+  if (message->max_frame_size_ > 0) {
+    int32_t max_frame_size_net = htonl(message->max_frame_size_);
+    out.push_back(static_cast<char>(TinyPBProtocol::EXT_MAX_FRAME));
+    out.push_back(static_cast<char>(sizeof(max_frame_size_net)));
+    out.append(reinterpret_cast<const char*>(&max_frame_size_net), sizeof(max_frame_size_net));
+  }
+  if (message->features_ != 0) {
+    out.push_back(static_cast<char>(TinyPBProtocol::EXT_FEATURES));
+    out.push_back(static_cast<char>(sizeof(uint8_t)));
+    out.push_back(static_cast<char>(message->features_));
+  }
+  if (message->checksum_type_ != TinyPBProtocol::CHECKSUM_NONE) {
+    out.push_back(static_cast<char>(TinyPBProtocol::EXT_CHECKSUM));
+    out.push_back(static_cast<char>(sizeof(uint8_t)));
+    out.push_back(static_cast<char>(message->checksum_type_));
+  }
+  // 长度只有一个字节，过长的标识不编码
+  if (!message->client_id_.empty() && message->client_id_.length() <= 255) {
+    out.push_back(static_cast<char>(TinyPBProtocol::EXT_CLIENT_ID));
+    out.push_back(static_cast<char>(message->client_id_.length()));
+    out.append(message->client_id_);
+  }
+  // 旧版本的 msg_id 已经在 msg_id 字段中
+  if (!message->msg_id_.empty() && message->msg_id_.length() <= 255 && !legacyId(*message)) {
+    out.push_back(static_cast<char>(TinyPBProtocol::EXT_TRACE_ID));
+    out.push_back(static_cast<char>(message->msg_id_.length()));
+    out.append(message->msg_id_);
+  }
+}
+
+const Compressor* TinyPBCoder::selectCompressor(const std::shared_ptr<TinyPBProtocol>& message) const {
+  if (local_mask_ == 0 || !peer_known_.load(std::memory_order_acquire)
+      || static_cast<int>(message->pb_data_.length()) < threshold_) {
+    return nullptr;
+  }
+  uint8_t peer_mask = peer_mask_.load(std::memory_order_relaxed);
+  for (uint8_t type : preferred_) {
+    if (peer_mask & (1 << type)) {
+      return CompressorRegistry::GetInstance()->get(type);
+    }
+  }
+  return nullptr;
+}
+
+std::shared_ptr<TinyPBProtocol> TinyPBCoder::makeHello() {
+  std::shared_ptr<TinyPBProtocol> hello = ObjectPool<TinyPBProtocol>::Get();
+  hello->req_id_ = TinyPBProtocol::HELLO_REQ_ID;
+  hello->msg_type_ = TinyPBProtocol::MSG_HELLO;
+  hello->max_frame_size_ = max_frame_size_;
+  hello->features_ = TinyPBProtocol::FEATURE_BATCH | TinyPBProtocol::FEATURE_STREAM;
+  if (verify_checksum_) {
+    hello->features_ |= TinyPBProtocol::FEATURE_VERIFY_CHECKSUM;
+  }
+  return hello;
+}
+
+ProtocolFeatures TinyPBCoder::applyHello(const TinyPBProtocol& peer_hello) {
+  ProtocolFeatures features;
+  features.negotiated = true;
+  features.version = std::max<uint8_t>(TinyPBProtocol::VERSION_1, std::min(peer_hello.max_version_, max_version_));
+  features.codecs = peer_hello.accept_compress_ & local_mask_;
+  features.peer_max_frame_size = peer_hello.max_frame_size_;
+  features.peer_features = peer_hello.features_;
+
+  peer_version_.store(features.version, std::memory_order_relaxed);
+  peer_mask_.store(features.codecs, std::memory_order_relaxed);
+  peer_max_frame_size_.store(features.peer_max_frame_size, std::memory_order_relaxed);
+  send_method_id_.store(method_id_enable_ && (features.peer_features & TinyPBProtocol::FEATURE_METHOD_ID), std::memory_order_relaxed);
+  if (!(features.peer_features & TinyPBProtocol::FEATURE_VERIFY_CHECKSUM)) {
+    write_checksum_.store(false, std::memory_order_relaxed);
+  }
+  // 握手已经交换了全部能力，不需要再在报文中携带
+  advertised_.store(true, std::memory_order_relaxed);
+  peer_known_.store(true, std::memory_order_release);
+  return features;
+}
+
+ProtocolFeatures TinyPBCoder::applyLegacy() {
+  ProtocolFeatures features;
+  features.negotiated = true;
+  // 旧版本不校验也不解析扩展字段
+  write_checksum_.store(false, std::memory_order_relaxed);
+  advertised_.store(true, std::memory_order_relaxed);
+  peer_known_.store(true, std::memory_order_release);
+  return features;
+}
+
+bool TinyPBCoder::shouldAdvertise() {
+  if (local_mask_ == 0 && max_version_ <= TinyPBProtocol::VERSION_1) {
+    return false;
+  }
+  // 对端可能还不知道本端的能力，一直携带，直到收到对端掩码后再发送一次
+  if (!peer_known_.load(std::memory_order_acquire)) {
+    return true;
+  }
+  return !advertised_.exchange(true, std::memory_order_relaxed);
+}
+
+bool TinyPBCoder::sendMethodId(const std::shared_ptr<TinyPBProtocol>& message) const {
+  return message->method_id_ != 0 && send_method_id_.load(std::memory_order_relaxed);
+}
+
+bool TinyPBCoder::decompressData(std::shared_ptr<TinyPBProtocol> message, const char* data, int len) {
+  const Compressor* compressor = CompressorRegistry::GetInstance()->get(message->compress_type_);
+  if (compressor == nullptr || len < static_cast<int>(sizeof(int32_t))) {
+    return false;
+  }
+  // raw_len 由对端填写，按本端可以接收的最大报文限制，解压后的数据不能超过一个未压缩报文允许的大小
+  int32_t raw_len = getInt32FromNetByte(data);
+  int32_t max_raw_len = max_frame_size_ > 0 ? max_frame_size_ : kMaxDecompressLength;
+  if (raw_len < 0 || raw_len > max_raw_len) {
+    ERRORLOG("decompressed length[%d] exceeds limit[%d]", raw_len, max_raw_len);
+    return false;
+  }
+  message->pb_data_.resize(raw_len);
+  return compressor->decompress(data + sizeof(int32_t), len - sizeof(int32_t), &message->pb_data_[0], raw_len);
+}
+
+static void appendInt32(std::string& out, int32_t value) {
+  int32_t value_net = htonl(value);
+  out.append(reinterpret_cast<const char*>(&value_net), sizeof(value_net));
+}
+
+static void appendString(std::string& out, const std::string& value) {
+  appendInt32(out, value.length());
+  out.append(value);
+}
+
+static bool readInt32(const std::string& in, size_t& pos, int32_t& value) {
+  if (pos + sizeof(int32_t) > in.length()) {
+    return false;
+  }
+  value = getInt32FromNetByte(&in[pos]);
+  pos += sizeof(int32_t);
+  return true;
+}
+
+static void appendReqId(std::string& out, const TinyPBProtocol& message) {
+  if (legacyId(message)) {
+    appendString(out, message.legacy_id_);
+    return;
+  }
+  char buf[kMaxReqIdDigits];
+  int len = formatReqId(message.req_id_, buf);
+  appendInt32(out, len);
+  out.append(buf, len);
+}
+
+static bool readReqId(const std::string& in, size_t& pos, TinyPBProtocol& message, uint32_t& legacy_seq) {
+  int32_t len = 0;
+  if (!readInt32(in, pos, len) || len < 0 || pos + len > in.length()) {
+    return false;
+  }
+  setReqId(message, &in[pos], len, legacy_seq);
+  pos += len;
+  return true;
+}
+
+static bool readString(const std::string& in, size_t& pos, std::string& value) {
+  int32_t len = 0;
+  if (!readInt32(in, pos, len) || len < 0 || pos + len > in.length()) {
+    return false;
+  }
+  value.assign(&in[pos], len);
+  pos += len;
+  return true;
+}
+
+void TinyPBCoder::encodeBatch(const std::vector<std::shared_ptr<TinyPBProtocol>>& calls, std::string& out) {
+  size_t total = 0;
+  for (auto& call : calls) {
+    total += 20 + kMaxReqIdDigits + call->method_name_.length() + call->err_info_.length() + call->pb_data_.length();
+  }
+  out.reserve(out.length() + total);
+
+  for (auto& call : calls) {
+    appendReqId(out, *call);
+    appendString(out, call->method_name_);
+    appendInt32(out, call->err_code_);
+    appendString(out, call->err_info_);
+    appendString(out, call->pb_data_);
+  }
+}
+
+bool TinyPBCoder::decodeBatch(const std::string& in, std::vector<std::shared_ptr<TinyPBProtocol>>& calls) {
+  size_t pos = 0;
+  // 子调用不登记为在途请求，本地请求号只需在批量帧内唯一
+  uint32_t legacy_seq = 0;
+  while (pos < in.length()) {
+    std::shared_ptr<TinyPBProtocol> call = ObjectPool<TinyPBProtocol>::Get();
+    if (!readReqId(in, pos, *call, legacy_seq)
+        || !readString(in, pos, call->method_name_)
+        || !readInt32(in, pos, call->err_code_)
+        || !readString(in, pos, call->err_info_)
+        || !readString(in, pos, call->pb_data_)) {
+      ERRORLOG("parse batch error, call[%lu] out of range", calls.size());
+      return false;
+    }
+    call->method_name_len_ = call->method_name_.length();
+    call->err_info_len_ = call->err_info_.length();
+    call->parse_success = true;
+    calls.push_back(call);
+  }
+  return true;
+}
+
+const Compressor* TinyPBCoder::prepareEncode(std::shared_ptr<TinyPBProtocol> message, bool v2, bool by_id,
+    std::string& extension, int& compress_flag_index, int& pb_data_bound) {
+  const Compressor* compressor = selectCompressor(message);
+  message->compress_type_ = COMPRESS_NONE;
+  // 握手帧总是携带本端的全部能力
+  bool advertise = (message->msg_type_ == TinyPBProtocol::MSG_HELLO) || shouldAdvertise();
+  message->accept_compress_ = advertise ? local_mask_ : 0;
+  message->max_version_ = advertise ? max_version_ : 0;
+  // v2 报文在固定头部的 flags 中标记校验和
+  message->checksum_type_ = (write_checksum_.load(std::memory_order_relaxed) && !v2) ? TinyPBProtocol::CHECKSUM_CRC32C : TinyPBProtocol::CHECKSUM_NONE;
+
+  // v2 报文的方法 id 在固定位置，v1 报文通过扩展字段携带
+  encodeExtension(message, by_id && !v2, extension);
+  // 压缩标记放在扩展字段最后，压缩失败或没有收益时原地改为 COMPRESS_NONE，长度不变
+  compress_flag_index = -1;
+  if (compressor != nullptr) {
+    extension.push_back(static_cast<char>(TinyPBProtocol::EXT_COMPRESS));
+    extension.push_back(static_cast<char>(sizeof(uint8_t)));
+    compress_flag_index = extension.length();
+    extension.push_back(static_cast<char>(compressor->type()));
+  }
+  // 压缩结果直接写入报文缓冲区，先按最大长度申请，编码完成后再修正包长
+  pb_data_bound = message->pb_data_.length();
+  if (compressor != nullptr) {
+    pb_data_bound = std::max<int>(pb_data_bound, sizeof(int32_t) + compressor->maxCompressedLength(message->pb_data_.length()));
+  }
+  return compressor;
+}
+
+int TinyPBCoder::writePbData(std::shared_ptr<TinyPBProtocol> message, const Compressor* compressor, char* out, char* compress_flag) {
+  int pb_data_len = message->pb_data_.length();
+  if (compressor != nullptr) {
+    size_t out_len = 0;
+    if (compressor->compress(message->pb_data_.data(), pb_data_len, out + sizeof(int32_t), out_len)
+        && sizeof(int32_t) + out_len < static_cast<size_t>(pb_data_len)) {
+      int32_t raw_len_net = htonl(pb_data_len);
+      memcpy(out, &raw_len_net, sizeof(raw_len_net));
+      CompressorRegistry::GetInstance()->recordCompressed(compressor->type(), pb_data_len, sizeof(int32_t) + out_len);
+      message->compress_type_ = compressor->type();
+      return sizeof(int32_t) + out_len;
+    }
+    *compress_flag = static_cast<char>(COMPRESS_NONE);
+  }
+  if (!message->pb_data_.empty()) {
+    memcpy(out, &(message->pb_data_[0]), pb_data_len);
+  }
+  return pb_data_len;
+}
+
 const char* TinyPBCoder::encodeTinyPB(std::shared_ptr<TinyPBProtocol> message, int& len) {
-  if (message->msg_id_.empty()) {
-    message->msg_id_ = "123456789";
+  DEBUGLOG("req_id = %lu", message->req_id_);
+
+  if (peer_version_.load(std::memory_order_acquire) >= TinyPBProtocol::VERSION_2) {
+    return encodeTinyPBV2(message, len);
+  }
+
+  std::string extension;
+  int compress_flag_index = -1;
+  int pb_data_bound = 0;
+  // 对端可以按方法 id 分发时只发送 id，不发送方法名
+  bool by_id = sendMethodId(message);
+  const Compressor* compressor = prepareEncode(message, false, by_id, extension, compress_flag_index, pb_data_bound);
+  // 有扩展字段时，method_name 字段编码为 method_name + '\0' + extension
+  int method_name_len = by_id ? 0 : message->method_name_.length();
+  if (!extension.empty()) {
+    method_name_len += 1 + extension.length();
+  }
+
+  // v1 报文的 msg_id 字段为 req_id 的十进制字符串
+  char req_id_buf[kMaxReqIdDigits];
+  const char* msg_id = req_id_buf;
+  int msg_id_len = 0;
+  if (legacyId(*message)) {
+    msg_id = message->legacy_id_.data();
+    msg_id_len = message->legacy_id_.length();
+  } else {
+    msg_id_len = formatReqId(message->req_id_, req_id_buf);
   }
-  DEBUGLOG("msg_id = %s", message->msg_id_.c_str());
-  int pk_len = 2 + 24 + message->msg_id_.length() + message->method_name_.length() + message->err_info_.length() + message->pb_data_.length();
+
+  int pk_len = 2 + 24 + msg_id_len + method_name_len + message->err_info_.length() + pb_data_bound;
   DEBUGLOG("pk_len = %d", pk_len);
 
   char* buf = reinterpret_cast<char*>(malloc(pk_len));
   char* tmp = buf;
+  char* compress_flag = NULL;
 
   *tmp = TinyPBProtocol::PB_START;
   tmp++;
@@ -158,24 +922,29 @@ const char* TinyPBCoder::encodeTinyPB(std::shared_ptr<TinyPBProtocol> message, i
   memcpy(tmp, &pk_len_net, sizeof(pk_len_net));
   tmp += sizeof(pk_len_net);
 
-  int msg_id_len = message->msg_id_.length();
   int32_t msg_id_len_net = htonl(msg_id_len);
   memcpy(tmp, &msg_id_len_net, sizeof(msg_id_len_net));
   tmp += sizeof(msg_id_len_net);
 
-  if (!message->msg_id_.empty()) {
-    memcpy(tmp, &(message->msg_id_[0]), msg_id_len);
-    tmp += msg_id_len;
-  }
+  memcpy(tmp, msg_id, msg_id_len);
+  tmp += msg_id_len;
 
-  int method_name_len = message->method_name_.length();
   int32_t method_name_len_net = htonl(method_name_len);
   memcpy(tmp, &method_name_len_net, sizeof(method_name_len_net));
   tmp += sizeof(method_name_len_net);
 
-  if (!message->method_name_.empty()) {
-    memcpy(tmp, &(message->method_name_[0]), method_name_len);
-    tmp += method_name_len;
+  if (!by_id && !message->method_name_.empty()) {
+    memcpy(tmp, &(message->method_name_[0]), message->method_name_.length());
+    tmp += message->method_name_.length();
+  }
+  if (!extension.empty()) {
+    *tmp = '\0';
+    tmp++;
+    memcpy(tmp, &extension[0], extension.length());
+    if (compress_flag_index >= 0) {
+      compress_flag = tmp + compress_flag_index;
+    }
+    tmp += extension.length();
   }
 
   int32_t err_code_net = htonl(message->err_code_);
@@ -192,12 +961,21 @@ const char* TinyPBCoder::encodeTinyPB(std::shared_ptr<TinyPBProtocol> message, i
     tmp += err_info_len;
   }
 
-  if (!message->pb_data_.empty()) {
-    memcpy(tmp, &(message->pb_data_[0]), message->pb_data_.length());
-    tmp += message->pb_data_.length();
-  }
+  int pb_data_len = writePbData(message, compressor, tmp, compress_flag);
+  tmp += pb_data_len;
+
+  // 按实际写入的 pb_data 长度修正包长
+  pk_len = pk_len - pb_data_bound + pb_data_len;
+  pk_len_net = htonl(pk_len);
+  memcpy(buf + sizeof(char), &pk_len_net, sizeof(pk_len_net));
 
-  int32_t check_sum_net = htonl(1);
+  // 校验和覆盖 PB_START 之后、check_sum 之前的所有字节
+  int32_t check_sum = 1;
+  if (message->checksum_type_ == TinyPBProtocol::CHECKSUM_CRC32C) {
+    check_sum = static_cast<int32_t>(crc32c(buf + sizeof(char), tmp - buf - sizeof(char)));
+  }
+  message->check_sum_ = check_sum;
+  int32_t check_sum_net = htonl(check_sum);
   memcpy(tmp, &check_sum_net, sizeof(check_sum_net));
   tmp += sizeof(check_sum_net);
 
@@ -210,10 +988,121 @@ const char* TinyPBCoder::encodeTinyPB(std::shared_ptr<TinyPBProtocol> message, i
   message->parse_success = true;
   len = pk_len;
 
-  DEBUGLOG("encode message[%s] success", message->msg_id_.c_str());
+  DEBUGLOG("encode message[%lu] success", message->req_id_);
 
   return buf;
 }
 
 
-}
\ No newline at end of file
+const char* TinyPBCoder::encodeTinyPBV2(std::shared_ptr<TinyPBProtocol> message, int& len) {
+  std::string extension;
+  int compress_flag_index = -1;
+  int pb_data_bound = 0;
+  bool by_id = sendMethodId(message);
+  const Compressor* compressor = prepareEncode(message, true, by_id, extension, compress_flag_index, pb_data_bound);
+
+  // 空的可选字段不占字节
+  uint8_t flags = 0;
+  if (!legacyId(*message)) {
+    flags |= TinyPBProtocol::V2_BINARY_ID;
+  }
+  if (by_id) {
+    flags |= TinyPBProtocol::V2_METHOD_ID;
+  } else if (!message->method_name_.empty()) {
+    flags |= TinyPBProtocol::V2_METHOD;
+  }
+  if (message->err_code_ != 0 || !message->err_info_.empty()) {
+    flags |= TinyPBProtocol::V2_ERROR;
+  }
+  if (!extension.empty()) {
+    flags |= TinyPBProtocol::V2_EXT;
+  }
+  if (write_checksum_.load(std::memory_order_relaxed)) {
+    flags |= TinyPBProtocol::V2_CHECKSUM;
+  }
+
+  // 每个 varint 最多 10 字节，先按上限申请，编码完成后再写入实际长度
+  const int kMaxVarintLen = 10;
+  int bound = TinyPBProtocol::V2_HEADER_LEN + pb_data_bound + sizeof(int32_t);
+  bound += (flags & TinyPBProtocol::V2_BINARY_ID) ? sizeof(uint64_t) : kMaxVarintLen + message->legacy_id_.length();
+  bound += by_id ? sizeof(uint32_t) : kMaxVarintLen + message->method_name_.length();
+  bound += 2 * kMaxVarintLen + message->err_info_.length();
+  bound += kMaxVarintLen + extension.length();
+
+  char* buf = reinterpret_cast<char*>(malloc(bound));
+  char* tmp = buf;
+  char* compress_flag = NULL;
+
+  *tmp++ = TinyPBProtocol::PB_V2_MAGIC;
+  *tmp++ = static_cast<char>(TinyPBProtocol::VERSION_2);
+  *tmp++ = static_cast<char>(flags);
+  tmp += sizeof(int32_t);
+
+  if (flags & TinyPBProtocol::V2_BINARY_ID) {
+    for (int i = sizeof(uint64_t) - 1; i >= 0; --i) {
+      *tmp++ = static_cast<char>(message->req_id_ >> (i * 8));
+    }
+  } else {
+    tmp = writeVarint(tmp, message->legacy_id_.length());
+    memcpy(tmp, message->legacy_id_.data(), message->legacy_id_.length());
+    tmp += message->legacy_id_.length();
+  }
+
+  if (flags & TinyPBProtocol::V2_METHOD_ID) {
+    for (int i = sizeof(uint32_t) - 1; i >= 0; --i) {
+      *tmp++ = static_cast<char>(message->method_id_ >> (i * 8));
+    }
+  }
+
+  if (flags & TinyPBProtocol::V2_METHOD) {
+    tmp = writeVarint(tmp, message->method_name_.length());
+    memcpy(tmp, message->method_name_.data(), message->method_name_.length());
+    tmp += message->method_name_.length();
+  }
+
+  if (flags & TinyPBProtocol::V2_ERROR) {
+    uint32_t err_code = static_cast<uint32_t>(message->err_code_);
+    tmp = writeVarint(tmp, (err_code << 1) ^ static_cast<uint32_t>(message->err_code_ >> 31));
+    tmp = writeVarint(tmp, message->err_info_.length());
+    memcpy(tmp, message->err_info_.data(), message->err_info_.length());
+    tmp += message->err_info_.length();
+  }
+
+  if (flags & TinyPBProtocol::V2_EXT) {
+    tmp = writeVarint(tmp, extension.length());
+    memcpy(tmp, extension.data(), extension.length());
+    if (compress_flag_index >= 0) {
+      compress_flag = tmp + compress_flag_index;
+    }
+    tmp += extension.length();
+  }
+
+  tmp += writePbData(message, compressor, tmp, compress_flag);
+
+  int frame_len = tmp - buf + ((flags & TinyPBProtocol::V2_CHECKSUM) ? sizeof(int32_t) : 0);
+  int32_t frame_len_net = htonl(frame_len);
+  memcpy(buf + 3, &frame_len_net, sizeof(frame_len_net));
+
+  // 校验和覆盖头部到 pb_data 结尾
+  message->check_sum_ = 0;
+  if (flags & TinyPBProtocol::V2_CHECKSUM) {
+    message->check_sum_ = static_cast<int32_t>(crc32c(buf, tmp - buf));
+    int32_t check_sum_net = htonl(message->check_sum_);
+    memcpy(tmp, &check_sum_net, sizeof(check_sum_net));
+    tmp += sizeof(check_sum_net);
+  }
+
+  message->pk_len_ = frame_len;
+  message->msg_id_len_ = (flags & TinyPBProtocol::V2_BINARY_ID) ? sizeof(uint64_t) : message->legacy_id_.length();
+  message->method_name_len_ = message->method_name_.length();
+  message->err_info_len_ = message->err_info_.length();
+  message->parse_success = true;
+  len = frame_len;
+
+  DEBUGLOG("encode v2 message[%lu] success, frame_len[%d]", message->req_id_, frame_len);
+
+  return buf;
+}
+
+
+}
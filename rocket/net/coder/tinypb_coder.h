@@ -3,25 +3,113 @@
 
 #include "rocket/net/coder/abstract_coder.h"
 #include "rocket/net/coder/tinypb_protocol.h"
+#include "rocket/net/coder/compressor.h"
+#include <atomic>
 
 namespace rocket {
 
+// 连接握手协商出的特性，双方都没有握手时保持默认值(旧版本 v1 协议)
+struct ProtocolFeatures {
+  bool negotiated {false};       // 是否已经完成握手(包括对端不支持握手的情况)
+  uint8_t version {TinyPBProtocol::VERSION_1};  // 发送时使用的报文版本
+  uint8_t codecs {0};            // 发送时可以使用的压缩算法掩码
+  int32_t peer_max_frame_size {0};  // 对端可以接收的最大报文，0 表示不限制
+  uint8_t peer_features {0};     // 对端的特性位，见 TinyPBProtocol::Feature
+};
+
 class TinyPBCoder : public AbstractCoder {
 
  public:
 
-  TinyPBCoder() {}
+  TinyPBCoder();
   ~TinyPBCoder() {}
 
+  // 是否校验收到的报文，本机回环等可信连接可以关闭，需要在握手之前设置
+  void setVerifyChecksum(bool verify) { verify_checksum_ = verify; }
+
+  // 本端的握手帧
+  std::shared_ptr<TinyPBProtocol> makeHello();
+
+  // 根据对端的握手帧协商特性，之后的编码按协商结果进行
+  ProtocolFeatures applyHello(const TinyPBProtocol& peer_hello);
+
+  // 对端不支持握手，按旧版本协议通信
+  ProtocolFeatures applyLegacy();
+
   // 将 message 对象转化为字节流，写入到 buffer
   void encode(std::vector<AbstractProtocol::s_ptr>& messages, TcpBuffer& out_buffer);
 
   // 将 buffer 里面的字节流转换为 message 对象
   void decode(std::vector<AbstractProtocol::s_ptr>& out_messages, TcpBuffer& buffer);
 
+  // 批量帧的 pb_data 编解码，每个调用依次编码为
+  // [msg_id_len][msg_id][method_name_len][method_name][err_code][err_info_len][err_info][pb_data_len][pb_data]
+  // 整数均为 int32 网络字节序，msg_id 为 req_id 的十进制字符串，
+  // 请求只使用 msg_id、method_name、pb_data，响应只使用 msg_id、err_code、err_info、pb_data
+  static void encodeBatch(const std::vector<std::shared_ptr<TinyPBProtocol>>& calls, std::string& out);
+
+  static bool decodeBatch(const std::string& in, std::vector<std::shared_ptr<TinyPBProtocol>>& calls);
+
  private:
   const char* encodeTinyPB(std::shared_ptr<TinyPBProtocol> message, int& len);
 
+  const char* encodeTinyPBV2(std::shared_ptr<TinyPBProtocol> message, int& len);
+
+  // 解码一个报文，数据不完整时返回 false
+  bool decodeV1(std::vector<AbstractProtocol::s_ptr>& out_messages, TcpBuffer& buffer);
+
+  bool decodeV2(std::vector<AbstractProtocol::s_ptr>& out_messages, TcpBuffer& buffer);
+
+  bool parseV2(std::shared_ptr<TinyPBProtocol> message, const char* data, int frame_len, uint8_t flags);
+
+  // 两个版本共用的编码步骤：协商字段、扩展字段、压缩算法和 pb_data 的长度上限
+  const Compressor* prepareEncode(std::shared_ptr<TinyPBProtocol> message, bool v2, bool by_id,
+      std::string& extension, int& compress_flag_index, int& pb_data_bound);
+
+  // 写入(压缩后的) pb_data，返回写入的字节数
+  int writePbData(std::shared_ptr<TinyPBProtocol> message, const Compressor* compressor, char* out, char* compress_flag);
+
+  // 从对端报文中学习对端支持的压缩算法和报文版本
+  void learnPeer(const std::shared_ptr<TinyPBProtocol>& message, uint8_t frame_version);
+
+  // 扩展字段编解码，格式见 TinyPBProtocol::ExtTag
+  // method_id 为 true 时携带 EXT_METHOD_ID
+  void encodeExtension(std::shared_ptr<TinyPBProtocol> message, bool method_id, std::string& out);
+
+  void decodeExtension(std::shared_ptr<TinyPBProtocol> message, const char* buf, int len);
+
+  // 按本端的优先级选择对端支持的压缩算法，不需要压缩时返回 nullptr
+  const Compressor* selectCompressor(const std::shared_ptr<TinyPBProtocol>& message) const;
+
+  // 本次编码是否需要携带本端支持的压缩算法
+  bool shouldAdvertise();
+
+  // 对端可以按方法 id 分发并且报文带有 id 时，只发送 id 不发送方法名
+  bool sendMethodId(const std::shared_ptr<TinyPBProtocol>& message) const;
+
+  // 解压 pb_data，失败返回 false
+  bool decompressData(std::shared_ptr<TinyPBProtocol> message, const char* data, int len);
+
+ private:
+  // 协商状态，每个连接一个编码器。解码在 IO 线程，编码可能在业务线程
+  uint8_t local_mask_ {0};                 // 本端可以解压的算法，未开启压缩时为 0
+  std::vector<uint8_t> preferred_;         // 发送时的算法优先级
+  int threshold_ {0};
+
+  std::atomic<bool> write_checksum_ {true};   // 对端不校验时不计算校验和
+  bool verify_checksum_ {true};
+  uint32_t legacy_seq_ {0};                   // 为旧版本 msg_id 分配本地请求号，只在解码时使用
+
+  uint8_t max_version_ {TinyPBProtocol::VERSION_2};            // 本端支持的最高报文版本
+  int32_t max_frame_size_ {0};                                 // 本端可以接收的最大报文
+  std::atomic<int32_t> peer_max_frame_size_ {0};
+  bool method_id_enable_ {true};                                // 对端支持时是否只发送方法 id
+  std::atomic<bool> send_method_id_ {false};
+  std::atomic<uint8_t> peer_version_ {TinyPBProtocol::VERSION_1}; // 协商后的编码版本
+  std::atomic<uint8_t> peer_mask_ {0};     // 对端可以解压的算法
+  std::atomic<bool> peer_known_ {false};   // 是否已经收到对端的算法掩码
+  std::atomic<bool> advertised_ {false};   // 收到对端掩码之后是否已经向对端发送过本端掩码
+
 };
 
 
@@ -4,5 +4,47 @@ namespace rocket {
 
 char TinyPBProtocol::PB_START = 0x02;
 char TinyPBProtocol::PB_END = 0x03;
+char TinyPBProtocol::PB_V2_MAGIC = static_cast<char>(0xb2);
+
+static void clearString(std::string& str) {
+  if (str.capacity() > TinyPBProtocol::kMaxKeepBytes) {
+    std::string().swap(str);
+  } else {
+    str.clear();
+  }
+}
+
+void TinyPBProtocol::reset() {
+  req_id_ = 0;
+  clearString(msg_id_);
+  pk_len_ = 0;
+  msg_id_len_ = 0;
+  clearString(legacy_id_);
+  method_name_len_ = 0;
+  clearString(method_name_);
+  err_code_ = 0;
+  err_info_len_ = 0;
+  clearString(err_info_);
+  clearString(pb_data_);
+  check_sum_ = 0;
+
+  timeout_ms_ = 0;
+  msg_type_ = MSG_NORMAL;
+  priority_ = PRIORITY_NORMAL;
+  clearString(client_id_);
+  credit_ = 0;
+  compress_type_ = 0;
+  accept_compress_ = 0;
+  checksum_type_ = CHECKSUM_NONE;
+  max_version_ = 0;
+  max_frame_size_ = 0;
+  features_ = 0;
+  method_id_ = 0;
+
+  deadline_ms_ = 0;
+  arrive_us_ = 0;
+  method_index_ = -1;
+  parse_success = false;
+}
 
 }
\ No newline at end of file
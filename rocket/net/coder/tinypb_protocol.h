@@ -1,7 +1,9 @@
 #ifndef ROCKET_NET_CODER_TINYPB_PROTOCOL_H
 #define ROCKET_NET_CODER_TINYPB_PROTOCOL_H 
 
+#include <cstdint>
 #include <string>
+#include "rocket/common/object_pool.h"
 #include "rocket/net/coder/abstract_protocol.h"
 
 namespace rocket {
@@ -14,11 +16,102 @@ struct TinyPBProtocol : public AbstractProtocol {
  public:
   static char PB_START;
   static char PB_END;
+  static char PB_V2_MAGIC;
+
+  // 报文格式版本
+  // v1: [PB_START][pk_len:4][msg_id_len:4][msg_id][method_name_len:4][method_name][err_code:4]
+  //     [err_info_len:4][err_info][pb_data][check_sum:4][PB_END]
+  //     msg_id 字段为 req_id 的十进制字符串，与旧版本兼容
+  // v2: [PB_V2_MAGIC][version:1][flags:1][frame_len:4] 之后依次为
+  //     req_id(V2_BINARY_ID 时为 8 字节大端整数，否则为旧版本的 varint 长度 + 字符串)、
+  //     method_name(varint 长度 + 字符串)、err_code(zigzag varint) + err_info(varint 长度 + 字符串)、
+  //     扩展字段(varint 长度 + TLV)、pb_data(剩余部分)、check_sum:4，
+  //     除 req_id 外的字段只有 flags 中对应位置位时才出现，check_sum 覆盖头部到 pb_data 结尾
+  //     V2_METHOD_ID 置位时 method_name 之前(或代替 method_name)为 4 字节大端的方法 id
+  // 解码时按首字节自动识别版本，编码时使用双方都支持的最高版本，见 EXT_VERSION
+  enum Version : uint8_t {
+    VERSION_1 = 1,
+    VERSION_2 = 2,
+  };
+
+  static const int V2_HEADER_LEN = 7;
+
+  enum V2Flag : uint8_t {
+    V2_BINARY_ID = 0x01,
+    V2_METHOD = 0x02,
+    V2_ERROR = 0x04,
+    V2_EXT = 0x08,
+    V2_CHECKSUM = 0x10,
+    V2_METHOD_ID = 0x20,
+  };
+
+  // 扩展字段 tag
+  // 扩展字段以 [tag:1][len:1][value:len] 的形式追加在 method_name 之后，中间以 '\0' 分隔，
+  // 旧版本解码 method_name 时遇到 '\0' 截断，会忽略扩展字段，从而保持兼容
+  enum ExtTag : uint8_t {
+    EXT_TIMEOUT = 1,   // 请求剩余超时时间(ms)，int32 网络字节序
+    EXT_MSG_TYPE = 2,  // 帧类型，uint8，缺省为普通请求/响应
+    EXT_PRIORITY = 3,  // 请求优先级，uint8，缺省为 PRIORITY_NORMAL
+    EXT_CLIENT_ID = 4, // 调用方标识，字符串，服务端据此做公平调度
+    EXT_CREDIT = 5,    // 流控额度，int32 网络字节序，对端还可以再发送的消息数
+    EXT_COMPRESS = 6,  // pb_data 的压缩算法，uint8，见 CompressType，压缩后的 pb_data 为 [原始长度:4][压缩数据]
+    EXT_ACCEPT_COMPRESS = 7, // 本端可以解压的算法掩码，uint8，用于按连接协商压缩算法
+    EXT_CHECKSUM = 8,  // 校验和算法，uint8，见 ChecksumType，没有该字段时 check_sum 为旧版本的固定值
+    EXT_VERSION = 9,   // 本端可以解码的最高报文版本，uint8，用于按连接协商报文格式
+    EXT_MAX_FRAME = 10, // 本端可以接收的最大报文长度，int32 网络字节序，只在握手帧中出现
+    EXT_FEATURES = 11,  // 本端的特性位，uint8，见 Feature，只在握手帧中出现
+    EXT_METHOD_ID = 12, // 方法 id，uint32 网络字节序，见 MethodTable::MethodId，此时 method_name 可以为空
+    EXT_TRACE_ID = 13,  // trace id(msg_id_)，字符串，只用于日志关联，没有时不携带
+  };
+
+  // 帧类型
+  enum MsgType : uint8_t {
+    MSG_NORMAL = 0,    // 普通请求/响应
+    MSG_CANCEL = 1,    // 取消帧，req_id 对应的请求不再需要结果
+    MSG_BATCH = 2,     // 批量帧，pb_data 中依次编码多个调用，见 TinyPBCoder::encodeBatch
+    // 流式调用，同一个 req_id 上双向传输多条消息，见 RpcStream
+    MSG_STREAM_OPEN = 3,   // 客户端打开流，携带 method_name 和客户端的初始额度
+    MSG_STREAM_DATA = 4,   // 一条消息
+    MSG_STREAM_CREDIT = 5, // 增加对端的发送额度
+    MSG_STREAM_END = 6,    // 客户端发送完毕(半关闭)；服务端结束整个流，err_code 为最终状态
+    // 握手帧，客户端连接建立后首先发送，req_id 固定为 HELLO_REQ_ID，服务端以本端的握手帧回复
+    // 普通请求的 req_id 不会为 0(旧版本的 msg_id 也会分配本地请求号)，服务端只按帧类型识别握手帧
+    // 能力通过 EXT_VERSION、EXT_ACCEPT_COMPRESS、EXT_MAX_FRAME、EXT_FEATURES 携带
+    MSG_HELLO = 7,
+  };
+
+  static const uint64_t HELLO_REQ_ID = 0;
+
+  // 握手帧中的特性位
+  enum Feature : uint8_t {
+    FEATURE_VERIFY_CHECKSUM = 0x01,  // 本端会校验收到的报文，对端不校验时可以不计算校验和
+    FEATURE_BATCH = 0x02,
+    FEATURE_STREAM = 0x04,
+    FEATURE_METHOD_ID = 0x08,        // 本端可以按方法 id 分发请求，对端可以只发送 id 而不发送方法名
+  };
+
+  // 校验和算法，check_sum 覆盖从 pk_len 到 pb_data 结尾的所有字节
+  enum ChecksumType : uint8_t {
+    CHECKSUM_NONE = 0,
+    CHECKSUM_CRC32C = 1,
+  };
+
+  // 请求优先级，数值越小越重要
+  enum Priority : uint8_t {
+    PRIORITY_CRITICAL = 0,   // 健康检查、控制面调用，严格优先
+    PRIORITY_HIGH = 1,
+    PRIORITY_NORMAL = 2,
+    PRIORITY_LOW = 3,        // 批量任务，过载时最先丢弃
+    PRIORITY_COUNT = 4,
+  };
 
  public:
   int32_t pk_len_ {0};
   int32_t msg_id_len_ {0};
-  // msg_id 继承父类
+  // req_id、msg_id 继承父类
+  // 旧版本对端的原始 msg_id，不是合法的请求号时保存，响应中原样写回。
+  // 此时 req_id_ 为解码器在连接内分配的本地请求号，不为 0，不会与握手帧和其他请求冲突
+  std::string legacy_id_;
 
   int32_t method_name_len_ {0};
   std::string method_name_;
@@ -28,8 +121,38 @@ struct TinyPBProtocol : public AbstractProtocol {
   std::string pb_data_;
   int32_t check_sum_ {0};
 
+  // 以下为扩展字段
+  int32_t timeout_ms_ {0};     // 请求剩余的超时时间(ms)，0 表示没有 deadline
+  uint8_t msg_type_ {MSG_NORMAL};
+  uint8_t priority_ {PRIORITY_NORMAL};
+  std::string client_id_;
+  int32_t credit_ {0};
+  uint8_t compress_type_ {0};   // 由编码器根据协商结果设置，解码后 pb_data_ 已经是原始数据
+  uint8_t accept_compress_ {0};
+  uint8_t checksum_type_ {CHECKSUM_NONE};
+  uint8_t max_version_ {0};
+  int32_t max_frame_size_ {0};
+  uint8_t features_ {0};
+  uint32_t method_id_ {0};     // 0 表示没有 id，按 method_name_ 分发
+
+  // 以下字段不参与编码
+  int64_t deadline_ms_ {0};    // 服务端收到请求时根据 timeout_ms_ 计算出的本地绝对 deadline
+  int64_t arrive_us_ {0};      // 服务端解码出请求的时间(单调时钟，us)，用于计算排队时延
+  int32_t method_index_ {-1};  // 服务端解析出的方法表下标，-1 表示还没有解析
+
   bool parse_success {false};
 
+  // 对象池回收时重置所有字段，字符串保留容量，超过 kMaxKeepBytes 的缓冲区释放掉，避免大报文长期占用内存
+  void reset();
+
+  static const size_t kMaxKeepBytes = 64 * 1024;
+
+};
+
+template <>
+struct PoolTraits<TinyPBProtocol> {
+  static const char* name() { return "tinypb_protocol"; }
+  static void reset(TinyPBProtocol* obj) { obj->reset(); }
 };
 
 
@@ -31,6 +31,9 @@ class IOThread {
   // 将待启动的 TcpConnection 加入队列
   void enqueuePendingConnection(PendingConnection pending);
 
+  // 分配到本线程的连接数，用于准入控制
+  std::atomic<int>& connectionCount() { return connection_count_; }
+
  public:
   static void* Main(void* arg);
 
@@ -55,6 +58,8 @@ class IOThread {
   // 标志位：是否已经投递了处理任务（避免重复投递）
   std::atomic<bool> processing_scheduled_{false};
 
+  std::atomic<int> connection_count_{0};
+
 };
 
 }
@@ -22,6 +22,8 @@ class IOThreadGroup {
 
   IOThread* getIOThread();
 
+  int size() const { return size_; }
+
  private:
 
   int size_ {0};
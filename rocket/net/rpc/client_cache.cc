@@ -0,0 +1,125 @@
+#include "rocket/net/rpc/client_cache.h"
+#include "rocket/common/config.h"
+#include "rocket/common/util.h"
+#include "rocket/logger/log.h"
+
+namespace rocket {
+
+// 每个缓存项除 key 和响应外的固定开销(链表节点、索引项等)的估计值
+static const size_t kItemOverhead = 128;
+
+static Gauge *bytesGauge() {
+  static Gauge *gauge = MetricsRegistry::GetInstance()->getGauge("rocket_client_cache_bytes");
+  return gauge;
+}
+
+static Counter *evictionsCounter() {
+  static Counter *counter = MetricsRegistry::GetInstance()->getCounter("rocket_client_cache_evictions_total");
+  return counter;
+}
+
+ClientCache::ClientCache() {
+  ClientCacheConfig config;
+  if (Config::GetGlobalConfig()) {
+    config = Config::GetGlobalConfig()->client_cache_config_;
+  }
+  max_bytes_ = config.max_bytes > 0 ? static_cast<size_t>(config.max_bytes) : 0;
+  for (auto &it : config.methods) {
+    enableMethod(it.first, it.second.ttl_ms, it.second.stale_ms);
+  }
+}
+
+void ClientCache::enableMethod(const std::string &method_full_name, int ttl_ms, int stale_ms) {
+  if (max_bytes_ == 0 || ttl_ms <= 0) {
+    ERRORLOG("enable client cache for method[%s] failed, cache disabled or ttl[%d] invalid",
+             method_full_name.c_str(), ttl_ms);
+    return;
+  }
+  std::unique_ptr<ClientCachePolicy> policy(new ClientCachePolicy());
+  std::string label = "{method=\"" + method_full_name + "\"}";
+  policy->ttl_ms = ttl_ms;
+  policy->stale_ms = stale_ms > 0 ? stale_ms : 0;
+  policy->hits = MetricsRegistry::GetInstance()->getCounter("rocket_client_cache_hits_total" + label);
+  policy->stale_hits = MetricsRegistry::GetInstance()->getCounter("rocket_client_cache_stale_hits_total" + label);
+  policy->misses = MetricsRegistry::GetInstance()->getCounter("rocket_client_cache_misses_total" + label);
+  methods_[method_full_name] = std::move(policy);
+}
+
+ClientCache::Result ClientCache::lookup(const ClientCachePolicy &policy, const std::string &key,
+                                        std::string &pb_data, bool &refresh) {
+  refresh = false;
+  std::scoped_lock<std::mutex> lock(mutex_);
+  auto it = index_.find(key);
+  if (it == index_.end()) {
+    policy.misses->inc();
+    return Result::Miss;
+  }
+  Item &item = *it->second;
+  int64_t now = getNowMs();
+  if (item.stale_until_ms <= now) {
+    erase(it->second);
+    policy.misses->inc();
+    return Result::Miss;
+  }
+
+  lru_.splice(lru_.begin(), lru_, it->second);
+  pb_data = item.pb_data;
+  if (item.fresh_until_ms > now) {
+    policy.hits->inc();
+    return Result::Fresh;
+  }
+  if (!item.refreshing) {
+    item.refreshing = true;
+    refresh = true;
+  }
+  policy.stale_hits->inc();
+  return Result::Stale;
+}
+
+void ClientCache::insert(const ClientCachePolicy &policy, const std::string &key, const std::string &pb_data) {
+  size_t charge = key.size() * 2 + pb_data.size() + kItemOverhead;
+  if (charge > max_bytes_) {
+    return;
+  }
+
+  std::scoped_lock<std::mutex> lock(mutex_);
+  auto it = index_.find(key);
+  if (it != index_.end()) {
+    erase(it->second);
+  }
+
+  while (!lru_.empty() && bytes_ + charge > max_bytes_) {
+    erase(std::prev(lru_.end()));
+    evictionsCounter()->inc();
+  }
+
+  int64_t now = getNowMs();
+  lru_.emplace_front();
+  Item &item = lru_.front();
+  item.key = key;
+  item.pb_data = pb_data;
+  item.fresh_until_ms = now + policy.ttl_ms;
+  item.stale_until_ms = item.fresh_until_ms + policy.stale_ms;
+  item.charge = charge;
+  index_[key] = lru_.begin();
+  bytes_ += charge;
+  bytesGauge()->add(charge);
+}
+
+void ClientCache::refreshFailed(const std::string &key) {
+  // 刷新失败时保留旧结果，之后命中的调用重新发起刷新
+  std::scoped_lock<std::mutex> lock(mutex_);
+  auto it = index_.find(key);
+  if (it != index_.end()) {
+    it->second->refreshing = false;
+  }
+}
+
+void ClientCache::erase(std::list<Item>::iterator it) {
+  bytes_ -= it->charge;
+  bytesGauge()->add(-static_cast<int64_t>(it->charge));
+  index_.erase(it->key);
+  lru_.erase(it);
+}
+
+} // namespace rocket
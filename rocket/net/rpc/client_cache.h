@@ -0,0 +1,90 @@
+#ifndef ROCKET_NET_RPC_CLIENT_CACHE_H
+#define ROCKET_NET_RPC_CLIENT_CACHE_H
+
+#include <cstdint>
+#include <list>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+#include "rocket/common/metrics.h"
+#include "rocket/common/singleton.h"
+
+namespace rocket {
+
+// 方法的缓存策略，启用后只读
+struct ClientCachePolicy {
+  int ttl_ms{0};
+  int stale_ms{0};
+  Counter *hits{nullptr};
+  Counter *stale_hits{nullptr};
+  Counter *misses{nullptr};
+};
+
+/**
+ * @brief 客户端结果缓存
+ *
+ * key 为方法名加序列化后的请求，value 为序列化的响应，由 RpcChannel 在发送请求前查找。
+ * 缓存项在 ttl 内为新鲜的，直接返回；过期后 stale_ms 内先返回旧结果，并且只由第一个命中的调用
+ * 在后台发起一次刷新；超过 stale_ms 视为未命中。只缓存成功的响应，
+ * 占用超过 max_bytes 时按 LRU 淘汰。
+ */
+class ClientCache : public Singleton<ClientCache> {
+public:
+  enum class Result {
+    Miss,
+    Fresh,
+    Stale,
+  };
+
+  ClientCache();
+
+  // 开启方法的缓存，需要在发起调用前调用
+  void enableMethod(const std::string &method_full_name, int ttl_ms, int stale_ms);
+
+  // 没有开启缓存时返回 nullptr
+  const ClientCachePolicy *policy(const std::string &method_full_name) const {
+    if (methods_.empty()) {
+      return nullptr;
+    }
+    auto it = methods_.find(method_full_name);
+    return it == methods_.end() ? nullptr : it->second.get();
+  }
+
+  // 命中时把响应拷贝到 pb_data 中；返回 Stale 且 refresh 为 true 时由调用方发起后台刷新，
+  // 刷新成功时调用 insert，失败时调用 refreshFailed
+  Result lookup(const ClientCachePolicy &policy, const std::string &key,
+                std::string &pb_data, bool &refresh);
+
+  void insert(const ClientCachePolicy &policy, const std::string &key, const std::string &pb_data);
+
+  void refreshFailed(const std::string &key);
+
+private:
+  struct Item {
+    std::string key;
+    std::string pb_data;
+    int64_t fresh_until_ms{0};
+    int64_t stale_until_ms{0};
+    bool refreshing{false};
+    size_t charge{0};
+  };
+
+  // 调用时需持有锁
+  void erase(std::list<Item>::iterator it);
+
+private:
+  std::map<std::string, std::unique_ptr<ClientCachePolicy>> methods_;
+  size_t max_bytes_{0};
+
+  std::mutex mutex_;
+  std::list<Item> lru_;   // 头部为最近使用
+  std::unordered_map<std::string, std::list<Item>::iterator> index_;
+  size_t bytes_{0};
+};
+
+} // namespace rocket
+
+#endif
@@ -0,0 +1,67 @@
+#ifndef ROCKET_NET_RPC_CO_CALL_H
+#define ROCKET_NET_RPC_CO_CALL_H
+
+#include <asio/async_result.hpp>
+#include <asio/post.hpp>
+#include <asio/use_awaitable.hpp>
+#include <google/protobuf/descriptor.h>
+#include <google/protobuf/message.h>
+#include <google/protobuf/service.h>
+#include <google/protobuf/stubs/callback.h>
+#include <type_traits>
+#include <utility>
+
+#include "rocket/net/rpc/rpc_controller.h"
+
+namespace rocket {
+
+/**
+ * @brief 调用结束时执行一次的闭包，把完成处理函数 post 回发起调用的协程所在的执行器
+ * 不在 RpcChannel 的回调中直接恢复协程，回调返回之前 controller、channel 仍然可能被访问
+ */
+template <typename Handler>
+class CompletionClosure : public google::protobuf::Closure {
+ public:
+  explicit CompletionClosure(Handler handler) : handler_(std::move(handler)) {}
+
+  void Run() override {
+    Handler handler = std::move(handler_);
+    delete this;
+    asio::post(std::move(handler));
+  }
+
+ private:
+  Handler handler_;
+};
+
+/**
+ * @brief 挂起当前协程直到 controller 结束(完成、失败、超时或取消)
+ *
+ * 完成通知挂在 controller 的 NotifyOnCancel 上，start 在注册之后执行，用于发起调用；
+ * 每次调用只分配一个闭包，不创建定时器。controller 已经结束时立即恢复。
+ *   co_await asyncFinish(controller, [=]() { channel->CallMethod(...); });
+ */
+template <typename Start, typename CompletionToken = asio::use_awaitable_t<>>
+auto asyncFinish(RpcController* controller, Start start, CompletionToken&& token = CompletionToken()) {
+  return asio::async_initiate<CompletionToken, void()>(
+      [controller, start = std::move(start)](auto handler) mutable {
+        typedef std::decay_t<decltype(handler)> Handler;
+        controller->NotifyOnCancel(new CompletionClosure<Handler>(std::move(handler)));
+        start();
+      },
+      token);
+}
+
+// 通过 channel 发起一次调用并挂起到调用结束，结果记录在 controller 和 response 中
+template <typename CompletionToken = asio::use_awaitable_t<>>
+auto asyncCallMethod(google::protobuf::RpcChannel* channel, const google::protobuf::MethodDescriptor* method,
+    RpcController* controller, const google::protobuf::Message* request, google::protobuf::Message* response,
+    CompletionToken&& token = CompletionToken()) {
+  return asyncFinish(controller, [channel, method, controller, request, response]() {
+    channel->CallMethod(method, controller, request, response, nullptr);
+  }, std::forward<CompletionToken>(token));
+}
+
+}
+
+#endif
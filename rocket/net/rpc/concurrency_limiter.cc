@@ -0,0 +1,218 @@
+#include "rocket/net/rpc/concurrency_limiter.h"
+#include "rocket/common/util.h"
+#include "rocket/logger/log.h"
+#include <algorithm>
+#include <asio/post.hpp>
+#include <asio/redirect_error.hpp>
+#include <asio/this_coro.hpp>
+#include <asio/use_awaitable.hpp>
+#include <chrono>
+#include <mutex>
+
+namespace rocket {
+
+static Counter *queuedCounter() {
+  static Counter *counter = MetricsRegistry::GetInstance()->getCounter(
+      "rocket_client_limit_queued_total");
+  return counter;
+}
+
+ConcurrencyLimiter::ConcurrencyLimiter()
+    : limit_map_(bucket_size_), bucket_lock_(bucket_size_) {
+  if (Config::GetGlobalConfig()) {
+    config_ = Config::GetGlobalConfig()->concurrency_limit_config_;
+  }
+}
+
+bool ConcurrencyLimiter::tryAcquire(const tcp::endpoint &addr) {
+  if (!config_.enable) {
+    return true;
+  }
+
+  int id = addrToIndex(addr);
+  std::scoped_lock<AdaptiveSpinLock> lock(bucket_lock_[id]);
+  EndpointLimit &limit = getLimitLocked(id, addr);
+  // 已有排队者时新请求不能插队
+  if (limit.inflight >= limit.limit || !limit.waiters.empty()) {
+    if (!queueEnabled()) {
+      limit.reject_counter->inc();
+    }
+    return false;
+  }
+  limit.inflight++;
+  limit.inflight_gauge->set(limit.inflight);
+  return true;
+}
+
+asio::awaitable<bool>
+ConcurrencyLimiter::waitAcquire(const tcp::endpoint &addr) {
+  auto executor = co_await asio::this_coro::executor;
+  auto waiter = std::make_shared<Waiter>();
+  waiter->timer = std::make_shared<asio::steady_timer>(
+      executor, std::chrono::milliseconds(config_.max_queue_wait_ms));
+
+  int id = addrToIndex(addr);
+  bool acquired = false;
+  {
+    std::scoped_lock<AdaptiveSpinLock> lock(bucket_lock_[id]);
+    EndpointLimit &limit = getLimitLocked(id, addr);
+    if (limit.inflight < limit.limit && limit.waiters.empty()) {
+      limit.inflight++;
+      limit.inflight_gauge->set(limit.inflight);
+      acquired = true;
+    } else {
+      limit.waiters.push_back(waiter);
+    }
+  }
+  if (acquired) {
+    co_return true;
+  }
+
+  queuedCounter()->inc();
+  // 名额被转交时定时器会被取消，否则等到超时
+  asio::error_code ec;
+  co_await waiter->timer->async_wait(
+      asio::redirect_error(asio::use_awaitable, ec));
+
+  {
+    std::scoped_lock<AdaptiveSpinLock> lock(bucket_lock_[id]);
+    EndpointLimit &limit = getLimitLocked(id, addr);
+    if (waiter->granted) {
+      acquired = true;
+    } else {
+      auto it = std::find(limit.waiters.begin(), limit.waiters.end(), waiter);
+      if (it != limit.waiters.end()) {
+        limit.waiters.erase(it);
+      }
+      limit.reject_counter->inc();
+    }
+  }
+  co_return acquired;
+}
+
+void ConcurrencyLimiter::release(const tcp::endpoint &addr, Outcome outcome,
+                                 int64_t rtt_us) {
+  if (!config_.enable) {
+    return;
+  }
+
+  std::vector<std::shared_ptr<Waiter>> granted;
+  int id = addrToIndex(addr);
+  {
+    std::scoped_lock<AdaptiveSpinLock> lock(bucket_lock_[id]);
+    EndpointLimit &limit = getLimitLocked(id, addr);
+    if (limit.inflight > 0) {
+      limit.inflight--;
+    }
+    onSample(limit, outcome, rtt_us);
+
+    // 把空出来的名额按排队顺序转交给等待者
+    while (!limit.waiters.empty() && limit.inflight < limit.limit) {
+      auto waiter = limit.waiters.front();
+      limit.waiters.pop_front();
+      waiter->granted = true;
+      limit.inflight++;
+      granted.push_back(waiter);
+    }
+    limit.inflight_gauge->set(limit.inflight);
+    limit.limit_gauge->set(limit.limit);
+  }
+
+  // 定时器属于等待者所在的线程，需要投递到它的 executor 上取消
+  for (auto &waiter : granted) {
+    auto timer = waiter->timer;
+    asio::post(timer->get_executor(), [timer]() { timer->cancel(); });
+  }
+}
+
+int ConcurrencyLimiter::getLimit(const tcp::endpoint &addr) {
+  int id = addrToIndex(addr);
+  std::scoped_lock<AdaptiveSpinLock> lock(bucket_lock_[id]);
+  return getLimitLocked(id, addr).limit;
+}
+
+ConcurrencyLimiter::EndpointLimit &
+ConcurrencyLimiter::getLimitLocked(int id, const tcp::endpoint &addr) {
+  auto it = limit_map_[id].find(addr);
+  if (it != limit_map_[id].end()) {
+    return it->second;
+  }
+
+  EndpointLimit &limit = limit_map_[id][addr];
+  limit.limit = config_.initial_limit;
+  limit.window_start_ms = getNowMs();
+
+  std::string label = "{peer=\"" + addr.address().to_string() + ":" +
+                      std::to_string(addr.port()) + "\"}";
+  MetricsRegistry *registry = MetricsRegistry::GetInstance();
+  limit.limit_gauge = registry->getGauge("rocket_client_concurrency_limit" + label);
+  limit.inflight_gauge = registry->getGauge("rocket_client_inflight" + label);
+  limit.reject_counter = registry->getCounter("rocket_client_limit_rejects_total" + label);
+  limit.limit_gauge->set(limit.limit);
+  return limit;
+}
+
+void ConcurrencyLimiter::onSample(EndpointLimit &limit, Outcome outcome,
+                                  int64_t rtt_us) {
+  int64_t now_ms = getNowMs();
+  if (outcome == Outcome::Dropped) {
+    decrease(limit, now_ms);
+    return;
+  }
+  if (outcome != Outcome::Success || rtt_us <= 0) {
+    return;
+  }
+
+  if (limit.window_min_rtt_us == 0 || rtt_us < limit.window_min_rtt_us) {
+    limit.window_min_rtt_us = rtt_us;
+  }
+  if (limit.min_rtt_us == 0 || rtt_us < limit.min_rtt_us) {
+    limit.min_rtt_us = rtt_us;
+  }
+  // 周期性地用本周期的最小值替换，网络或服务端变化后可以重新收敛
+  if (now_ms - limit.window_start_ms >= config_.min_rtt_window_ms) {
+    limit.min_rtt_us = limit.window_min_rtt_us;
+    limit.window_min_rtt_us = 0;
+    limit.window_start_ms = now_ms;
+  }
+
+  if (rtt_us * 100 > limit.min_rtt_us * config_.rtt_tolerance_percent) {
+    decrease(limit, now_ms);
+    return;
+  }
+
+  // 只有上限被用到一半以上才增长，避免低负载时上限无限膨胀
+  if ((limit.inflight + 1) * 2 < limit.limit) {
+    return;
+  }
+  if (++limit.increase_acc >= limit.limit) {
+    limit.increase_acc = 0;
+    limit.limit = std::min<int64_t>(limit.limit + 1, config_.max_limit);
+  }
+}
+
+void ConcurrencyLimiter::decrease(EndpointLimit &limit, int64_t now_ms) {
+  // 每个 RTT 最多收缩一次，避免一批超时把上限直接打到底
+  int64_t min_interval_ms = std::max<int64_t>(1, limit.min_rtt_us / 1000);
+  if (now_ms - limit.last_decrease_ms < min_interval_ms) {
+    return;
+  }
+  int64_t new_limit = limit.limit * config_.backoff_percent / 100;
+  if (new_limit == limit.limit) {
+    new_limit--;
+  }
+  new_limit = std::max<int64_t>(new_limit, config_.min_limit);
+  if (new_limit != limit.limit) {
+    DEBUGLOG("concurrency limit decrease from %ld to %ld", limit.limit, new_limit);
+  }
+  limit.limit = new_limit;
+  limit.increase_acc = 0;
+  limit.last_decrease_ms = now_ms;
+}
+
+int ConcurrencyLimiter::addrToIndex(const tcp::endpoint &addr) {
+  auto hv = EndpointHash()(addr);
+  return hv % bucket_size_;
+}
+
+} // namespace rocket
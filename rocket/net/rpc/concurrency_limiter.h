@@ -0,0 +1,94 @@
+#ifndef ROCKET_NET_RPC_CONCURRENCY_LIMITER_H
+#define ROCKET_NET_RPC_CONCURRENCY_LIMITER_H
+
+#include "rocket/common/config.h"
+#include "rocket/common/metrics.h"
+#include "rocket/common/singleton.h"
+#include "rocket/common/spinlock.h"
+#include "rocket/net/tcp/endpoint_hash.h"
+#include <asio/awaitable.hpp>
+#include <asio/ip/tcp.hpp>
+#include <asio/steady_timer.hpp>
+#include <atomic>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+namespace rocket {
+
+using asio::ip::tcp;
+
+/**
+ * @brief 客户端按节点的自适应并发限制
+ *
+ * 每个节点维护在途请求数和并发上限，上限按 AIMD 调整：
+ * 1. 请求成功且 RTT 没有明显超过最小 RTT 时，上限大约每个 RTT 加一
+ * 2. RTT 超过最小 RTT 的 rtt_tolerance_percent，或请求超时，上限乘以 backoff_percent
+ * 超过上限的请求直接失败，或在配置了 max_queue_wait_ms 时排队等待空闲名额
+ */
+class ConcurrencyLimiter : public Singleton<ConcurrencyLimiter> {
+public:
+  enum class Outcome {
+    Success = 1, // 正常返回，RTT 作为样本
+    Dropped = 2, // 超时/过载，视为拥塞信号
+    Ignore = 3,  // 其他错误，只释放名额
+  };
+
+  ConcurrencyLimiter();
+
+  // 尝试占用一个名额，失败说明已达到上限
+  bool tryAcquire(const tcp::endpoint &addr);
+
+  // 在当前协程中排队等待名额，最多等待 max_queue_wait_ms，返回是否拿到名额
+  asio::awaitable<bool> waitAcquire(const tcp::endpoint &addr);
+
+  // 释放名额并用本次调用结果调整上限
+  void release(const tcp::endpoint &addr, Outcome outcome, int64_t rtt_us);
+
+  bool queueEnabled() const { return config_.enable && config_.max_queue_wait_ms > 0; }
+
+  int getLimit(const tcp::endpoint &addr);
+
+private:
+  struct Waiter {
+    std::shared_ptr<asio::steady_timer> timer;
+    bool granted{false};
+  };
+
+  struct EndpointLimit {
+    int64_t limit{0};
+    int64_t inflight{0};
+    int64_t increase_acc{0};       // 累计成功数，达到 limit 后上限加一
+    int64_t min_rtt_us{0};         // 当前使用的最小 RTT, 0 表示还没有样本
+    int64_t window_min_rtt_us{0};  // 本周期内观测到的最小 RTT
+    int64_t window_start_ms{0};
+    int64_t last_decrease_ms{0};
+    std::deque<std::shared_ptr<Waiter>> waiters;
+
+    Gauge *limit_gauge{nullptr};
+    Gauge *inflight_gauge{nullptr};
+    Counter *reject_counter{nullptr};
+  };
+
+  using LimitMap = std::unordered_map<tcp::endpoint, EndpointLimit, EndpointHash>;
+
+  int addrToIndex(const tcp::endpoint &addr);
+
+  // 以下函数调用时需持有对应 bucket 的锁
+  EndpointLimit &getLimitLocked(int id, const tcp::endpoint &addr);
+  void onSample(EndpointLimit &limit, Outcome outcome, int64_t rtt_us);
+  void decrease(EndpointLimit &limit, int64_t now_ms);
+
+private:
+  ConcurrencyLimitConfig config_;
+
+  const int bucket_size_ = 8;
+  std::vector<LimitMap> limit_map_;
+  std::vector<AdaptiveSpinLock> bucket_lock_;
+};
+
+} // namespace rocket
+
+#endif
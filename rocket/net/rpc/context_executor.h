@@ -0,0 +1,72 @@
+#ifndef ROCKET_NET_RPC_CONTEXT_EXECUTOR_H
+#define ROCKET_NET_RPC_CONTEXT_EXECUTOR_H
+
+#include <asio/io_context.hpp>
+#include <asio/prefer.hpp>
+#include <asio/query.hpp>
+#include <asio/require.hpp>
+#include <memory>
+#include <type_traits>
+#include <utility>
+
+#include "rocket/common/run_time.h"
+
+namespace rocket {
+
+/**
+ * @brief 包装 IO 线程的执行器，协程每次在其上恢复执行时把 RunTime 设置为所属请求的上下文
+ *
+ * 协程挂起期间同一线程会处理其他请求，RunTime 只能在协程实际运行的时间段内有效：
+ * 每次 execute 的函数(协程的一段执行)运行前写入请求的 trace id、deadline，返回(挂起或结束)后恢复原值。
+ * 其余属性的 query/require/prefer 全部转发给被包装的执行器。
+ */
+template <typename Executor>
+class ContextExecutor {
+ public:
+  ContextExecutor(const Executor& inner, std::shared_ptr<const RequestContext> context) noexcept
+    : inner_(inner), context_(std::move(context)) {}
+
+  template <typename Property>
+  auto query(const Property& property) const
+      -> decltype(asio::query(std::declval<const Executor&>(), property)) {
+    return asio::query(inner_, property);
+  }
+
+  template <typename Property>
+  auto require(const Property& property) const
+      -> ContextExecutor<std::decay_t<decltype(asio::require(std::declval<const Executor&>(), property))>> {
+    return {asio::require(inner_, property), context_};
+  }
+
+  template <typename Property>
+  auto prefer(const Property& property) const
+      -> ContextExecutor<std::decay_t<decltype(asio::prefer(std::declval<const Executor&>(), property))>> {
+    return {asio::prefer(inner_, property), context_};
+  }
+
+  template <typename Function>
+  void execute(Function&& function) const {
+    inner_.execute([context = context_, function = std::forward<Function>(function)]() mutable {
+      ScopedRunTime scope(*context);
+      std::move(function)();
+    });
+  }
+
+  bool operator==(const ContextExecutor& other) const noexcept {
+    return inner_ == other.inner_ && context_ == other.context_;
+  }
+
+  bool operator!=(const ContextExecutor& other) const noexcept {
+    return !(*this == other);
+  }
+
+ private:
+  template <typename> friend class ContextExecutor;
+
+  Executor inner_;
+  std::shared_ptr<const RequestContext> context_;
+};
+
+}
+
+#endif
@@ -0,0 +1,118 @@
+#include "rocket/net/rpc/method_table.h"
+#include <algorithm>
+#include "rocket/logger/log.h"
+
+namespace rocket {
+
+static const int kMaxSeedTries = 1024;
+
+uint32_t MethodTable::MethodId(const char* data, size_t len) {
+  uint32_t hash = 2166136261u;
+  for (size_t i = 0; i < len; ++i) {
+    hash ^= static_cast<uint8_t>(data[i]);
+    hash *= 16777619u;
+  }
+  return hash == 0 ? 1 : hash;
+}
+
+void MethodTable::addService(std::shared_ptr<google::protobuf::Service> service) {
+  const google::protobuf::ServiceDescriptor* descriptor = service->GetDescriptor();
+  for (int i = 0; i < descriptor->method_count(); ++i) {
+    MethodEntry entry;
+    entry.method = descriptor->method(i);
+    entry.service = service;
+    entry.service_name = descriptor->full_name();
+    entry.method_name = entry.method->name();
+    entry.full_name = entry.service_name + "." + entry.method_name;
+    entry.id = MethodId(entry.full_name);
+
+    auto it = by_name_.find(entry.full_name);
+    if (it != by_name_.end()) {
+      entries_[it->second] = entry;
+    } else {
+      by_name_[entry.full_name] = entries_.size();
+      entries_.push_back(entry);
+    }
+  }
+  rebuild();
+}
+
+int MethodTable::findByName(const std::string& full_name) const {
+  int index = findById(MethodId(full_name));
+  if (index >= 0 && entries_[index].full_name == full_name) {
+    return index;
+  }
+  auto it = by_name_.find(full_name);
+  return it != by_name_.end() ? it->second : -1;
+}
+
+bool MethodTable::setCoroutineMethod(const std::string& full_name, CoroutineMethod co_method) {
+  auto it = by_name_.find(full_name);
+  if (it == by_name_.end()) {
+    return false;
+  }
+  entries_[it->second].co_method = std::move(co_method);
+  return true;
+}
+
+bool MethodTable::setCachePolicy(const std::string& full_name, std::shared_ptr<ResponseCachePolicy> policy) {
+  auto it = by_name_.find(full_name);
+  if (it == by_name_.end()) {
+    return false;
+  }
+  entries_[it->second].cache_policy = std::move(policy);
+  return true;
+}
+
+void MethodTable::rebuild() {
+  id_conflict_ = false;
+  std::map<uint32_t, int> ids;
+  for (size_t i = 0; i < entries_.size(); ++i) {
+    auto it = ids.find(entries_[i].id);
+    if (it != ids.end()) {
+      ERRORLOG("method id conflict, [%s] and [%s] both hash to [%u], dispatch by name only",
+          entries_[it->second].full_name.c_str(), entries_[i].full_name.c_str(), entries_[i].id);
+      id_conflict_ = true;
+      continue;
+    }
+    ids[entries_[i].id] = i;
+  }
+
+  // 槽数不少于方法数的两倍，找不到 seed 时加倍
+  int bits = 1;
+  while ((1u << bits) < 2 * entries_.size()) {
+    bits++;
+  }
+  while (!tryBuild(bits)) {
+    bits++;
+  }
+  DEBUGLOG("method table rebuilt, %lu methods, %lu slots, seed[%u]", entries_.size(), slots_.size(), seed_);
+}
+
+bool MethodTable::tryBuild(int bits) {
+  std::vector<int32_t> slots(1u << bits, -1);
+  int shift = 32 - bits;
+  uint32_t seed = 2654435761u;
+  for (int attempt = 0; attempt < kMaxSeedTries; ++attempt, seed += 2) {
+    std::fill(slots.begin(), slots.end(), -1);
+    bool ok = true;
+    for (size_t i = 0; i < entries_.size() && ok; ++i) {
+      int32_t& slot = slots[static_cast<uint32_t>(entries_[i].id * seed) >> shift];
+      if (slot < 0) {
+        slot = i;
+      } else if (entries_[slot].id != entries_[i].id) {
+        ok = false;
+      }
+      // id 冲突的方法只保留先注册的，按名字查找时退回 by_name_
+    }
+    if (ok) {
+      slots_.swap(slots);
+      seed_ = seed;
+      shift_ = shift;
+      return true;
+    }
+  }
+  return false;
+}
+
+}
@@ -0,0 +1,96 @@
+#ifndef ROCKET_NET_RPC_METHOD_TABLE_H
+#define ROCKET_NET_RPC_METHOD_TABLE_H
+
+#include <asio/awaitable.hpp>
+#include <google/protobuf/descriptor.h>
+#include <google/protobuf/message.h>
+#include <google/protobuf/service.h>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace rocket {
+
+class RpcController;
+struct ResponseCachePolicy;
+
+// 协程方法，在连接所属的 IO 线程中执行，协程结束时自动回包
+typedef std::function<asio::awaitable<void>(RpcController*, const google::protobuf::Message*, google::protobuf::Message*)> CoroutineMethod;
+
+struct MethodEntry {
+  uint32_t id {0};
+  std::string full_name;      // 形如 "Order.makeOrder"
+  std::string service_name;
+  std::string method_name;
+  std::shared_ptr<google::protobuf::Service> service;
+  const google::protobuf::MethodDescriptor* method {nullptr};
+  CoroutineMethod co_method;  // 非空时代替 service->CallMethod
+  std::shared_ptr<ResponseCachePolicy> cache_policy;   // 非空时按请求内容缓存响应
+};
+
+/**
+ * @brief 服务端的方法表，注册服务时为每个方法生成一项，之后只读
+ *
+ * 方法 id 为方法全名的 FNV-1a 哈希，客户端不需要查询就能算出，跨进程、跨版本稳定。
+ * 查找表是 id 上的完美哈希：slot = (id * seed) >> shift，注册时搜索一个没有冲突的 seed，
+ * 按 id 查找只需要一次乘法和一次下标访问；按名字查找先算出 id 再比较名字，
+ * 不在完美哈希表中的名字(例如 id 冲突时后注册的方法)退回到有序表中查找。
+ */
+class MethodTable {
+ public:
+  // 0 保留，表示没有 id
+  static uint32_t MethodId(const char* data, size_t len);
+
+  static uint32_t MethodId(const std::string& full_name) {
+    return MethodId(full_name.data(), full_name.length());
+  }
+
+  // 添加服务的所有方法并重建查找表，同名方法以后注册的为准
+  void addService(std::shared_ptr<google::protobuf::Service> service);
+
+  // 返回方法的下标，不存在时返回 -1
+  int findById(uint32_t id) const {
+    if (slots_.empty()) {
+      return -1;
+    }
+    int index = slots_[static_cast<uint32_t>(id * seed_) >> shift_];
+    return (index >= 0 && entries_[index].id == id) ? index : -1;
+  }
+
+  int findByName(const std::string& full_name) const;
+
+  // 为已注册的方法设置协程实现，方法不存在时返回 false
+  bool setCoroutineMethod(const std::string& full_name, CoroutineMethod co_method);
+
+  // 为已注册的方法开启响应缓存，方法不存在时返回 false
+  bool setCachePolicy(const std::string& full_name, std::shared_ptr<ResponseCachePolicy> policy);
+
+  const MethodEntry& at(int index) const { return entries_[index]; }
+
+  size_t size() const { return entries_.size(); }
+
+  // 所有方法的 id 互不相同时，客户端才可以只发送 id
+  bool idUsable() const { return !entries_.empty() && !id_conflict_; }
+
+ private:
+  void rebuild();
+
+  // 在 2^bits 个槽上尝试若干 seed，成功时填好 slots_
+  bool tryBuild(int bits);
+
+ private:
+  std::vector<MethodEntry> entries_;
+  std::map<std::string, int> by_name_;
+
+  std::vector<int32_t> slots_;   // 槽 -> entries_ 下标，空槽为 -1
+  uint32_t seed_ {0};
+  int shift_ {32};
+  bool id_conflict_ {false};
+};
+
+}
+
+#endif
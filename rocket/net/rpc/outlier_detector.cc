@@ -0,0 +1,298 @@
+#include "rocket/net/rpc/outlier_detector.h"
+#include "rocket/common/metrics.h"
+#include "rocket/common/util.h"
+#include "rocket/logger/log.h"
+#include <algorithm>
+#include <mutex>
+
+namespace rocket {
+
+// 每个线程独立的轮询游标，避免多线程争用同一个原子变量
+static thread_local uint32_t t_rr_cursor = 0;
+
+// 同一节点两次延迟比较之间的最小间隔
+static const int64_t g_latency_check_interval_ms = 1000;
+
+static Counter *ejectionsCounter() {
+  static Counter *counter =
+      MetricsRegistry::GetInstance()->getCounter("rocket_outlier_ejections_total");
+  return counter;
+}
+
+static Counter *readmissionsCounter() {
+  static Counter *counter = MetricsRegistry::GetInstance()->getCounter(
+      "rocket_outlier_readmissions_total");
+  return counter;
+}
+
+static Counter *probeFailuresCounter() {
+  static Counter *counter = MetricsRegistry::GetInstance()->getCounter(
+      "rocket_outlier_probe_failures_total");
+  return counter;
+}
+
+static Counter *panicCounter() {
+  static Counter *counter = MetricsRegistry::GetInstance()->getCounter(
+      "rocket_outlier_panic_selections_total");
+  return counter;
+}
+
+static Gauge *ejectedGauge() {
+  static Gauge *gauge =
+      MetricsRegistry::GetInstance()->getGauge("rocket_outlier_ejected_endpoints");
+  return gauge;
+}
+
+OutlierDetector::OutlierDetector()
+    : stats_map_(bucket_size_), bucket_lock_(bucket_size_) {
+  if (Config::GetGlobalConfig()) {
+    config_ = Config::GetGlobalConfig()->outlier_config_;
+  }
+}
+
+bool OutlierDetector::selectEndpoint(const std::vector<tcp::endpoint> &peers,
+                                     tcp::endpoint &out, bool *probe) {
+  if (probe) {
+    *probe = false;
+  }
+  if (peers.empty()) {
+    return false;
+  }
+
+  size_t n = peers.size();
+  uint32_t start = t_rr_cursor++;
+  int64_t now_ms = getNowMs();
+  const tcp::endpoint *fallback = nullptr;
+
+  for (size_t i = 0; i < n; ++i) {
+    const tcp::endpoint &addr = peers[(start + i) % n];
+    if (addr.address().is_unspecified()) {
+      continue;
+    }
+    if (fallback == nullptr) {
+      fallback = &addr;
+    }
+    if (!config_.enable) {
+      out = addr;
+      return true;
+    }
+
+    if (n > 1) {
+      checkLatencyOutlier(peers, addr, now_ms);
+    }
+    if (tryPick(addr, now_ms, probe)) {
+      out = addr;
+      return true;
+    }
+  }
+
+  if (fallback == nullptr) {
+    return false;
+  }
+
+  // 所有节点都被驱逐，与其全部失败不如继续按轮询发送
+  panicCounter()->inc();
+  DEBUGLOG("all endpoints ejected, panic select [%s:%u]",
+           fallback->address().to_string().c_str(), fallback->port());
+  out = *fallback;
+  return true;
+}
+
+void OutlierDetector::reportResult(const tcp::endpoint &addr,
+                                   CallResult result, int64_t latency_us,
+                                   bool probe) {
+  if (!config_.enable) {
+    return;
+  }
+
+  int64_t now_ms = getNowMs();
+  int id = addrToIndex(addr);
+  std::scoped_lock<AdaptiveSpinLock> lock(bucket_lock_[id]);
+  EndpointStats &stats = stats_map_[id][addr];
+
+  // 半开状态只由探测请求的结果决定，驱逐前发出、恐慌模式下发出的请求结果都不算数
+  if (stats.state == State::HalfOpen) {
+    if (!probe) {
+      return;
+    }
+    if (result == CallResult::Abandoned) {
+      // 探测请求没有发出，退回驱逐状态，下一次挑选时重新探测
+      stats.state = State::Ejected;
+    } else if (result == CallResult::Success) {
+      stats.state = State::Healthy;
+      stats.window_start_ms = now_ms;
+      stats.requests = stats.errors = stats.timeouts = 0;
+      stats.latency_ewma_us = latency_us;
+      readmissionsCounter()->inc();
+      ejectedGauge()->add(-1);
+      INFOLOG("probe success, readmit endpoint[%s:%u]",
+              addr.address().to_string().c_str(), addr.port());
+    } else {
+      probeFailuresCounter()->inc();
+      eject(addr, stats, now_ms, "probe failed");
+    }
+    return;
+  }
+
+  // 驱逐前已发出的请求，或恐慌模式下的请求，结果不计入统计
+  if (result == CallResult::Abandoned || stats.state == State::Ejected) {
+    return;
+  }
+
+  rollWindow(stats, now_ms);
+  stats.requests++;
+  if (result == CallResult::Success) {
+    if (stats.latency_ewma_us == 0) {
+      stats.latency_ewma_us = latency_us;
+    } else {
+      stats.latency_ewma_us += (latency_us - stats.latency_ewma_us) / 8;
+    }
+  } else if (result == CallResult::Timeout) {
+    stats.timeouts++;
+  } else {
+    stats.errors++;
+  }
+
+  if (stats.requests < config_.min_requests) {
+    return;
+  }
+  if (stats.errors * 100 >= config_.error_rate_percent * stats.requests) {
+    eject(addr, stats, now_ms, "error rate");
+  } else if (stats.timeouts * 100 >=
+             config_.timeout_rate_percent * stats.requests) {
+    eject(addr, stats, now_ms, "timeout rate");
+  }
+}
+
+bool OutlierDetector::isEjected(const tcp::endpoint &addr) {
+  int id = addrToIndex(addr);
+  std::scoped_lock<AdaptiveSpinLock> lock(bucket_lock_[id]);
+  auto it = stats_map_[id].find(addr);
+  return it != stats_map_[id].end() && it->second.state != State::Healthy;
+}
+
+void OutlierDetector::rollWindow(EndpointStats &stats, int64_t now_ms) {
+  if (now_ms - stats.window_start_ms < config_.window_ms) {
+    return;
+  }
+  // 健康地度过一个完整窗口后，退避次数清零
+  if (now_ms - stats.eject_until_ms >= config_.window_ms) {
+    stats.eject_count = 0;
+  }
+  stats.window_start_ms = now_ms;
+  stats.requests = stats.errors = stats.timeouts = 0;
+}
+
+void OutlierDetector::eject(const tcp::endpoint &addr, EndpointStats &stats,
+                            int64_t now_ms, const char *reason) {
+  if (stats.state == State::Healthy) {
+    ejectedGauge()->add(1);
+  }
+  stats.eject_count = std::min(stats.eject_count + 1, 16);
+  int64_t eject_ms = std::min<int64_t>(
+      (int64_t)config_.base_eject_ms << (stats.eject_count - 1),
+      config_.max_eject_ms);
+
+  stats.state = State::Ejected;
+  stats.eject_until_ms = now_ms + eject_ms;
+  stats.window_start_ms = now_ms;
+  stats.requests = stats.errors = stats.timeouts = 0;
+  stats.latency_ewma_us = 0;
+
+  ejectionsCounter()->inc();
+  INFOLOG("eject endpoint[%s:%u] for %ld ms, reason[%s], eject count[%d]",
+          addr.address().to_string().c_str(), addr.port(), eject_ms, reason,
+          stats.eject_count);
+}
+
+bool OutlierDetector::tryPick(const tcp::endpoint &addr, int64_t now_ms,
+                              bool *probe) {
+  int id = addrToIndex(addr);
+  std::scoped_lock<AdaptiveSpinLock> lock(bucket_lock_[id]);
+  EndpointStats &stats = stats_map_[id][addr];
+
+  switch (stats.state) {
+  case State::Healthy:
+    return true;
+  case State::Ejected:
+    if (probe == nullptr || now_ms < stats.eject_until_ms) {
+      return false;
+    }
+    // 驱逐到期，放行一个探测请求
+    stats.state = State::HalfOpen;
+    *probe = true;
+    INFOLOG("eject expired, send probe to endpoint[%s:%u]",
+            addr.address().to_string().c_str(), addr.port());
+    return true;
+  case State::HalfOpen:
+  default:
+    return false;
+  }
+}
+
+void OutlierDetector::checkLatencyOutlier(
+    const std::vector<tcp::endpoint> &peers, const tcp::endpoint &addr,
+    int64_t now_ms) {
+  int64_t own_latency = 0;
+  {
+    int id = addrToIndex(addr);
+    std::scoped_lock<AdaptiveSpinLock> lock(bucket_lock_[id]);
+    EndpointStats &stats = stats_map_[id][addr];
+    if (stats.state != State::Healthy || stats.latency_ewma_us == 0 ||
+        stats.requests < config_.min_requests ||
+        now_ms - stats.latency_checked_ms < g_latency_check_interval_ms) {
+      return;
+    }
+    stats.latency_checked_ms = now_ms;
+    own_latency = stats.latency_ewma_us;
+  }
+
+  std::vector<int64_t> latencies;
+  latencies.reserve(peers.size());
+  for (const auto &peer : peers) {
+    if (peer == addr || peer.address().is_unspecified()) {
+      continue;
+    }
+    int64_t latency = latencyOf(peer);
+    if (latency > 0) {
+      latencies.push_back(latency);
+    }
+  }
+  if (latencies.empty()) {
+    return;
+  }
+
+  auto mid = latencies.begin() + latencies.size() / 2;
+  std::nth_element(latencies.begin(), mid, latencies.end());
+  int64_t median = *mid;
+  if (own_latency <= median * config_.latency_factor) {
+    return;
+  }
+
+  int id = addrToIndex(addr);
+  std::scoped_lock<AdaptiveSpinLock> lock(bucket_lock_[id]);
+  EndpointStats &stats = stats_map_[id][addr];
+  if (stats.state == State::Healthy) {
+    DEBUGLOG("endpoint[%s:%u] latency %ld us, peers median %ld us",
+             addr.address().to_string().c_str(), addr.port(), own_latency,
+             median);
+    eject(addr, stats, now_ms, "latency");
+  }
+}
+
+int64_t OutlierDetector::latencyOf(const tcp::endpoint &addr) {
+  int id = addrToIndex(addr);
+  std::scoped_lock<AdaptiveSpinLock> lock(bucket_lock_[id]);
+  auto it = stats_map_[id].find(addr);
+  if (it == stats_map_[id].end() || it->second.state != State::Healthy) {
+    return 0;
+  }
+  return it->second.latency_ewma_us;
+}
+
+int OutlierDetector::addrToIndex(const tcp::endpoint &addr) {
+  auto hv = EndpointHash()(addr);
+  return hv % bucket_size_;
+}
+
+} // namespace rocket
@@ -0,0 +1,96 @@
+#ifndef ROCKET_NET_RPC_OUTLIER_DETECTOR_H
+#define ROCKET_NET_RPC_OUTLIER_DETECTOR_H
+
+#include "rocket/common/config.h"
+#include "rocket/common/singleton.h"
+#include "rocket/common/spinlock.h"
+#include "rocket/net/tcp/endpoint_hash.h"
+#include <asio/ip/tcp.hpp>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+namespace rocket {
+
+using asio::ip::tcp;
+
+/**
+ * @brief 客户端按节点的异常检测与熔断
+ *
+ * 每个下游节点维护一个统计窗口(错误率、超时率)和成功请求的延迟 EWMA：
+ * 1. 窗口内错误率/超时率超过阈值，或延迟超过同组节点中位数的若干倍时驱逐该节点
+ * 2. 驱逐时长按连续驱逐次数指数退避
+ * 3. 驱逐到期后进入半开状态，只放行一个探测请求，成功则恢复，失败则再次驱逐
+ *    只有探测请求的结果会改变半开状态，驱逐前发出的请求和恐慌模式下的请求结果都被忽略
+ * 负载均衡通过 selectEndpoint 轮询挑选节点，跳过被驱逐和正在探测的节点
+ */
+class OutlierDetector : public Singleton<OutlierDetector> {
+public:
+  enum class CallResult {
+    Success = 1,
+    Error = 2,
+    Timeout = 3,
+    Abandoned = 4, // 请求没有真正发出(如被本地限流)，不计入统计
+  };
+
+  OutlierDetector();
+
+  // 从 peers 中轮询挑选一个可用节点，所有节点都不可用时退化为普通轮询(恐慌模式)
+  // probe 非空时允许挑选驱逐到期的节点作为探测，*probe 表示本次调用是否为探测请求，
+  // 调用方必须以同样的 probe 上报结果；probe 为空时不发起探测
+  // 返回 false 表示没有任何有效地址
+  bool selectEndpoint(const std::vector<tcp::endpoint> &peers,
+                      tcp::endpoint &out, bool *probe = nullptr);
+
+  // 上报一次调用结果，latency_us 只对成功请求有意义
+  void reportResult(const tcp::endpoint &addr, CallResult result,
+                    int64_t latency_us, bool probe);
+
+  bool isEjected(const tcp::endpoint &addr);
+
+private:
+  enum class State {
+    Healthy = 1,
+    Ejected = 2,
+    HalfOpen = 3, // 驱逐到期，探测请求在途
+  };
+
+  struct EndpointStats {
+    State state{State::Healthy};
+    int64_t window_start_ms{0};
+    int64_t requests{0};
+    int64_t errors{0};
+    int64_t timeouts{0};
+    int64_t latency_ewma_us{0}; // 成功请求延迟的 EWMA, 0 表示还没有样本
+    int64_t latency_checked_ms{0};
+    int64_t eject_until_ms{0};
+    int eject_count{0}; // 连续驱逐次数，用于退避
+  };
+
+  using StatsMap = std::unordered_map<tcp::endpoint, EndpointStats, EndpointHash>;
+
+  int addrToIndex(const tcp::endpoint &addr);
+
+  // 以下函数调用时需持有对应 bucket 的锁
+  void rollWindow(EndpointStats &stats, int64_t now_ms);
+  void eject(const tcp::endpoint &addr, EndpointStats &stats, int64_t now_ms,
+             const char *reason);
+  bool tryPick(const tcp::endpoint &addr, int64_t now_ms, bool *probe);
+
+  // 与同组节点比较延迟，判定是否为延迟异常节点
+  void checkLatencyOutlier(const std::vector<tcp::endpoint> &peers,
+                           const tcp::endpoint &addr, int64_t now_ms);
+
+  int64_t latencyOf(const tcp::endpoint &addr);
+
+private:
+  OutlierDetectionConfig config_;
+
+  const int bucket_size_ = 8;
+  std::vector<StatsMap> stats_map_;
+  std::vector<AdaptiveSpinLock> bucket_lock_;
+};
+
+} // namespace rocket
+
+#endif
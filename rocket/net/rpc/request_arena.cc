@@ -0,0 +1,63 @@
+#include "rocket/net/rpc/request_arena.h"
+#include "rocket/common/config.h"
+#include "rocket/common/metrics.h"
+
+namespace rocket {
+
+static Counter* blockBusyCounter() {
+  static Counter* counter = MetricsRegistry::GetInstance()->getCounter("rocket_arena_block_busy_total");
+  return counter;
+}
+
+static Counter* overflowBytesCounter() {
+  static Counter* counter = MetricsRegistry::GetInstance()->getCounter("rocket_arena_overflow_bytes_total");
+  return counter;
+}
+
+// 线程退出时块可能还被其他线程中的请求持有，所以用 shared_ptr 管理
+static const std::shared_ptr<ArenaBlock>& threadBlock() {
+  static thread_local std::shared_ptr<ArenaBlock> t_block = []() {
+    int size = 8192;
+    if (Config::GetGlobalConfig()) {
+      size = Config::GetGlobalConfig()->arena_config_.initial_block;
+    }
+    std::shared_ptr<ArenaBlock> block;
+    if (size > 0) {
+      block = std::make_shared<ArenaBlock>();
+      block->size = size;
+      block->data.reset(new char[size]);
+    }
+    return block;
+  }();
+  return t_block;
+}
+
+RequestArena::RequestArena() {
+  google::protobuf::ArenaOptions options;
+  const std::shared_ptr<ArenaBlock>& block = threadBlock();
+  if (block) {
+    if (!block->in_use.exchange(true, std::memory_order_acquire)) {
+      block_ = block;
+      options.initial_block = block_->data.get();
+      options.initial_block_size = block_->size;
+    } else {
+      blockBusyCounter()->inc();
+    }
+  }
+  arena_.emplace(options);
+}
+
+RequestArena::~RequestArena() {
+  size_t allocated = arena_->SpaceAllocated();
+  size_t initial = block_ ? block_->size : 0;
+  if (allocated > initial) {
+    overflowBytesCounter()->inc(allocated - initial);
+  }
+  // 先析构 Arena(会调用其中对象的析构函数)，再归还初始内存块
+  arena_.reset();
+  if (block_) {
+    block_->in_use.store(false, std::memory_order_release);
+  }
+}
+
+}
@@ -0,0 +1,44 @@
+#ifndef ROCKET_NET_RPC_REQUEST_ARENA_H
+#define ROCKET_NET_RPC_REQUEST_ARENA_H
+
+#include <google/protobuf/arena.h>
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <optional>
+
+namespace rocket {
+
+// 每个线程一块可复用的初始内存，同一时刻只能被一个请求使用
+struct ArenaBlock {
+  std::unique_ptr<char[]> data;
+  size_t size {0};
+  std::atomic<bool> in_use {false};
+};
+
+/**
+ * @brief 单个请求的 protobuf Arena，请求/响应消息和闭包都从这里分配，请求结束时一次性释放
+ *
+ * 优先使用当前线程的初始内存块，小请求不需要再向系统申请内存；
+ * 该内存块正在被其他未完成的请求(例如异步处理)使用时退化为普通 Arena。
+ * 可以在任意线程中析构，析构后初始内存块归还给创建它的线程。
+ */
+class RequestArena {
+ public:
+  RequestArena();
+
+  ~RequestArena();
+
+  RequestArena(const RequestArena&) = delete;
+  RequestArena& operator=(const RequestArena&) = delete;
+
+  google::protobuf::Arena* get() { return &(*arena_); }
+
+ private:
+  std::shared_ptr<ArenaBlock> block_;   // 未使用线程初始内存块时为空
+  std::optional<google::protobuf::Arena> arena_;
+};
+
+}
+
+#endif
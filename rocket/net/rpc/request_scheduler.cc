@@ -0,0 +1,536 @@
+#include "rocket/net/rpc/request_scheduler.h"
+#include "rocket/common/error_code.h"
+#include "rocket/logger/log.h"
+#include "rocket/net/event_loop.h"
+#include "rocket/net/rpc/rpc_controller.h"
+#include "rocket/net/rpc/rpc_dispatcher.h"
+#include "rocket/net/tcp/tcp_connection.h"
+#include <algorithm>
+#include <asio/post.hpp>
+#include <google/protobuf/stubs/callback.h>
+
+namespace rocket {
+
+static thread_local std::unique_ptr<RequestScheduler> t_request_scheduler;
+
+static const char *g_priority_names[] = {"critical", "high", "normal", "low"};
+
+// 本线程调用方数量超过该值时清理空闲调用方
+static const size_t g_caller_sweep_threshold = 1024;
+
+// 排队时延直方图的桶边界，us
+static const std::vector<int64_t> g_queue_delay_bounds = {
+    100, 500, 1000, 2000, 5000, 10000, 20000, 50000, 100000, 200000, 500000, 1000000};
+
+// 未注册的服务共用一个统计，避免请求携带任意服务名时指标无限增长
+static const char *g_unknown_service = "unknown";
+
+// 调用方标签的数量上限，超过后新的调用方共用 other 标签，避免轮换 client_id 时指标无限增长
+static const size_t g_max_caller_labels = 256;
+static const char *g_other_caller = "other";
+
+std::mutex RequestScheduler::s_stats_mutex_;
+std::unordered_map<std::string, std::weak_ptr<RequestScheduler::CallerStats>>
+    RequestScheduler::s_caller_stats_;
+std::unordered_set<std::string> RequestScheduler::s_caller_labels_;
+
+RequestScheduler *RequestScheduler::GetThreadScheduler() {
+  if (t_request_scheduler == nullptr) {
+    t_request_scheduler = std::make_unique<RequestScheduler>();
+  }
+  return t_request_scheduler.get();
+}
+
+RequestScheduler::RequestScheduler() {
+  if (Config::GetGlobalConfig()) {
+    config_ = Config::GetGlobalConfig()->scheduler_config_;
+  }
+  config_.dispatch_batch = std::max(config_.dispatch_batch, 1);
+  config_.fair_quantum = std::max(config_.fair_quantum, 1);
+
+  weights_[TinyPBProtocol::PRIORITY_CRITICAL] = 0;
+  weights_[TinyPBProtocol::PRIORITY_HIGH] = std::max(config_.weight_high, 1);
+  weights_[TinyPBProtocol::PRIORITY_NORMAL] = std::max(config_.weight_normal, 1);
+  weights_[TinyPBProtocol::PRIORITY_LOW] = std::max(config_.weight_low, 1);
+
+  MetricsRegistry *registry = MetricsRegistry::GetInstance();
+  for (int i = 0; i < kPriorityCount; ++i) {
+    credits_[i] = weights_[i];
+    std::string label = std::string("{priority=\"") + g_priority_names[i] + "\"}";
+    pending_gauges_[i] = registry->getGauge("rocket_server_pending_requests" + label);
+    shed_counters_[i] = registry->getCounter("rocket_server_shed_requests_total" + label);
+  }
+}
+
+void RequestScheduler::enqueue(std::shared_ptr<TinyPBProtocol> request,
+                               std::shared_ptr<TcpConnection> connection) {
+  uint8_t priority = request->priority_;
+  if (priority >= kPriorityCount) {
+    priority = TinyPBProtocol::PRIORITY_NORMAL;
+  }
+
+  PendingRequest req{request, connection, nullptr, getCodel(request)};
+  req.ticket = AdmissionController::GetInstance()->admitRequest(
+      connection->inflightCounter(), request->pk_len_);
+  if (!req.ticket) {
+    reject(req);
+    return;
+  }
+
+  if (config_.max_pending > 0 && pending_ >= (size_t)config_.max_pending &&
+      !makeRoom(priority)) {
+    shed_counters_[priority]->inc();
+    reject(req);
+    return;
+  }
+
+  CallerPtr caller = getCaller(callerKey(request, connection));
+  caller->queues[priority].push_back(std::move(req));
+  caller->queued++;
+  caller->stats->queue_gauge->add(1);
+  if (!caller->active[priority]) {
+    caller->active[priority] = true;
+    active_[priority].push_back(caller);
+  }
+
+  class_pending_[priority]++;
+  pending_++;
+  pending_gauges_[priority]->add(1);
+  scheduleDrain();
+}
+
+bool RequestScheduler::cancel(TcpConnection *connection, uint64_t req_id) {
+  for (auto &it : callers_) {
+    Caller &caller = *it.second;
+    for (int i = 0; i < kPriorityCount; ++i) {
+      auto &queue = caller.queues[i];
+      for (auto req = queue.begin(); req != queue.end(); ++req) {
+        if (req->connection.get() == connection &&
+            req->request->req_id_ == req_id) {
+          queue.erase(req);
+          caller.queued--;
+          caller.stats->queue_gauge->add(-1);
+          class_pending_[i]--;
+          pending_--;
+          pending_gauges_[i]->add(-1);
+          return true;
+        }
+      }
+    }
+  }
+  return false;
+}
+
+std::string
+RequestScheduler::callerKey(const std::shared_ptr<TinyPBProtocol> &request,
+                            const std::shared_ptr<TcpConnection> &connection) {
+  // 同一调用方的多个连接按 IP 归为一组
+  if (!request->client_id_.empty()) {
+    return request->client_id_;
+  }
+  return connection->getPeerAddr().address().to_string();
+}
+
+RequestScheduler::CallerPtr RequestScheduler::getCaller(const std::string &key) {
+  auto it = callers_.find(key);
+  if (it != callers_.end()) {
+    return it->second;
+  }
+
+  if (callers_.size() >= g_caller_sweep_threshold) {
+    sweepCallers();
+  }
+  CallerPtr caller = std::make_shared<Caller>();
+  caller->key = key;
+  caller->stats = getCallerStats(key);
+  caller->scheduler = this;
+  caller->io_context = EventLoop::getThreadEventLoop()->getIOContext();
+  callers_[key] = caller;
+  return caller;
+}
+
+std::shared_ptr<RequestScheduler::CallerStats>
+RequestScheduler::getCallerStats(const std::string &key) {
+  std::scoped_lock<std::mutex> lock(s_stats_mutex_);
+  auto it = s_caller_stats_.find(key);
+  if (it != s_caller_stats_.end()) {
+    std::shared_ptr<CallerStats> stats = it->second.lock();
+    if (stats) {
+      return stats;
+    }
+  }
+
+  if (s_caller_stats_.size() >= g_caller_sweep_threshold) {
+    for (auto iter = s_caller_stats_.begin(); iter != s_caller_stats_.end();) {
+      if (iter->second.expired()) {
+        iter = s_caller_stats_.erase(iter);
+      } else {
+        ++iter;
+      }
+    }
+  }
+
+  std::shared_ptr<CallerStats> stats = std::make_shared<CallerStats>();
+  std::string label = "{caller=\"" + callerLabel(key) + "\"}";
+  MetricsRegistry *registry = MetricsRegistry::GetInstance();
+  stats->queue_gauge = registry->getGauge("rocket_server_caller_queue_depth" + label);
+  stats->inflight_gauge = registry->getGauge("rocket_server_caller_inflight" + label);
+  stats->dispatch_counter = registry->getCounter("rocket_server_caller_requests_total" + label);
+  s_caller_stats_[key] = stats;
+  return stats;
+}
+
+std::string RequestScheduler::callerLabel(const std::string &key) {
+  // client_id 是客户端任意指定的字节，只保留标签中安全的字符，其余替换为 '_'
+  std::string label = key;
+  for (char &c : label) {
+    bool safe = (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') ||
+                (c >= '0' && c <= '9') || c == '_' || c == '.' || c == ':' ||
+                c == '-';
+    if (!safe) {
+      c = '_';
+    }
+  }
+  if (s_caller_labels_.count(label) > 0) {
+    return label;
+  }
+  if (s_caller_labels_.size() >= g_max_caller_labels) {
+    return g_other_caller;
+  }
+  s_caller_labels_.insert(label);
+  return label;
+}
+
+void RequestScheduler::sweepCallers() {
+  for (auto it = callers_.begin(); it != callers_.end();) {
+    if (it->second->queued == 0 && !it->second->waiting) {
+      it = callers_.erase(it);
+    } else {
+      ++it;
+    }
+  }
+}
+
+void RequestScheduler::scheduleDrain() {
+  if (drain_scheduled_) {
+    return;
+  }
+  drain_scheduled_ = true;
+  asio::post(*EventLoop::getThreadEventLoop()->getIOContext(),
+             [this]() { drain(); });
+}
+
+/*
+ * 每次最多分发 dispatch_batch 个请求，剩余的请求重新投递，
+ * 期间 IO 线程可以先读取其他连接的新请求，高优先级请求得以插队
+ * 所有排队的调用方都达到在途上限时停止，等请求完成后再唤醒
+ */
+void RequestScheduler::drain() {
+  drain_scheduled_ = false;
+
+  PendingRequest req;
+  CallerPtr caller;
+  int dispatched = 0;
+  while (dispatched < config_.dispatch_batch && pop(req, caller)) {
+    dispatched++;
+    if (!req.connection->is_open()) {
+      continue;
+    }
+
+    int64_t now_us = getSteadyNowUs();
+    int64_t delay_us = std::max<int64_t>(0, now_us - req.request->arrive_us_);
+    if (req.request->arrive_us_ > 0 && codelShouldDrop(*req.codel, delay_us, now_us)) {
+      req.codel->drop_counter->inc();
+      DEBUGLOG("%lu | queue delay %ld us exceeds limit, shed request[%s]",
+               req.request->req_id_, delay_us,
+               req.request->method_name_.c_str());
+      reject(req);
+      continue;
+    }
+
+    caller->stats->inflight++;
+    caller->stats->inflight_gauge->add(1);
+    caller->stats->dispatch_counter->inc();
+
+    std::shared_ptr<TinyPBProtocol> response = ObjectPool<TinyPBProtocol>::Get();
+    std::shared_ptr<RpcController> controller =
+        RpcDispatcher::GetRpcDispatcher()->dispatch(req.request, response,
+                                                    req.connection);
+    if (controller) {
+      // 请求完成或被取消时归还在途名额，已经完成时立即回调
+      controller->NotifyOnCancel(google::protobuf::NewCallback(
+          &RequestScheduler::onRequestDone, caller, req.ticket));
+    } else {
+      onRequestDone(caller, req.ticket);
+    }
+    req.ticket.reset();
+  }
+  req = PendingRequest();
+  caller.reset();
+
+  if (dispatched >= config_.dispatch_batch && pending_ > 0) {
+    scheduleDrain();
+  }
+}
+
+void RequestScheduler::onRequestDone(CallerPtr caller,
+                                     AdmissionController::TicketPtr ticket) {
+  // ticket 随回调对象一起析构，归还准入名额
+  int prev = caller->stats->inflight.fetch_sub(1);
+  caller->stats->inflight_gauge->add(-1);
+
+  int limit = caller->scheduler->config_.max_inflight_per_caller;
+  if (limit <= 0 || prev < limit) {
+    return;
+  }
+
+  // 调用方从在途上限恢复，唤醒所有因它暂停的线程
+  std::vector<CallerPtr> waiters;
+  {
+    std::scoped_lock<std::mutex> lock(caller->stats->waiters_mutex);
+    waiters.swap(caller->stats->waiters);
+  }
+  for (auto &waiter : waiters) {
+    asio::post(*waiter->io_context, [waiter]() {
+      waiter->waiting = false;
+      waiter->scheduler->scheduleDrain();
+    });
+  }
+}
+
+bool RequestScheduler::pop(PendingRequest &out, CallerPtr &caller) {
+  if (pending_ == 0) {
+    return false;
+  }
+
+  if (popClass(TinyPBProtocol::PRIORITY_CRITICAL, out, caller)) {
+    return true;
+  }
+
+  // 本轮额度用完后重新发放，最多两轮
+  for (int round = 0; round < 2; ++round) {
+    for (int i = TinyPBProtocol::PRIORITY_HIGH; i < kPriorityCount; ++i) {
+      if (credits_[i] > 0 && popClass(i, out, caller)) {
+        credits_[i]--;
+        return true;
+      }
+    }
+    for (int i = 0; i < kPriorityCount; ++i) {
+      credits_[i] = weights_[i];
+    }
+  }
+  return false;
+}
+
+bool RequestScheduler::popClass(int priority, PendingRequest &out,
+                                CallerPtr &caller) {
+  auto &ring = active_[priority];
+  size_t blocked = 0;
+  while (!ring.empty()) {
+    CallerPtr current = ring.front();
+    if (current->queues[priority].empty()) {
+      ring.pop_front();
+      current->active[priority] = false;
+      current->deficit[priority] = 0;
+      current->turn_started[priority] = false;
+      continue;
+    }
+
+    if (callerBlocked(current)) {
+      ring.pop_front();
+      ring.push_back(current);
+      if (++blocked >= ring.size()) {
+        return false;
+      }
+      continue;
+    }
+
+    // 每轮开始时发放一次额度，额度足够就继续服务同一个调用方
+    if (!current->turn_started[priority]) {
+      current->deficit[priority] += config_.fair_quantum;
+      current->turn_started[priority] = true;
+    }
+    auto &queue = current->queues[priority];
+    int64_t cost = costOf(takeBack(*current, priority) ? queue.back() : queue.front());
+    if (current->deficit[priority] >= cost || ring.size() == 1) {
+      current->deficit[priority] =
+          std::max<int64_t>(0, current->deficit[priority] - cost);
+      removeNext(*current, priority, out);
+      caller = current;
+      return true;
+    }
+
+    // 额度不够，留到下一轮
+    current->turn_started[priority] = false;
+    ring.pop_front();
+    ring.push_back(current);
+    blocked = 0;
+  }
+  return false;
+}
+
+void RequestScheduler::removeNext(Caller &caller, int priority,
+                                  PendingRequest &out) {
+  auto &queue = caller.queues[priority];
+  if (takeBack(caller, priority)) {
+    out = std::move(queue.back());
+    queue.pop_back();
+  } else {
+    out = std::move(queue.front());
+    queue.pop_front();
+  }
+  caller.queued--;
+  caller.stats->queue_gauge->add(-1);
+  class_pending_[priority]--;
+  pending_--;
+  pending_gauges_[priority]->add(-1);
+}
+
+bool RequestScheduler::takeBack(const Caller &caller, int priority) const {
+  const PendingRequest &newest = caller.queues[priority].back();
+  return newest.codel->config.enable && newest.codel->config.lifo &&
+         newest.codel->overloaded;
+}
+
+RequestScheduler::CodelState *
+RequestScheduler::getCodel(const std::shared_ptr<TinyPBProtocol> &request) {
+  const MethodEntry *entry = RpcDispatcher::GetRpcDispatcher()->resolveMethod(request);
+  if (entry == nullptr) {
+    // 流式方法等不在方法表中的请求按名字中的服务名归类
+    const std::string &full_name = request->method_name_;
+    std::string service_name = full_name.substr(0, full_name.find('.'));
+    if (!RpcDispatcher::GetRpcDispatcher()->hasService(service_name)) {
+      service_name = g_unknown_service;
+    }
+    return getServiceCodel(service_name);
+  }
+  size_t index = request->method_index_;
+  if (index >= method_codels_.size()) {
+    method_codels_.resize(index + 1, nullptr);
+  }
+  if (method_codels_[index] == nullptr) {
+    method_codels_[index] = getServiceCodel(entry->service_name);
+  }
+  return method_codels_[index];
+}
+
+RequestScheduler::CodelState *
+RequestScheduler::getServiceCodel(const std::string &service_name) {
+  auto &codel = codels_[service_name];
+  if (codel) {
+    return codel.get();
+  }
+
+  codel = std::make_unique<CodelState>();
+  codel->service = service_name;
+  if (Config::GetGlobalConfig()) {
+    Config *config = Config::GetGlobalConfig();
+    auto it = config->service_codel_config_.find(service_name);
+    codel->config = it != config->service_codel_config_.end()
+                        ? it->second
+                        : config->codel_config_;
+  }
+  codel->config.target_ms = std::max(codel->config.target_ms, 1);
+  codel->config.interval_ms = std::max(codel->config.interval_ms, 1);
+
+  std::string label = "{service=\"" + service_name + "\"}";
+  MetricsRegistry *registry = MetricsRegistry::GetInstance();
+  codel->delay_histogram =
+      registry->getHistogram("rocket_server_queue_delay_us" + label, g_queue_delay_bounds);
+  codel->drop_counter = registry->getCounter("rocket_server_codel_drops_total" + label);
+  return codel.get();
+}
+
+bool RequestScheduler::codelShouldDrop(CodelState &codel, int64_t delay_us,
+                                       int64_t now_us) {
+  codel.delay_histogram->observe(delay_us);
+  if (!codel.config.enable) {
+    return false;
+  }
+
+  int64_t target_us = (int64_t)codel.config.target_ms * 1000;
+  int64_t interval_us = (int64_t)codel.config.interval_ms * 1000;
+
+  // 一个周期内最小排队时延都高于 target，说明队列一直没有排空，判定为过载
+  if (now_us >= codel.interval_end_us) {
+    bool overloaded = codel.min_delay_us > target_us;
+    if (overloaded != codel.overloaded) {
+      INFOLOG("service[%s] queue delay %s, min delay %ld us, target %ld us",
+              codel.service.c_str(), overloaded ? "overloaded" : "recovered",
+              codel.min_delay_us, target_us);
+    }
+    codel.overloaded = overloaded;
+    codel.min_delay_us = delay_us;
+    codel.interval_end_us = now_us + interval_us;
+  } else if (codel.min_delay_us < 0 || delay_us < codel.min_delay_us) {
+    codel.min_delay_us = delay_us;
+  }
+
+  int64_t shed_us = codel.overloaded ? target_us : interval_us;
+  return delay_us > shed_us;
+}
+
+bool RequestScheduler::callerBlocked(const CallerPtr &caller) {
+  int limit = config_.max_inflight_per_caller;
+  if (limit <= 0 || caller->stats->inflight.load() < limit) {
+    return false;
+  }
+
+  // 登记为等待者，在途请求完成后唤醒本线程
+  if (!caller->waiting) {
+    caller->waiting = true;
+    std::scoped_lock<std::mutex> lock(caller->stats->waiters_mutex);
+    caller->stats->waiters.push_back(caller);
+  }
+
+  // 登记期间名额可能已经释放
+  return caller->stats->inflight.load() >= limit;
+}
+
+int64_t RequestScheduler::costOf(const PendingRequest &req) const {
+  // 以 KB 计的请求体大小，至少为 1
+  return 1 + (int64_t)(req.request->pb_data_.length() >> 10);
+}
+
+bool RequestScheduler::makeRoom(uint8_t priority) {
+  // 从比新请求优先级更低的请求中，丢弃排队最长的调用方最晚入队的请求
+  for (int i = kPriorityCount - 1; i > priority; --i) {
+    if (class_pending_[i] == 0) {
+      continue;
+    }
+    CallerPtr victim_caller;
+    for (auto &caller : active_[i]) {
+      if (!victim_caller ||
+          caller->queues[i].size() > victim_caller->queues[i].size()) {
+        victim_caller = caller;
+      }
+    }
+    if (!victim_caller || victim_caller->queues[i].empty()) {
+      continue;
+    }
+
+    PendingRequest victim = std::move(victim_caller->queues[i].back());
+    victim_caller->queues[i].pop_back();
+    victim_caller->queued--;
+    victim_caller->stats->queue_gauge->add(-1);
+    class_pending_[i]--;
+    pending_--;
+    pending_gauges_[i]->add(-1);
+    shed_counters_[i]->inc();
+    reject(victim);
+    return true;
+  }
+  return false;
+}
+
+void RequestScheduler::reject(PendingRequest &req) {
+  if (!req.connection->is_open()) {
+    return;
+  }
+  DEBUGLOG("%lu | server overload, reject request[%s]",
+           req.request->req_id_, req.request->method_name_.c_str());
+  RpcDispatcher::GetRpcDispatcher()->replyError(
+      req.request, req.connection, ERROR_RPC_SERVER_OVERLOAD, "server overload");
+}
+
+} // namespace rocket
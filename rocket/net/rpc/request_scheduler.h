@@ -0,0 +1,181 @@
+#ifndef ROCKET_NET_RPC_REQUEST_SCHEDULER_H
+#define ROCKET_NET_RPC_REQUEST_SCHEDULER_H
+
+#include "rocket/common/config.h"
+#include "rocket/common/metrics.h"
+#include "rocket/net/coder/tinypb_protocol.h"
+#include "rocket/net/tcp/admission_controller.h"
+#include <asio/io_context.hpp>
+#include <atomic>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+namespace rocket {
+
+class TcpConnection;
+
+/**
+ * @brief 服务端待分发请求的调度队列，每个 IO 线程一个，只在所属线程中访问
+ *
+ * 连接解码出的请求先进入队列，再由投递到 IO 线程的分发任务按优先级取出执行：
+ * 1. critical 优先级严格优先，其余优先级按配置的权重加权轮询
+ * 2. 同一优先级内按调用方(client_id，没有时为对端 IP)做 DRR，请求体越大消耗的额度越多，
+ *    单个调用方大量流水线请求也只能拿到自己的份额
+ * 3. 调用方正在处理的请求数达到 max_inflight_per_caller 时暂停调度它的请求
+ * 4. 每轮最多分发 dispatch_batch 个请求后让出线程，新到达的高优先级请求可以插到积压请求之前
+ * 5. 排队请求数达到 max_pending 时从最低优先级中排队最长的调用方开始丢弃，被丢弃的请求直接回复过载错误
+ * 请求入队前先经过 AdmissionController 准入，超过全局/连接的在途上限或字节上限时直接回复过载错误
+ *
+ * 分发前按服务统计排队时延(从连接解码出请求到开始分发)，开启 CoDel 的服务：
+ * 1. 每个 interval 结束时，若期间最小排队时延高于 target 则进入过载状态，否则恢复
+ * 2. 过载时排队超过 target 的请求直接回复过载错误，未过载时只丢弃排队超过 interval 的请求
+ * 3. 配置了 lifo 的服务过载时改为后到先服务，新请求不必等积压请求排完
+ */
+class RequestScheduler {
+private:
+  struct CodelState;
+
+public:
+  struct PendingRequest {
+    std::shared_ptr<TinyPBProtocol> request;
+    std::shared_ptr<TcpConnection> connection;
+    AdmissionController::TicketPtr ticket;  // 请求结束时释放准入名额
+    CodelState *codel{nullptr};             // 所属服务的排队时延状态
+  };
+
+  RequestScheduler();
+
+  static RequestScheduler *GetThreadScheduler();
+
+  // 请求入队，并在需要时投递分发任务
+  void enqueue(std::shared_ptr<TinyPBProtocol> request,
+               std::shared_ptr<TcpConnection> connection);
+
+  // 删除仍在排队的请求，返回是否找到
+  bool cancel(TcpConnection *connection, uint64_t req_id);
+
+  size_t pendingSize() const { return pending_; }
+
+private:
+  static const int kPriorityCount = TinyPBProtocol::PRIORITY_COUNT;
+
+  struct Caller;
+
+  // 调用方的全局统计，所有 IO 线程共享
+  struct CallerStats {
+    std::atomic<int> inflight{0};
+    std::mutex waiters_mutex;
+    std::vector<std::shared_ptr<Caller>> waiters;  // 因在途上限暂停调度的各线程队列
+    Gauge *queue_gauge{nullptr};
+    Gauge *inflight_gauge{nullptr};
+    Counter *dispatch_counter{nullptr};
+  };
+
+  // 调用方在本线程的排队状态
+  struct Caller {
+    std::string key;
+    std::shared_ptr<CallerStats> stats;
+    RequestScheduler *scheduler{nullptr};
+    asio::io_context *io_context{nullptr};
+
+    std::deque<PendingRequest> queues[kPriorityCount];
+    int64_t deficit[kPriorityCount] = {0};
+    bool turn_started[kPriorityCount] = {false};  // 本轮是否已经发放过额度
+    bool active[kPriorityCount] = {false};        // 是否在 DRR 环中
+    bool waiting{false};                          // 是否已登记为在途上限的等待者
+    size_t queued{0};
+  };
+
+  using CallerPtr = std::shared_ptr<Caller>;
+
+  // 服务在本线程的排队时延状态
+  struct CodelState {
+    std::string service;
+    CodelConfig config;
+    int64_t interval_end_us{0};
+    int64_t min_delay_us{-1};   // 本周期最小排队时延，-1 表示还没有样本
+    bool overloaded{false};
+    Histogram *delay_histogram{nullptr};
+    Counter *drop_counter{nullptr};
+  };
+
+  std::string callerKey(const std::shared_ptr<TinyPBProtocol> &request,
+                        const std::shared_ptr<TcpConnection> &connection);
+
+  CallerPtr getCaller(const std::string &key);
+
+  std::shared_ptr<CallerStats> getCallerStats(const std::string &key);
+
+  // 调用方在指标中的标签值，调用时需持有 s_stats_mutex_
+  static std::string callerLabel(const std::string &key);
+
+  void scheduleDrain();
+
+  void drain();
+
+  bool pop(PendingRequest &out, CallerPtr &caller);
+
+  // 在一个优先级内按 DRR 挑选调用方，所有调用方都达到在途上限时返回 false
+  bool popClass(int priority, PendingRequest &out, CallerPtr &caller);
+
+  // 取出调用方在该优先级的下一个请求，服务过载且开启 lifo 时取最晚入队的
+  void removeNext(Caller &caller, int priority, PendingRequest &out);
+
+  bool takeBack(const Caller &caller, int priority) const;
+
+  // 请求所属服务的排队时延状态，同时解析请求的方法，之后分发时直接按下标取出
+  CodelState *getCodel(const std::shared_ptr<TinyPBProtocol> &request);
+
+  CodelState *getServiceCodel(const std::string &service_name);
+
+  // 记录排队时延，返回是否应该丢弃该请求
+  bool codelShouldDrop(CodelState &codel, int64_t delay_us, int64_t now_us);
+
+  bool callerBlocked(const CallerPtr &caller);
+
+  int64_t costOf(const PendingRequest &req) const;
+
+  // 队列已满时腾出位置，返回 false 表示应该丢弃新请求
+  bool makeRoom(uint8_t priority);
+
+  void reject(PendingRequest &req);
+
+  // 清理没有排队请求的调用方
+  void sweepCallers();
+
+  // 请求处理完成或被取消，在业务线程调用
+  static void onRequestDone(CallerPtr caller, AdmissionController::TicketPtr ticket);
+
+private:
+  SchedulerConfig config_;
+
+  std::unordered_map<std::string, CallerPtr> callers_;
+  std::unordered_map<std::string, std::unique_ptr<CodelState>> codels_; // key 为服务名
+  std::vector<CodelState *> method_codels_;  // 按方法表下标缓存 codels_ 中的项
+  std::deque<CallerPtr> active_[kPriorityCount]; // 每个优先级的 DRR 环
+  size_t class_pending_[kPriorityCount] = {0};
+
+  int weights_[kPriorityCount];
+  int credits_[kPriorityCount]; // 加权轮询本轮剩余额度
+  size_t pending_{0};
+  bool drain_scheduled_{false};
+
+  Gauge *pending_gauges_[kPriorityCount];
+  Counter *shed_counters_[kPriorityCount];
+
+  // 调用方统计按 key 全局共享，不再被任何线程引用时失效
+  static std::mutex s_stats_mutex_;
+  static std::unordered_map<std::string, std::weak_ptr<CallerStats>> s_caller_stats_;
+  // 已经用作指标标签的调用方，指标不会删除，数量有上限
+  static std::unordered_set<std::string> s_caller_labels_;
+};
+
+} // namespace rocket
+
+#endif
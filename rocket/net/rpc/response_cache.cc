@@ -0,0 +1,125 @@
+#include "rocket/net/rpc/response_cache.h"
+#include "rocket/common/config.h"
+#include "rocket/common/util.h"
+#include "rocket/logger/log.h"
+#include <functional>
+#include <string_view>
+
+namespace rocket {
+
+// 每个缓存项除请求和响应外的固定开销(链表节点、索引项等)的估计值
+static const size_t kItemOverhead = 128;
+
+static Gauge *bytesGauge() {
+  static Gauge *gauge = MetricsRegistry::GetInstance()->getGauge("rocket_response_cache_bytes");
+  return gauge;
+}
+
+static Gauge *itemsGauge() {
+  static Gauge *gauge = MetricsRegistry::GetInstance()->getGauge("rocket_response_cache_items");
+  return gauge;
+}
+
+static Counter *evictionsCounter() {
+  static Counter *counter = MetricsRegistry::GetInstance()->getCounter("rocket_response_cache_evictions_total");
+  return counter;
+}
+
+ResponseCache::ResponseCache() {
+  ResponseCacheConfig config;
+  if (Config::GetGlobalConfig()) {
+    config = Config::GetGlobalConfig()->response_cache_config_;
+  }
+  if (config.max_bytes <= 0) {
+    return;
+  }
+  int shards = config.shards > 0 ? config.shards : 1;
+  shard_capacity_ = static_cast<size_t>(config.max_bytes) / shards;
+  for (int i = 0; i < shards; ++i) {
+    shards_.emplace_back(new Shard());
+  }
+}
+
+std::shared_ptr<ResponseCachePolicy> ResponseCache::NewPolicy(const std::string &method_full_name, int ttl_ms) {
+  std::shared_ptr<ResponseCachePolicy> policy = std::make_shared<ResponseCachePolicy>();
+  std::string label = "{method=\"" + method_full_name + "\"}";
+  policy->ttl_ms = ttl_ms;
+  policy->hits = MetricsRegistry::GetInstance()->getCounter("rocket_response_cache_hits_total" + label);
+  policy->misses = MetricsRegistry::GetInstance()->getCounter("rocket_response_cache_misses_total" + label);
+  return policy;
+}
+
+uint64_t ResponseCache::hashKey(uint32_t method_index, const std::string &request) {
+  uint64_t hash = std::hash<std::string_view>()(std::string_view(request));
+  return hash ^ (static_cast<uint64_t>(method_index) * 0x9e3779b97f4a7c15ull);
+}
+
+bool ResponseCache::lookup(uint32_t method_index, const std::string &request, std::string &response) {
+  if (!enabled()) {
+    return false;
+  }
+  uint64_t hash = hashKey(method_index, request);
+  Shard &shard = shardOf(hash);
+  std::scoped_lock<std::mutex> lock(shard.mutex);
+  auto it = shard.index.find(hash);
+  if (it == shard.index.end()) {
+    return false;
+  }
+  Item &item = *it->second;
+  if (item.expire_ms <= getNowMs()) {
+    erase(shard, it->second);
+    return false;
+  }
+  if (item.method_index != method_index || item.request != request) {
+    return false;
+  }
+  shard.lru.splice(shard.lru.begin(), shard.lru, it->second);
+  response = item.response;
+  return true;
+}
+
+void ResponseCache::insert(uint32_t method_index, const std::string &request, const std::string &response, int ttl_ms) {
+  if (!enabled() || ttl_ms <= 0) {
+    return;
+  }
+  size_t charge = request.size() + response.size() + kItemOverhead;
+  if (charge > shard_capacity_) {
+    return;
+  }
+
+  uint64_t hash = hashKey(method_index, request);
+  Shard &shard = shardOf(hash);
+  std::scoped_lock<std::mutex> lock(shard.mutex);
+  auto it = shard.index.find(hash);
+  if (it != shard.index.end()) {
+    erase(shard, it->second);
+  }
+
+  while (!shard.lru.empty() && shard.bytes + charge > shard_capacity_) {
+    erase(shard, std::prev(shard.lru.end()));
+    evictionsCounter()->inc();
+  }
+
+  shard.lru.emplace_front();
+  Item &item = shard.lru.front();
+  item.hash = hash;
+  item.method_index = method_index;
+  item.expire_ms = getNowMs() + ttl_ms;
+  item.request = request;
+  item.response = response;
+  item.charge = charge;
+  shard.index[hash] = shard.lru.begin();
+  shard.bytes += charge;
+  bytesGauge()->add(charge);
+  itemsGauge()->add(1);
+}
+
+void ResponseCache::erase(Shard &shard, std::list<Item>::iterator it) {
+  shard.bytes -= it->charge;
+  bytesGauge()->add(-static_cast<int64_t>(it->charge));
+  itemsGauge()->add(-1);
+  shard.index.erase(it->hash);
+  shard.lru.erase(it);
+}
+
+} // namespace rocket
@@ -0,0 +1,77 @@
+#ifndef ROCKET_NET_RPC_RESPONSE_CACHE_H
+#define ROCKET_NET_RPC_RESPONSE_CACHE_H
+
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "rocket/common/metrics.h"
+#include "rocket/common/singleton.h"
+
+namespace rocket {
+
+// 方法的缓存策略，保存在方法表中，启用后只读
+struct ResponseCachePolicy {
+  int ttl_ms{0};
+  Counter *hits{nullptr};
+  Counter *misses{nullptr};
+};
+
+/**
+ * @brief 服务端响应缓存
+ *
+ * key 为方法表下标加请求 pb_data 的哈希(方法 id 可能冲突，不能用来区分方法)，value 为已经序列化好的响应，命中时跳过反序列化、
+ * 业务处理和序列化。缓存项同时保存请求内容，哈希相同时逐字节比较，不会返回错误的响应。
+ * 按哈希分片，每个分片一把锁、一个 LRU 链表，占用超过 max_bytes / shards 时淘汰最久未使用的项，
+ * 过期的项在查找时删除。
+ */
+class ResponseCache : public Singleton<ResponseCache> {
+public:
+  ResponseCache();
+
+  // 为方法创建缓存策略，统计按方法名打标签
+  static std::shared_ptr<ResponseCachePolicy> NewPolicy(const std::string &method_full_name, int ttl_ms);
+
+  bool enabled() const { return !shards_.empty(); }
+
+  // 命中时把缓存的响应拷贝到 response 中
+  bool lookup(uint32_t method_index, const std::string &request, std::string &response);
+
+  void insert(uint32_t method_index, const std::string &request, const std::string &response, int ttl_ms);
+
+private:
+  struct Item {
+    uint64_t hash{0};
+    uint32_t method_index{0};
+    int64_t expire_ms{0};
+    std::string request;
+    std::string response;
+    size_t charge{0};   // 计入容量的字节数
+  };
+
+  struct Shard {
+    std::mutex mutex;
+    std::list<Item> lru;   // 头部为最近使用
+    std::unordered_map<uint64_t, std::list<Item>::iterator> index;   // 哈希冲突时后插入的覆盖先插入的
+    size_t bytes{0};
+  };
+
+  static uint64_t hashKey(uint32_t method_index, const std::string &request);
+
+  Shard &shardOf(uint64_t hash) { return *shards_[(hash >> 32) % shards_.size()]; }
+
+  // 调用时需持有分片的锁
+  void erase(Shard &shard, std::list<Item>::iterator it);
+
+private:
+  std::vector<std::unique_ptr<Shard>> shards_;
+  size_t shard_capacity_{0};
+};
+
+} // namespace rocket
+
+#endif
@@ -0,0 +1,154 @@
+#include "rocket/net/rpc/rpc_batch.h"
+#include "rocket/common/error_code.h"
+#include "rocket/common/msg_id_util.h"
+#include "rocket/logger/log.h"
+#include "rocket/net/coder/tinypb_coder.h"
+#include "rocket/net/rpc/co_call.h"
+#include "rocket/net/rpc/rpc_channel.h"
+#include <google/protobuf/descriptor.h>
+#include <google/protobuf/message.h>
+
+namespace rocket {
+
+RpcBatch::RpcBatch(std::vector<tcp::endpoint> peer_addrs)
+    : peer_addrs_(peer_addrs) {}
+
+void RpcBatch::CallMethod(const google::protobuf::MethodDescriptor *method,
+                          google::protobuf::RpcController *controller,
+                          const google::protobuf::Message *request,
+                          google::protobuf::Message *response,
+                          google::protobuf::Closure *done) {
+  Call call;
+  call.method = method;
+  call.controller = dynamic_cast<RpcController *>(controller);
+  call.request = request;
+  call.response = response;
+  call.done = done;
+  add(call);
+}
+
+void RpcBatch::add(const Call &call) {
+  if (call.method == nullptr || call.controller == nullptr ||
+      call.request == nullptr || call.response == nullptr) {
+    ERRORLOG("add batch call failed, method or controller or request or response NULL");
+    if (call.controller) {
+      call.controller->SetError(ERROR_RPC_CHANNEL_INIT,
+                                "controller or request or response NULL");
+      call.controller->SetFinished(true);
+    }
+    if (call.done) {
+      call.done->Run();
+    }
+    return;
+  }
+  calls_.push_back(call);
+}
+
+void RpcBatch::add(const std::vector<Call> &calls) {
+  calls_.reserve(calls_.size() + calls.size());
+  for (auto &call : calls) {
+    add(call);
+  }
+}
+
+asio::awaitable<void>
+RpcBatch::commit(std::shared_ptr<RpcController> controller) {
+  std::shared_ptr<BatchState> state = std::make_shared<BatchState>();
+  state->calls.swap(calls_);
+  state->completed.resize(state->calls.size(), false);
+
+  // 每个调用单独编码，req_id 用于把响应对应回调用
+  std::vector<std::shared_ptr<TinyPBProtocol>> items;
+  items.reserve(state->calls.size());
+  for (size_t i = 0; i < state->calls.size(); ++i) {
+    Call &call = state->calls[i];
+    std::shared_ptr<TinyPBProtocol> item = ObjectPool<TinyPBProtocol>::Get();
+    call.controller->SetReqId(MsgIDUtil::GenReqId());
+    item->req_id_ = call.controller->GetReqId();
+    item->method_name_ = call.method->full_name();
+    if (!call.request->SerializeToString(&(item->pb_data_))) {
+      ERRORLOG("%lu | failed to serialize batch call", item->req_id_);
+      call.controller->SetError(ERROR_FAILED_SERIALIZE, "failde to serialize");
+      state->completed[i] = true;
+      continue;
+    }
+    state->index[item->req_id_] = i;
+    items.push_back(item);
+  }
+
+  if (items.empty()) {
+    finish(state, controller.get());
+    co_return;
+  }
+
+  // 批量帧的 method_name 取第一个调用的方法，只用于服务端日志和按服务统计
+  std::shared_ptr<TinyPBProtocol> req_protocol = ObjectPool<TinyPBProtocol>::Get();
+  req_protocol->msg_type_ = TinyPBProtocol::MSG_BATCH;
+  req_protocol->method_name_ = items[0]->method_name_;
+  TinyPBCoder::encodeBatch(items, req_protocol->pb_data_);
+  DEBUGLOG("commit batch of %lu calls, %lu bytes", items.size(),
+           req_protocol->pb_data_.length());
+
+  std::shared_ptr<rocket::RpcChannel> channel =
+      std::make_shared<rocket::RpcChannel>(peer_addrs_);
+  channel->Init(controller, nullptr, nullptr, nullptr);
+  co_await asyncFinish(controller.get(), [channel, req_protocol, state]() {
+    channel->CallProtocol(req_protocol, [state](std::shared_ptr<TinyPBProtocol> rsp) {
+      return parseResponse(state, rsp);
+    });
+  });
+
+  finish(state, controller.get());
+}
+
+bool RpcBatch::parseResponse(std::shared_ptr<BatchState> state,
+                             std::shared_ptr<TinyPBProtocol> rsp_protocol) {
+  // 已经超时返回，调用方的 response 可能已经释放
+  if (state->finished) {
+    return true;
+  }
+
+  std::vector<std::shared_ptr<TinyPBProtocol>> results;
+  if (!TinyPBCoder::decodeBatch(rsp_protocol->pb_data_, results)) {
+    return false;
+  }
+
+  for (auto &result : results) {
+    auto it = state->index.find(result->req_id_);
+    if (it == state->index.end() || state->completed[it->second]) {
+      ERRORLOG("%lu | unexpected call in batch response", result->req_id_);
+      continue;
+    }
+    Call &call = state->calls[it->second];
+    state->completed[it->second] = true;
+
+    if (result->err_code_ != 0) {
+      call.controller->SetError(result->err_code_, result->err_info_);
+    } else if (!call.response->ParseFromString(result->pb_data_)) {
+      ERRORLOG("%lu | serialize error", result->req_id_);
+      call.controller->SetError(ERROR_FAILED_DESERIALIZE, "serialize error");
+    }
+  }
+  return true;
+}
+
+void RpcBatch::finish(std::shared_ptr<BatchState> state,
+                      RpcController *controller) {
+  state->finished = true;
+  for (size_t i = 0; i < state->calls.size(); ++i) {
+    Call &call = state->calls[i];
+    if (!state->completed[i]) {
+      if (controller->Failed()) {
+        call.controller->SetError(controller->GetErrorCode(), controller->GetErrorInfo());
+      } else {
+        call.controller->SetError(ERROR_RPC_BATCH_MISSING, "call missing in batch response");
+      }
+    }
+    call.controller->SetFinished(true);
+    if (call.done) {
+      call.done->Run();
+    }
+  }
+}
+
+} // namespace rocket
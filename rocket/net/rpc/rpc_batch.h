@@ -0,0 +1,79 @@
+#ifndef ROCKET_NET_RPC_RPC_BATCH_H
+#define ROCKET_NET_RPC_RPC_BATCH_H
+
+#include "rocket/net/coder/tinypb_protocol.h"
+#include "rocket/net/rpc/rpc_controller.h"
+#include <asio/awaitable.hpp>
+#include <asio/ip/tcp.hpp>
+#include <google/protobuf/service.h>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace rocket {
+
+using asio::ip::tcp;
+
+/**
+ * @brief 批量调用，把多个调用合并为一个 TinyPB 批量帧发送，服务端分别执行后合并为一个响应
+ *
+ * 用法：
+ *   RpcBatch batch(RpcChannel::FindAddr("Order"));
+ *   Order_Stub stub(&batch);
+ *   stub.makeOrder(controller1.get(), request1.get(), response1.get(), nullptr);  // 只记录，不发送
+ *   stub.makeOrder(controller2.get(), request2.get(), response2.get(), nullptr);
+ *   co_await batch.commit(batch_controller);
+ *
+ * batch_controller 控制整个批量请求的超时和优先级，每个调用的结果记录在各自的 controller 中，
+ * 批量请求本身失败(超时、连接失败等)时所有调用都置为相同的错误
+ */
+class RpcBatch : public google::protobuf::RpcChannel {
+public:
+  struct Call {
+    const google::protobuf::MethodDescriptor *method{nullptr};
+    RpcController *controller{nullptr};
+    const google::protobuf::Message *request{nullptr};
+    google::protobuf::Message *response{nullptr};
+    google::protobuf::Closure *done{nullptr};   // 结果返回后调用，可以为空
+  };
+
+  explicit RpcBatch(std::vector<tcp::endpoint> peer_addrs);
+
+  // 只记录调用，commit 时统一发送
+  void CallMethod(const google::protobuf::MethodDescriptor *method,
+                  google::protobuf::RpcController *controller,
+                  const google::protobuf::Message *request,
+                  google::protobuf::Message *response,
+                  google::protobuf::Closure *done) override;
+
+  void add(const Call &call);
+
+  void add(const std::vector<Call> &calls);
+
+  size_t size() const { return calls_.size(); }
+
+  // 发送已记录的调用并等待全部完成，完成后可以继续记录下一批
+  asio::awaitable<void> commit(std::shared_ptr<RpcController> controller);
+
+private:
+  struct BatchState {
+    std::vector<Call> calls;
+    std::vector<bool> completed;
+    std::unordered_map<uint64_t, size_t> index;  // req_id -> calls 下标
+    bool finished{false};
+  };
+
+  static bool parseResponse(std::shared_ptr<BatchState> state,
+                            std::shared_ptr<TinyPBProtocol> rsp_protocol);
+
+  static void finish(std::shared_ptr<BatchState> state, RpcController *controller);
+
+private:
+  std::vector<tcp::endpoint> peer_addrs_;
+  std::vector<Call> calls_;
+};
+
+} // namespace rocket
+
+#endif
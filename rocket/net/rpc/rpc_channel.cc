@@ -4,17 +4,27 @@
 #include "rocket/logger/log.h"
 #include "rocket/common/msg_id_util.h"
 #include "rocket/common/run_time.h"
+#include "rocket/common/util.h"
 #include "rocket/net/coder/tinypb_protocol.h"
+#include "rocket/net/rpc/client_cache.h"
 #include "rocket/net/event_loop.h"
+#include "rocket/net/rpc/concurrency_limiter.h"
 #include "rocket/net/rpc/etcd_registry.h"
+#include "rocket/net/rpc/method_table.h"
+#include "rocket/net/rpc/outlier_detector.h"
+#include "rocket/net/rpc/rpc_closure.h"
 #include "rocket/net/rpc/rpc_controller.h"
+#include "rocket/net/rpc/single_flight.h"
 #include "rocket/net/tcp/tcp_client.h"
 #include <asio/co_spawn.hpp>
 #include <asio/detached.hpp>
 #include <asio/ip/address.hpp>
 #include <asio/ip/tcp.hpp>
+#include <asio/post.hpp>
 #include <asio/steady_timer.hpp>
 #include <asio/redirect_error.hpp>
+#include <algorithm>
+#include <chrono>
 #include <cstddef>
 #include <google/protobuf/descriptor.h>
 #include <google/protobuf/message.h>
@@ -42,6 +52,8 @@ void RpcChannel::callBack() {
     timeout_timer_.reset();
   }
 
+  reportCallResult();
+
   if (closure_) {
     closure_->Run();
   }
@@ -53,6 +65,90 @@ void RpcChannel::callBack() {
   }
 }
 
+/*
+ * 向异常检测上报本次调用结果，只统计已经发往具体节点的调用
+ */
+void RpcChannel::reportCallResult() {
+  if (peer_addr_.address().is_unspecified()) {
+    return;
+  }
+  RpcController *my_controller = dynamic_cast<RpcController *>(getController());
+
+  // 延迟只统计请求写出之后的部分，不包含排队等待并发名额和建连的时间
+  bool sent = send_time_ != std::chrono::steady_clock::time_point();
+  int64_t latency_us = 0;
+  if (sent) {
+    latency_us = std::chrono::duration_cast<std::chrono::microseconds>(
+                     std::chrono::steady_clock::now() - send_time_)
+                     .count();
+  }
+
+  OutlierDetector::CallResult result = OutlierDetector::CallResult::Success;
+  if (my_controller->GetErrorCode() == ERROR_RPC_CONCURRENCY_LIMIT ||
+      my_controller->GetErrorCode() == ERROR_RPC_CANCELED) {
+    result = OutlierDetector::CallResult::Abandoned;
+  } else if (my_controller->GetErrorCode() == ERROR_RPC_CALL_TIMEOUT) {
+    // 还在排队等待并发名额时超时，与节点本身无关
+    result = (!sent && !limit_acquired_) ? OutlierDetector::CallResult::Abandoned
+                                         : OutlierDetector::CallResult::Timeout;
+  } else if (my_controller->GetErrorCode() != 0) {
+    result = OutlierDetector::CallResult::Error;
+  }
+
+  OutlierDetector::GetInstance()->reportResult(peer_addr_, result, latency_us,
+                                               probe_);
+
+  if (limit_acquired_) {
+    limit_acquired_ = false;
+    ConcurrencyLimiter::Outcome outcome = ConcurrencyLimiter::Outcome::Ignore;
+    if (result == OutlierDetector::CallResult::Success) {
+      outcome = ConcurrencyLimiter::Outcome::Success;
+    } else if (result == OutlierDetector::CallResult::Timeout ||
+               my_controller->GetErrorCode() == ERROR_RPC_SERVER_OVERLOAD) {
+      outcome = ConcurrencyLimiter::Outcome::Dropped;
+    }
+    ConcurrencyLimiter::GetInstance()->release(peer_addr_, outcome, latency_us);
+  }
+}
+
+/*
+ * 超时后不再等待响应，并发送取消帧让服务端停止处理
+ * 写完成回调持有 channel，保证取消帧发出前连接不会被关闭
+ */
+void RpcChannel::sendCancel() {
+  RpcController *my_controller = dynamic_cast<RpcController *>(getController());
+  if (!client_ || !client_->isConnected()) {
+    return;
+  }
+  client_->cancelReadMessage(my_controller->GetReqId());
+
+  std::shared_ptr<TinyPBProtocol> cancel_protocol =
+      ObjectPool<TinyPBProtocol>::Get();
+  cancel_protocol->req_id_ = my_controller->GetReqId();
+  cancel_protocol->msg_type_ = TinyPBProtocol::MSG_CANCEL;
+
+  s_ptr channel = shared_from_this();
+  client_->writeMessage(cancel_protocol,
+                        [channel](AbstractProtocol::s_ptr msg) mutable {
+                          DEBUGLOG("%lu | send cancel frame success",
+                                   msg->req_id_);
+                        });
+}
+
+void RpcChannel::Cancel() {
+  RpcController *my_controller = dynamic_cast<RpcController *>(getController());
+  if (my_controller == NULL || my_controller->Finished()) {
+    return;
+  }
+  DEBUGLOG("%lu | rpc call canceled by caller", my_controller->GetReqId());
+  my_controller->SetError(ERROR_RPC_CANCELED, "rpc call canceled");
+
+  // 与超时相同：先完成回调，再置为取消并发送取消帧，还没有发出的请求不再发送
+  callBack();
+  my_controller->StartCancel();
+  sendCancel();
+}
+
 /*
         改造思路，启动协程去做，完成后调用done即可
 */
@@ -63,7 +159,7 @@ void RpcChannel::CallMethod(const google::protobuf::MethodDescriptor *method,
                             google::protobuf::Closure *done) {
 
   std::shared_ptr<rocket::TinyPBProtocol> req_protocol =
-      std::make_shared<rocket::TinyPBProtocol>();
+      rocket::ObjectPool<rocket::TinyPBProtocol>::Get();
 
   // 获取controller
   RpcController *my_controller = dynamic_cast<RpcController *>(controller);
@@ -75,59 +171,17 @@ void RpcChannel::CallMethod(const google::protobuf::MethodDescriptor *method,
     return;
   }
 
-  // index归0
-  if (addr_index_ >= peer_addrs_.size()) {
-    addr_index_ = 0;
-  }
-
-  tcp::endpoint peer_addr;
-  for (int i = 0; i < peer_addrs_.size(); i++) {
-    if (peer_addrs_[addr_index_].address().is_unspecified()) {
-      addr_index_ = (addr_index_ + 1) % peer_addrs_.size();
-      continue;
-    } else {
-      peer_addr = peer_addrs_[addr_index_];
-      break;
-    }
-  }
-
-  if (peer_addr.address().is_unspecified()) {
-    ERRORLOG("failed get peer addr");
-    my_controller->SetError(ERROR_RPC_PEER_ADDR, "peer addr nullptr");
-    callBack();
-    return;
-  }
-
-  client_ = std::make_shared<TcpClient>(peer_addr);
-
-  // 设置msg_id
-  if (my_controller->GetMsgId().empty()) {
-    // 先从 runtime 里面取, 取不到再生成一个
-    // 这样的目的是为了实现 msg_id 的透传，假设服务 A 调用了 B，那么同一个 msgid
-    // 可以在服务 A 和 B 之间串起来，方便日志追踪
-    std::string msg_id = RunTime::GetRunTime()->msgid_;
-    if (!msg_id.empty()) {
-      req_protocol->msg_id_ = msg_id;
-      my_controller->SetMsgId(msg_id);
-    } else {
-      req_protocol->msg_id_ = MsgIDUtil::GenMsgID();
-      my_controller->SetMsgId(req_protocol->msg_id_);
-    }
-
-  } else {
-    // 如果 controller 指定了 msgno, 直接使用
-    req_protocol->msg_id_ = my_controller->GetMsgId();
-  }
-
   // 设置method_name
   req_protocol->method_name_ = method->full_name();
-  DEBUGLOG("%s | call method name [%s]", req_protocol->msg_id_.c_str(),
+  req_protocol->method_id_ = MethodTable::MethodId(req_protocol->method_name_);
+  prepareRequest(req_protocol, my_controller);
+  DEBUGLOG("%lu | call method name [%s]", req_protocol->req_id_,
           req_protocol->method_name_.c_str());
 
   if (!is_init_) {
     std::string err_info = "RpcChannel not call init()";
     my_controller->SetError(ERROR_RPC_CHANNEL_INIT, err_info);
-    ERRORLOG("%s | %s, RpcChannel not init ", req_protocol->msg_id_.c_str(),
+    ERRORLOG("%lu | %s, RpcChannel not init ", req_protocol->req_id_,
              err_info.c_str());
     callBack();
     return;
@@ -137,29 +191,221 @@ void RpcChannel::CallMethod(const google::protobuf::MethodDescriptor *method,
   if (!request->SerializeToString(&(req_protocol->pb_data_))) {
     std::string err_info = "failde to serialize";
     my_controller->SetError(ERROR_FAILED_SERIALIZE, err_info);
-    ERRORLOG("%s | %s, origin requeset [%s] ", req_protocol->msg_id_.c_str(),
+    ERRORLOG("%lu | %s, origin requeset [%s] ", req_protocol->req_id_,
              err_info.c_str(), request->ShortDebugString().c_str());
     callBack();
     return;
   }
 
+  // 缓存和合并都以方法名加序列化后的请求作为 key
+  bool coalesce = SingleFlight::GetInstance()->enabled(req_protocol->method_name_);
+  cache_policy_ = ClientCache::GetInstance()->policy(req_protocol->method_name_);
+  if (cache_policy_ || coalesce) {
+    cache_key_ = req_protocol->method_name_;
+    cache_key_.push_back('\0');
+    cache_key_.append(req_protocol->pb_data_);
+  }
+
+  if (cache_policy_) {
+    std::string pb_data;
+    bool refresh = false;
+    ClientCache::Result result = ClientCache::GetInstance()->lookup(
+        *cache_policy_, cache_key_, pb_data, refresh);
+    if (result != ClientCache::Result::Miss &&
+        response->ParseFromString(pb_data)) {
+      DEBUGLOG("%lu | client cache hit, method name [%s], stale[%d]",
+               req_protocol->req_id_, req_protocol->method_name_.c_str(),
+               result == ClientCache::Result::Stale);
+      if (refresh) {
+        refreshCache(req_protocol, my_controller);
+      }
+      callBack();
+      return;
+    }
+  }
+
+  if (coalesce) {
+    callCoalesced(req_protocol, my_controller);
+    return;
+  }
+
+  sendRequest(req_protocol, my_controller);
+}
+
+void RpcChannel::refreshCache(std::shared_ptr<TinyPBProtocol> req_protocol,
+                              RpcController *my_controller) {
+  std::shared_ptr<RpcController> controller = ObjectPool<RpcController>::Get();
+  controller->SetTimeout(my_controller->GetTimeout());
+  controller->SetMsgId(my_controller->GetMsgId());
+  controller->SetPriority(my_controller->GetPriority());
+
+  std::string key = cache_key_;
+  std::shared_ptr<RpcClosure> done =
+      std::make_shared<RpcClosure>(nullptr, [controller, key]() {
+        if (controller->Failed()) {
+          ClientCache::GetInstance()->refreshFailed(key);
+        }
+      });
+
+  s_ptr refresh = std::make_shared<RpcChannel>(peer_addrs_);
+  refresh->Init(controller, nullptr, nullptr, done);
+  refresh->cache_policy_ = cache_policy_;
+  refresh->cache_key_ = key;
+
+  // 后台刷新与当前请求无关，不受上游 deadline 限制
+  int64_t deadline_ms = RunTime::GetRunTime()->deadline_ms_;
+  RunTime::GetRunTime()->deadline_ms_ = 0;
+  refresh->CallProtocol(req_protocol, [](std::shared_ptr<TinyPBProtocol>) {
+    return true;
+  });
+  RunTime::GetRunTime()->deadline_ms_ = deadline_ms;
+}
+
+/*
+ * 方法名加序列化后的请求作为 key，key 相同的调用共享同一次请求
+ * 实际的请求由内部的 channel 和 controller 发出，超时时间和 trace id 取第一个调用的，
+ * 某个调用超时或被取消只结束它自己，不影响共享的请求和其他等待者
+ */
+void RpcChannel::callCoalesced(std::shared_ptr<TinyPBProtocol> req_protocol,
+                               RpcController *my_controller) {
+  if (!applyDeadline(req_protocol, my_controller)) {
+    return;
+  }
+  EventLoop *event_loop = EventLoop::getThreadEventLoop();
+  startTimeoutTimer(event_loop, my_controller);
+
+  const std::string &key = cache_key_;
   s_ptr channel = shared_from_this();
+  bool leader = SingleFlight::GetInstance()->join(
+      req_protocol->method_name_, key,
+      [channel, event_loop](std::shared_ptr<const FlightResult> result) {
+        asio::post(*event_loop->getIOContext(),
+                   [channel, result]() { channel->finishCoalesced(result); });
+      });
+  if (!leader) {
+    DEBUGLOG("%lu | join in-flight call, method name [%s]",
+             req_protocol->req_id_, req_protocol->method_name_.c_str());
+    return;
+  }
 
-  // 获取事件循环
-  EventLoop *event_loop = client_->getEventLoop();
-  if (!event_loop) {
-    ERRORLOG("RpcChannel::CallMethod event_loop nullptr");
-    my_controller->SetError(ERROR_RPC_CHANNEL_INIT, "event_loop nullptr");
+  std::shared_ptr<RpcController> controller = ObjectPool<RpcController>::Get();
+  controller->SetTimeout(my_controller->GetTimeout());
+  controller->SetMsgId(my_controller->GetMsgId());
+  controller->SetPriority(my_controller->GetPriority());
+
+  // 共享请求的结果同时写入结果缓存
+  std::shared_ptr<FlightResult> result = std::make_shared<FlightResult>();
+  const ClientCachePolicy *cache_policy = cache_policy_;
+  std::shared_ptr<RpcClosure> done = std::make_shared<RpcClosure>(
+      nullptr, [controller, result, key, cache_policy]() {
+        result->error_code = controller->GetErrorCode();
+        result->error_info = controller->GetErrorInfo();
+        if (cache_policy && result->error_code == 0) {
+          ClientCache::GetInstance()->insert(*cache_policy, key, result->pb_data);
+        }
+        SingleFlight::GetInstance()->finish(key, result);
+      });
+
+  s_ptr flight = std::make_shared<RpcChannel>(peer_addrs_);
+  flight->Init(controller, nullptr, nullptr, done);
+  flight->CallProtocol(req_protocol, [result](std::shared_ptr<TinyPBProtocol> rsp) {
+    result->pb_data.swap(rsp->pb_data_);
+    return true;
+  });
+}
+
+void RpcChannel::finishCoalesced(std::shared_ptr<const FlightResult> result) {
+  RpcController *my_controller = dynamic_cast<RpcController *>(getController());
+  // 已经超时或被取消
+  if (my_controller->Finished()) {
+    return;
+  }
+  if (result->error_code != 0) {
+    my_controller->SetError(result->error_code, result->error_info);
+  } else if (!getResponse()->ParseFromString(result->pb_data)) {
+    ERRORLOG("%lu | serialize error", my_controller->GetReqId());
+    my_controller->SetError(ERROR_FAILED_SERIALIZE, "serialize error");
+  }
+  callBack();
+}
+
+void RpcChannel::CallProtocol(std::shared_ptr<TinyPBProtocol> req_protocol,
+                              ResponseParser parser) {
+  RpcController *my_controller = dynamic_cast<RpcController *>(getController());
+  if (my_controller == NULL) {
+    ERRORLOG("failed call protocol, RpcController convert error");
+    return;
+  }
+  if (!is_init_) {
+    my_controller->SetError(ERROR_RPC_CHANNEL_INIT, "RpcChannel not call init()");
+    ERRORLOG("%lu | RpcChannel not init", my_controller->GetReqId());
     callBack();
     return;
   }
+  response_parser_ = parser;
+  prepareRequest(req_protocol, my_controller);
+  DEBUGLOG("%lu | call protocol, method name [%s]", req_protocol->req_id_,
+           req_protocol->method_name_.c_str());
+  sendRequest(req_protocol, my_controller);
+}
 
+bool RpcChannel::parseResponse(std::shared_ptr<TinyPBProtocol> rsp_protocol) {
+  if (response_parser_) {
+    return response_parser_(rsp_protocol);
+  }
+  return getResponse()->ParseFromString(rsp_protocol->pb_data_);
+}
+
+void RpcChannel::prepareRequest(std::shared_ptr<TinyPBProtocol> req_protocol,
+                                RpcController *controller) {
+  // 请求号只用于在连接上匹配响应，每次调用重新生成
+  req_protocol->req_id_ = MsgIDUtil::GenReqId();
+  controller->SetReqId(req_protocol->req_id_);
+
+  // trace id 可选，controller 没有指定时从 runtime 里面取
+  // 这样的目的是为了实现 trace id 的透传，假设服务 A 调用了 B，那么同一个 trace id
+  // 可以在服务 A 和 B 之间串起来，方便日志追踪
+  if (controller->GetMsgId().empty()) {
+    controller->SetMsgId(RunTime::GetRunTime()->msgid_);
+  }
+  req_protocol->msg_id_ = controller->GetMsgId();
+
+  req_protocol->priority_ = controller->GetPriority();
+  if (Config::GetGlobalConfig()) {
+    req_protocol->client_id_ = Config::GetGlobalConfig()->client_id_;
+  }
+}
+
+bool RpcChannel::applyDeadline(std::shared_ptr<TinyPBProtocol> req_protocol,
+                               RpcController *my_controller) {
+  // 继承上游请求的 deadline，下游调用的超时时间不超过上游剩余的时间
+  int64_t deadline_ms = RunTime::GetRunTime()->deadline_ms_;
+  if (deadline_ms > 0) {
+    int64_t remain = deadline_ms - getNowMs();
+    if (remain <= 0) {
+      ERRORLOG("%lu | deadline exceeded before call method[%s]",
+               req_protocol->req_id_,
+               req_protocol->method_name_.c_str());
+      my_controller->SetError(ERROR_RPC_DEADLINE_EXCEEDED, "deadline exceeded");
+      callBack();
+      return false;
+    }
+    if (remain < my_controller->GetTimeout()) {
+      my_controller->SetTimeout(remain);
+    }
+  }
+  return true;
+}
+
+void RpcChannel::startTimeoutTimer(EventLoop *event_loop,
+                                   RpcController *my_controller) {
   // 创建超时定时器并保存引用
   timeout_timer_ = std::make_shared<asio::steady_timer>(
       *event_loop->getIOContext(),
       std::chrono::milliseconds(my_controller->GetTimeout()));
 
   // 使用协程实现超时控制
+  s_ptr channel = shared_from_this();
   auto timeout_timer = timeout_timer_;  // 捕获shared_ptr副本
   event_loop->addCoroutine([my_controller, channel, timeout_timer]() mutable -> asio::awaitable<void> {
     asio::error_code ec;
@@ -167,39 +413,118 @@ void RpcChannel::CallMethod(const google::protobuf::MethodDescriptor *method,
 
     // 如果定时器被取消（收到响应），直接返回
     if (ec == asio::error::operation_aborted) {
-      INFOLOG("%s | timeout timer cancelled, rpc already completed",
-              my_controller->GetMsgId().c_str());
+      INFOLOG("%lu | timeout timer cancelled, rpc already completed",
+              my_controller->GetReqId());
       channel.reset();
       co_return;
     }
 
-    INFOLOG("%s | call rpc timeout arrive",
-            my_controller->GetMsgId().c_str());
+    INFOLOG("%lu | call rpc timeout arrive",
+            my_controller->GetReqId());
 
     if (my_controller->Finished()) {
       channel.reset();
       co_return;
     }
 
-    my_controller->StartCancel();
     my_controller->SetError(
         ERROR_RPC_CALL_TIMEOUT,
         "rpc call timeout " + std::to_string(my_controller->GetTimeout()));
 
+    // 先完成回调再取消，StartCancel 会把 controller 置为 finished
     channel->callBack();
+    my_controller->StartCancel();
+    channel->sendCancel();
     channel.reset();
   });
+}
+
+void RpcChannel::sendRequest(std::shared_ptr<TinyPBProtocol> req_protocol,
+                             RpcController *my_controller) {
+  if (!applyDeadline(req_protocol, my_controller)) {
+    return;
+  }
+
+  // 轮询挑选节点，跳过被异常检测驱逐的节点
+  tcp::endpoint peer_addr;
+  if (!OutlierDetector::GetInstance()->selectEndpoint(peer_addrs_, peer_addr,
+                                                      &probe_)) {
+    ERRORLOG("%lu | failed get peer addr", req_protocol->req_id_);
+    my_controller->SetError(ERROR_RPC_PEER_ADDR, "peer addr nullptr");
+    callBack();
+    return;
+  }
+  peer_addr_ = peer_addr;
+  start_time_ = std::chrono::steady_clock::now();
+
+  // 节点并发限制，超过上限时直接失败，或在协程中排队等待名额
+  bool wait_limit = false;
+  if (ConcurrencyLimiter::GetInstance()->tryAcquire(peer_addr)) {
+    limit_acquired_ = true;
+  } else if (ConcurrencyLimiter::GetInstance()->queueEnabled()) {
+    wait_limit = true;
+  } else {
+    ERRORLOG("%lu | concurrency limit exceeded, peer addr[%s:%u]",
+             req_protocol->req_id_,
+             peer_addr.address().to_string().c_str(), peer_addr.port());
+    my_controller->SetError(ERROR_RPC_CONCURRENCY_LIMIT,
+                            "concurrency limit exceeded");
+    callBack();
+    return;
+  }
+
+  client_ = std::make_shared<TcpClient>(peer_addr);
+
+  s_ptr channel = shared_from_this();
+
+  // 获取事件循环
+  EventLoop *event_loop = client_->getEventLoop();
+  if (!event_loop) {
+    ERRORLOG("RpcChannel::CallMethod event_loop nullptr");
+    my_controller->SetError(ERROR_RPC_CHANNEL_INIT, "event_loop nullptr");
+    callBack();
+    return;
+  }
+
+  startTimeoutTimer(event_loop, my_controller);
+
+  event_loop->addCoroutine([req_protocol, my_controller, channel,
+                            wait_limit]() mutable -> asio::awaitable<void> {
+    if (wait_limit) {
+      bool acquired = co_await ConcurrencyLimiter::GetInstance()->waitAcquire(
+          channel->peer_addr_);
+      if (my_controller->Finished()) {
+        // 排队期间已经超时，归还拿到的名额
+        if (acquired) {
+          ConcurrencyLimiter::GetInstance()->release(
+              channel->peer_addr_, ConcurrencyLimiter::Outcome::Ignore, 0);
+        }
+        co_return;
+      }
+      if (!acquired) {
+        ERRORLOG("%lu | wait concurrency limit timeout",
+                 req_protocol->req_id_);
+        my_controller->SetError(ERROR_RPC_CONCURRENCY_LIMIT,
+                                "wait concurrency limit timeout");
+        channel->callBack();
+        co_return;
+      }
+      channel->limit_acquired_ = true;
+    }
 
-  event_loop->addCoroutine([req_protocol, my_controller,
-                            channel]() mutable -> asio::awaitable<void> {
     co_await channel->client_->connect();
 
+    // 建连期间已经超时，请求不再发送
+    if (my_controller->Finished()) {
+      co_return;
+    }
+
     if (channel->getTcpClient()->getConnectErrorCode() != 0) {
       my_controller->SetError(channel->getTcpClient()->getConnectErrorCode(),
                               channel->getTcpClient()->getConnectErrorInfo());
       ERRORLOG(
-          "%s | connect error, error coode[%d], error info[%s], peer addr[%s]",
-          req_protocol->msg_id_.c_str(), my_controller->GetErrorCode(),
+          "%lu | connect error, error coode[%d], error info[%s], peer addr[%s]",
+          req_protocol->req_id_, my_controller->GetErrorCode(),
           my_controller->GetErrorInfo().c_str(),
           channel->getTcpClient()->getPeerAddr().address().to_string().c_str());
 
@@ -207,18 +532,26 @@ void RpcChannel::CallMethod(const google::protobuf::MethodDescriptor *method,
       co_return;
     }
 
-    DEBUGLOG("%s | connect success, peer addr[%s], local addr[%s]",
-            req_protocol->msg_id_.c_str(),
+    DEBUGLOG("%lu | connect success, peer addr[%s], local addr[%s]",
+            req_protocol->req_id_,
             channel->getTcpClient()->getPeerAddr().address().to_string().c_str(),
 
             channel->getTcpClient()->getLocalAddr().address().to_string().c_str());
 
+    // 把扣除排队和建连耗时后的剩余时间带给服务端
+    int64_t elapsed_ms = std::chrono::duration_cast<std::chrono::milliseconds>(
+                             std::chrono::steady_clock::now() - channel->start_time_)
+                             .count();
+    req_protocol->timeout_ms_ =
+        std::max<int64_t>(1, my_controller->GetTimeout() - elapsed_ms);
+
     DEBUGLOG("client make write message");
+    channel->send_time_ = std::chrono::steady_clock::now();
     channel->getTcpClient()->writeMessage(
         req_protocol, [req_protocol,channel](AbstractProtocol::s_ptr) mutable {
-          DEBUGLOG("%s | send rpc request success. call method name[%s], peer "
+          DEBUGLOG("%lu | send rpc request success. call method name[%s], peer "
                   "addr[%s], local addr[%s]",
-                  req_protocol->msg_id_.c_str(),
+                  req_protocol->req_id_,
                   req_protocol->method_name_.c_str(),
                   channel->getTcpClient()->getPeerAddr().address().to_string().c_str(),
                   channel->getTcpClient()->getLocalAddr().address().to_string().c_str());
@@ -226,29 +559,29 @@ void RpcChannel::CallMethod(const google::protobuf::MethodDescriptor *method,
 
     DEBUGLOG("client make read message");
     channel->getTcpClient()->readMessage(
-        req_protocol->msg_id_,
+        req_protocol->req_id_,
         [ my_controller, channel](AbstractProtocol::s_ptr msg) mutable {
           std::shared_ptr<rocket::TinyPBProtocol> rsp_protocol =
               std::dynamic_pointer_cast<rocket::TinyPBProtocol>(msg);
 
-          DEBUGLOG("%s | success get rpc response, call method name[%s], peer "
+          DEBUGLOG("%lu | success get rpc response, call method name[%s], peer "
                   "addr[%s], local addr[%s]",
-                  rsp_protocol->msg_id_.c_str(),
+                  rsp_protocol->req_id_,
                   rsp_protocol->method_name_.c_str(),
                   channel->getTcpClient()->getPeerAddr().address().to_string().c_str(),
                   channel->getTcpClient()->getLocalAddr().address().to_string().c_str());
 
-          if (!(channel->getResponse()->ParseFromString(rsp_protocol->pb_data_))) {
-            ERRORLOG("%s | serialize error", rsp_protocol->msg_id_.c_str());
+          if (!channel->parseResponse(rsp_protocol)) {
+            ERRORLOG("%lu | serialize error", rsp_protocol->req_id_);
             my_controller->SetError(ERROR_FAILED_SERIALIZE, "serialize error");
             channel->callBack();
             return;
           }
 
           if (rsp_protocol->err_code_ != 0) {
-            ERRORLOG("%s | call rpc methood[%s] failed, error code[%d], "
+            ERRORLOG("%lu | call rpc methood[%s] failed, error code[%d], "
                      "error info[%s]",
-                     rsp_protocol->msg_id_.c_str(),
+                     rsp_protocol->req_id_,
                      rsp_protocol->method_name_.c_str(),
                      rsp_protocol->err_code_, rsp_protocol->err_info_.c_str());
 
@@ -258,12 +591,18 @@ void RpcChannel::CallMethod(const google::protobuf::MethodDescriptor *method,
             return;
           }
 
-          DEBUGLOG("%s | call rpc success, call method name[%s], peer addr[%s], "
+          DEBUGLOG("%lu | call rpc success, call method name[%s], peer addr[%s], "
                   "local addr[%s]",
-                  rsp_protocol->msg_id_.c_str(),
+                  rsp_protocol->req_id_,
                   rsp_protocol->method_name_.c_str(),
                   channel->getTcpClient()->getPeerAddr().address().to_string().c_str(),
-                  channel->getTcpClient()->getLocalAddr().address().to_string().c_str())
+                  channel->getTcpClient()->getLocalAddr().address().to_string().c_str());
+
+          if (channel->cache_policy_) {
+            ClientCache::GetInstance()->insert(*channel->cache_policy_,
+                                               channel->cache_key_,
+                                               rsp_protocol->pb_data_);
+          }
 
           channel->callBack();
         });
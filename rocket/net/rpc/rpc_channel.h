@@ -1,19 +1,27 @@
 #ifndef ROCKET_NET_RPC_RPC_CHANNEL_H
 #define ROCKET_NET_RPC_RPC_CHANNEL_H
 
+#include "rocket/net/coder/tinypb_protocol.h"
 #include "rocket/net/tcp/tcp_client.h"
 #include <google/protobuf/service.h>
+#include <chrono>
+#include <functional>
 #include <memory>
 #include <asio/steady_timer.hpp>
 
 namespace rocket {
 
+class RpcController;
+class EventLoop;
+struct FlightResult;
+struct ClientCachePolicy;
+
 #define NEWMESSAGE(type, var_name)                                             \
   std::shared_ptr<type> var_name = std::make_shared<type>();
 
 #define NEWRPCCONTROLLER(var_name)                                             \
   std::shared_ptr<rocket::RpcController> var_name =                            \
-      std::make_shared<rocket::RpcController>();
+      rocket::ObjectPool<rocket::RpcController>::Get();
 
 #define NEWRPCCHANNEL(addr, var_name)                                          \
   std::shared_ptr<rocket::RpcChannel> var_name =                               \
@@ -38,6 +46,8 @@ public:
   typedef std::shared_ptr<google::protobuf::RpcController> controller_s_ptr;
   typedef std::shared_ptr<google::protobuf::Message> message_s_ptr;
   typedef std::shared_ptr<google::protobuf::Closure> closure_s_ptr;
+  // 解析响应，返回 false 表示解析失败
+  typedef std::function<bool(std::shared_ptr<TinyPBProtocol>)> ResponseParser;
 
 public:
   // 获取 addr
@@ -57,6 +67,14 @@ public:
                   google::protobuf::Message *response,
                   google::protobuf::Closure *done) override;
 
+  // 发送已经填好 method_name 和 pb_data 的请求，响应由 parser 解析，用于批量调用等不经过 Stub 的场景
+  // 超时、重试节点、取消等逻辑与 CallMethod 相同，结果记录在 Init 传入的 controller 中
+  void CallProtocol(std::shared_ptr<TinyPBProtocol> req_protocol,
+                    ResponseParser parser);
+
+  // 取消还没有结束的调用：以 ERROR_RPC_CANCELED 结束并通知服务端停止处理，需要在发起调用的线程中执行
+  void Cancel();
+
   google::protobuf::RpcController *getController();
 
   google::protobuf::Message *getRequest();
@@ -70,16 +88,51 @@ public:
 private:
   void callBack();
 
+  // 设置 msg_id、优先级、调用方标识
+  void prepareRequest(std::shared_ptr<TinyPBProtocol> req_protocol,
+                      RpcController *controller);
+
+  // 选择节点、建连、发送请求并等待响应
+  void sendRequest(std::shared_ptr<TinyPBProtocol> req_protocol,
+                   RpcController *controller);
+
+  // 继承上游请求的 deadline，已经超过 deadline 时以失败结束调用并返回 false
+  bool applyDeadline(std::shared_ptr<TinyPBProtocol> req_protocol,
+                     RpcController *controller);
+
+  // 在 event_loop 上启动超时定时器，超时后结束调用并通知服务端取消
+  void startTimeoutTimer(EventLoop *event_loop, RpcController *controller);
+
+  // 合并到方法和请求内容相同的在途调用上，没有在途调用时由本次调用发起
+  void callCoalesced(std::shared_ptr<TinyPBProtocol> req_protocol,
+                     RpcController *controller);
+
+  // 在发起调用的线程中处理合并调用的结果
+  void finishCoalesced(std::shared_ptr<const FlightResult> result);
+
+  // 在后台重新发起请求刷新过期的缓存结果，不继承上游请求的 deadline
+  void refreshCache(std::shared_ptr<TinyPBProtocol> req_protocol,
+                    RpcController *controller);
+
+  bool parseResponse(std::shared_ptr<TinyPBProtocol> rsp_protocol);
+
+  void reportCallResult();
+
+  // 通知服务端取消本次请求
+  void sendCancel();
+
 private:
   controller_s_ptr controller_{nullptr};
   message_s_ptr request_{nullptr};
   message_s_ptr response_{nullptr};
   closure_s_ptr closure_{nullptr};
+  ResponseParser response_parser_{nullptr};
 
   bool is_init_{false};
 
   std::vector<tcp::endpoint> peer_addrs_;
-	int addr_index_{0};
+  tcp::endpoint peer_addr_;   // 本次调用选中的节点
+  bool probe_{false};         // 本次调用是否为异常检测放行的探测请求
   tcp::endpoint local_addr_;
   TcpClient::s_ptr client_;
   int client_id_;
@@ -87,6 +140,19 @@ private:
   // 用于存储超时定时器，以便在收到响应时取消
   std::shared_ptr<asio::steady_timer> timeout_timer_;
 
+  // 调用发起时间，用于计算扣除排队和建连耗时后的剩余超时时间
+  std::chrono::steady_clock::time_point start_time_;
+
+  // 请求写出的时间，拿到并发名额并建连之后记录，用于统计节点 RTT，没有发出时为默认值
+  std::chrono::steady_clock::time_point send_time_;
+
+  // 是否占用了节点并发限制的名额，调用结束时归还
+  bool limit_acquired_{false};
+
+  // 开启了结果缓存的方法，调用成功时把响应写入缓存
+  const ClientCachePolicy *cache_policy_{nullptr};
+  std::string cache_key_;
+
 };
 
 } // namespace rocket
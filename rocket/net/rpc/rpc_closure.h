@@ -7,6 +7,7 @@
 #include "rocket/common/run_time.h"
 #include "rocket/logger/log.h"
 #include "rocket/common/exception.h"
+#include "rocket/common/object_pool.h"
 #include "rocket/net/rpc/rpc_interface.h"
 
 namespace rocket {
@@ -15,14 +16,34 @@ class RpcClosure : public google::protobuf::Closure {
  public:
   typedef std::shared_ptr<RpcInterface> it_s_ptr;
 
-  RpcClosure(it_s_ptr interface, std::function<void()> cb) : rpc_interface_(interface), cb_(cb) {
+  RpcClosure(it_s_ptr interface, std::function<void()> cb) : rpc_interface_(interface), cb_(std::move(cb)) {
     DEBUGLOG("RpcClosure");
   }
 
+  // 对象池中的闭包先默认构造，取出后通过 init 设置回调
+  RpcClosure() {}
+
   ~RpcClosure() {
     DEBUGLOG("~RpcClosure");
   }
 
+  void init(it_s_ptr interface, std::function<void()> cb) {
+    rpc_interface_ = interface;
+    cb_ = std::move(cb);
+  }
+
+  // 对象池回收时释放回调持有的资源
+  void reset() {
+    rpc_interface_.reset();
+    cb_ = nullptr;
+    release_ = nullptr;
+  }
+
+  // 回调执行完后调用，用于释放闭包所在的请求 Arena，调用之后不能再访问闭包
+  void setRelease(std::function<void()> release) {
+    release_ = std::move(release);
+  }
+
   void Run() override {
 
     // 更新 runtime 的 RpcInterFace, 这里在执行 cb 的时候，都会以 RpcInterface 找到对应的接口，实现打印 app 日志等
@@ -57,13 +78,24 @@ class RpcClosure : public google::protobuf::Closure {
         rpc_interface_.reset();
       }
     }
-    
+
+    if (release_) {
+      std::function<void()> release = std::move(release_);
+      release();
+    }
   }
 
  private:
   it_s_ptr rpc_interface_ {nullptr};
   std::function<void()> cb_ {nullptr};
+  std::function<void()> release_ {nullptr};
+
+};
 
+template <>
+struct PoolTraits<RpcClosure> {
+  static const char* name() { return "rpc_closure"; }
+  static void reset(RpcClosure* obj) { obj->reset(); }
 };
 
 }
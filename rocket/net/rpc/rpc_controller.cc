@@ -1,16 +1,36 @@
 
 #include "rocket/net/rpc/rpc_controller.h"
+#include "rocket/common/util.h"
+#include "rocket/net/rpc/co_call.h"
+#include <chrono>
 
 namespace rocket {
 
+RpcController::~RpcController() {
+  runPendingCallbacks();
+  DEBUGLOG("~RpcController");
+}
+
 void RpcController::Reset() {
+  runPendingCallbacks();
+
   error_code_ = 0;
   error_info_ = "";
+  req_id_ = 0;
   msg_id_ = "";
   is_failed_ = false;
   is_cancled_ = false;
   is_finished_ = false;
   timeout_ = 1000;   // ms
+  {
+    std::scoped_lock<std::mutex> lock(cancel_mutex_);
+    cancel_notified_ = false;
+  }
+  deadline_ms_ = 0;
+  priority_ = TinyPBProtocol::PRIORITY_NORMAL;
+  local_addr_ = tcp::endpoint();
+  peer_addr_ = tcp::endpoint();
+  waiter_ = nullptr;
 }
 
 bool RpcController::Failed() const {
@@ -37,7 +57,55 @@ bool RpcController::IsCanceled() const {
 }
 
 void RpcController::NotifyOnCancel(google::protobuf::Closure* callback) {
-
+  if (callback == NULL) {
+    return;
+  }
+  {
+    std::scoped_lock<std::mutex> lock(cancel_mutex_);
+    if (!cancel_notified_) {
+      cancel_callbacks_.push_back(callback);
+      return;
+    }
+  }
+  callback->Run();
+}
+
+asio::awaitable<void> RpcController::WaitForCancel() {
+  co_await asyncFinish(this, []() {});
+}
+
+void RpcController::notifyCancel() {
+  std::vector<google::protobuf::Closure*> callbacks;
+  {
+    std::scoped_lock<std::mutex> lock(cancel_mutex_);
+    if (cancel_notified_) {
+      return;
+    }
+    cancel_notified_ = true;
+    callbacks.swap(cancel_callbacks_);
+  }
+
+  for (auto callback : callbacks) {
+    callback->Run();
+  }
+}
+
+void RpcController::runPendingCallbacks() {
+  // 还没有执行的回调按取消执行，释放其中持有的资源(调度器的在途名额、等待结果的协程)
+  std::vector<google::protobuf::Closure*> callbacks;
+  {
+    std::scoped_lock<std::mutex> lock(cancel_mutex_);
+    callbacks.swap(cancel_callbacks_);
+    cancel_notified_ = true;
+  }
+  if (!callbacks.empty()) {
+    is_cancled_ = true;
+    is_failed_ = true;
+    is_finished_ = true;
+    for (auto callback : callbacks) {
+      callback->Run();
+    }
+  }
 }
 
 
@@ -55,11 +123,19 @@ std::string RpcController::GetErrorInfo() {
   return error_info_;
 }
 
+void RpcController::SetReqId(uint64_t req_id) {
+  req_id_ = req_id;
+}
+
+uint64_t RpcController::GetReqId() {
+  return req_id_;
+}
+
 void RpcController::SetMsgId(const std::string& msg_id) {
   msg_id_ = msg_id;
 }
 
-std::string RpcController::GetMsgId() {
+const std::string& RpcController::GetMsgId() {
   return msg_id_;
 }
 
@@ -87,12 +163,41 @@ int RpcController::GetTimeout() {
   return timeout_;
 }
 
+void RpcController::SetDeadline(int64_t deadline_ms) {
+  deadline_ms_ = deadline_ms;
+}
+
+int64_t RpcController::GetDeadline() {
+  return deadline_ms_;
+}
+
+int64_t RpcController::GetRemainingTime() {
+  if (deadline_ms_ <= 0) {
+    return -1;
+  }
+  int64_t remain = deadline_ms_ - getNowMs();
+  return remain > 0 ? remain : 0;
+}
+
+void RpcController::SetPriority(uint8_t priority) {
+  if (priority < TinyPBProtocol::PRIORITY_COUNT) {
+    priority_ = priority;
+  }
+}
+
+uint8_t RpcController::GetPriority() {
+  return priority_;
+}
+
 bool RpcController::Finished() {
   return is_finished_;
 }
 
 void RpcController::SetFinished(bool value) {
   is_finished_ = value;
+  if (value) {
+    notifyCancel();
+  }
 }
 
 void RpcController::SetWaiter(asio::steady_timer *waiter) {
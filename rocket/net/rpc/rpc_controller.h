@@ -1,13 +1,21 @@
 #ifndef ROCKER_NET_RPC_RPC_CONTROLLER_H
 #define ROCKER_NET_RPC_RPC_CONTROLLER_H
 
+#include <asio/awaitable.hpp>
 #include <asio/ip/tcp.hpp>
 #include <asio/steady_timer.hpp>
 #include <google/protobuf/service.h>
 #include <google/protobuf/stubs/callback.h>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
 #include <string>
+#include <vector>
 
+#include "rocket/common/object_pool.h"
 #include "rocket/logger/log.h"
+#include "rocket/net/coder/tinypb_protocol.h"
 
 namespace rocket {
 
@@ -17,7 +25,8 @@ class RpcController : public google::protobuf::RpcController {
 
  public:
   RpcController() { DEBUGLOG("RpcController"); }
-  ~RpcController() { DEBUGLOG("~RpcController"); } 
+  // 对象池已满时直接析构，不经过 Reset，同样要执行还没有执行的回调
+  ~RpcController();
 
   void Reset() override;
 
@@ -31,17 +40,27 @@ class RpcController : public google::protobuf::RpcController {
 
   bool IsCanceled() const override;
 
+  // callback 在请求被取消或完成时调用且只调用一次，已经取消或完成时立即调用
   void NotifyOnCancel(google::protobuf::Closure* callback) override;
 
+  // 协程中等待请求被取消或完成
+  asio::awaitable<void> WaitForCancel();
+
   void SetError(int32_t error_code, const std::string error_info);
 
   int32_t GetErrorCode();
 
   std::string GetErrorInfo();
 
+  // 请求号，客户端发起调用时生成，服务端为收到的请求号
+  void SetReqId(uint64_t req_id);
+
+  uint64_t GetReqId();
+
+  // 可选的 trace id，只用于日志关联；客户端没有指定时继承当前正在处理的请求的 trace id
   void SetMsgId(const std::string& msg_id);
 
-  std::string GetMsgId();
+  const std::string& GetMsgId();
 
   void SetLocalAddr(tcp::endpoint addr);
 
@@ -55,29 +74,64 @@ class RpcController : public google::protobuf::RpcController {
  
   int GetTimeout();
 
+  // 设置请求的绝对 deadline(getNowMs)，0 表示没有 deadline
+  void SetDeadline(int64_t deadline_ms);
+
+  int64_t GetDeadline();
+
+  // 剩余可用时间(ms)，已经过期返回 0，没有 deadline 返回 -1
+  int64_t GetRemainingTime();
+
+  // 请求优先级，取值见 TinyPBProtocol::Priority
+  void SetPriority(uint8_t priority);
+
+  uint8_t GetPriority();
+
   bool Finished();
 
   void SetFinished(bool value);
 
+  // 调用结束时取消该定时器，兼容手写的协程 stub；新代码使用 co_call.h 中的 asyncCallMethod
 	void SetWaiter(asio::steady_timer *chan);
 
 	asio::steady_timer *GetWaiter();
  
+ private:
+  void notifyCancel();
+
+  // 把还没有执行的回调按取消执行
+  void runPendingCallbacks();
+
  private:
   int32_t error_code_ {0};
   std::string error_info_;
+  uint64_t req_id_ {0};
   std::string msg_id_;
 
   bool is_failed_ {false};
-  bool is_cancled_ {false};
-  bool is_finished_ {false};
+  std::atomic<bool> is_cancled_ {false};
+  std::atomic<bool> is_finished_ {false};   // 批量请求取消时在其他线程读取
+
+  // 取消通知，服务端的取消帧和业务处理可能不在同一个线程
+  std::mutex cancel_mutex_;
+  bool cancel_notified_ {false};
+  std::vector<google::protobuf::Closure*> cancel_callbacks_;
 
   tcp::endpoint local_addr_;
   tcp::endpoint peer_addr_;
 
   int timeout_ {1000};   // ms
+  int64_t deadline_ms_ {0};
+  uint8_t priority_ {TinyPBProtocol::PRIORITY_NORMAL};
+
+	asio::steady_timer *waiter_ {nullptr};
+};
 
-	asio::steady_timer *waiter_; 
+// 对象池回收时通过 Reset 恢复初始状态，还没有执行的回调按取消执行
+template <>
+struct PoolTraits<RpcController> {
+  static const char* name() { return "rpc_controller"; }
+  static void reset(RpcController* obj) { obj->Reset(); }
 };
 
 }
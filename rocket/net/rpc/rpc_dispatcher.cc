@@ -1,23 +1,37 @@
+#include <asio/co_spawn.hpp>
+#include <asio/detached.hpp>
+#include <asio/post.hpp>
 #include <google/protobuf/service.h>
 #include <google/protobuf/descriptor.h>
 #include <google/protobuf/message.h>
+#include <google/protobuf/stubs/callback.h>
+#include <mutex>
 
 #include "rocket/net/rpc/rpc_dispatcher.h"
+#include "rocket/net/coder/tinypb_coder.h"
 #include "rocket/net/coder/tinypb_protocol.h"
 #include "rocket/logger/log.h"
 #include "rocket/common/error_code.h"
 #include "rocket/net/rpc/rpc_controller.h"
 #include "rocket/net/rpc/rpc_closure.h"
+#include "rocket/net/rpc/request_arena.h"
+#include "rocket/net/rpc/context_executor.h"
+#include "rocket/net/rpc/response_cache.h"
+#include "rocket/net/rpc/rpc_stream.h"
+#include "rocket/net/event_loop.h"
+#include "rocket/common/config.h"
+#include "rocket/common/exception.h"
 #include "rocket/net/tcp/tcp_connection.h"
 #include "rocket/common/run_time.h"
+#include "rocket/common/metrics.h"
+#include "rocket/common/util.h"
 
 namespace rocket {
 
-#define DELETE_RESOURCE(XX) \
-  if (XX != NULL) { \
-    delete XX;      \
-    XX = NULL;      \
-  }                 \
+static Counter* expiredCounter() {
+  static Counter* counter = MetricsRegistry::GetInstance()->getCounter("rocket_server_expired_requests_total");
+  return counter;
+}
 
 static RpcDispatcher* g_rpc_dispatcher = NULL;
 
@@ -30,81 +44,399 @@ RpcDispatcher* RpcDispatcher::GetRpcDispatcher() {
 }
 
 
-void RpcDispatcher::dispatch(AbstractProtocol::s_ptr request, AbstractProtocol::s_ptr response, TcpConnection* connection) {
+// 批量请求的汇总状态，子调用可能在不同线程完成
+struct BatchContext {
+  std::shared_ptr<TinyPBProtocol> request;
+  std::weak_ptr<TcpConnection> connection;
+  std::shared_ptr<RpcController> controller;
+  std::vector<std::shared_ptr<RpcController>> children;
+
+  std::mutex mutex;
+  std::vector<std::shared_ptr<TinyPBProtocol>> responses;
+  size_t remaining {0};
+};
+
+static void finishBatch(std::shared_ptr<BatchContext> batch) {
+  TcpConnection::s_ptr connection = batch->connection.lock();
+  if (connection) {
+    connection->removeInflightRequest(batch->request->req_id_);
+  }
+  if (batch->controller->IsCanceled() || !connection) {
+    DEBUGLOG("%lu | batch request canceled, skip reply", batch->request->req_id_);
+    batch->controller->SetFinished(true);
+    return;
+  }
+  batch->controller->SetFinished(true);
+
+  std::shared_ptr<TinyPBProtocol> rsp_protocol = ObjectPool<TinyPBProtocol>::Get();
+  rsp_protocol->req_id_ = batch->request->req_id_;
+  rsp_protocol->legacy_id_ = batch->request->legacy_id_;
+  rsp_protocol->method_name_ = batch->request->method_name_;
+  rsp_protocol->msg_type_ = TinyPBProtocol::MSG_BATCH;
+
+  // 被取消的子调用没有结果，客户端按缺失处理
+  std::vector<std::shared_ptr<TinyPBProtocol>> results;
+  results.reserve(batch->responses.size());
+  for (auto& response : batch->responses) {
+    if (response) {
+      response->method_name_.clear();
+      results.push_back(response);
+    }
+  }
+  TinyPBCoder::encodeBatch(results, rsp_protocol->pb_data_);
+  DEBUGLOG("%lu | batch dispatch success, %lu calls", rsp_protocol->req_id_, results.size());
+
+  std::vector<AbstractProtocol::s_ptr> replay_messages;
+  replay_messages.emplace_back(rsp_protocol);
+  connection->reply(replay_messages);
+}
+
+static void onBatchReply(std::shared_ptr<BatchContext> batch, size_t index, std::shared_ptr<TinyPBProtocol> response) {
+  {
+    std::scoped_lock<std::mutex> lock(batch->mutex);
+    batch->responses[index] = response;
+    if (--batch->remaining > 0) {
+      return;
+    }
+  }
+  // 最后一个子调用可能在其他线程完成，合并后的响应回到连接所在的 IO 线程编码和发送
+  TcpConnection::s_ptr connection = batch->connection.lock();
+  if (!connection) {
+    finishBatch(batch);
+    return;
+  }
+  asio::post(*connection->getIOContext(), [batch]() {
+    finishBatch(batch);
+  });
+}
+
+// 批量请求被取消(或完成)时取消所有未完成的子调用
+static void cancelBatch(std::shared_ptr<BatchContext> batch) {
+  if (!batch->controller->IsCanceled()) {
+    return;
+  }
+  for (auto& child : batch->children) {
+    if (!child->Finished()) {
+      child->StartCancel();
+    }
+  }
+}
+
+
+std::shared_ptr<RpcController> RpcDispatcher::dispatch(AbstractProtocol::s_ptr request, AbstractProtocol::s_ptr response, std::shared_ptr<TcpConnection> connection) {
   
   std::shared_ptr<TinyPBProtocol> req_protocol = std::dynamic_pointer_cast<TinyPBProtocol>(request);
   std::shared_ptr<TinyPBProtocol> rsp_protocol = std::dynamic_pointer_cast<TinyPBProtocol>(response);
 
-  std::string method_full_name = req_protocol->method_name_;
-  std::string service_name;
-  std::string method_name;
+  // 取消帧，通知对应的在途请求，不需要回包
+  if (req_protocol->msg_type_ == TinyPBProtocol::MSG_CANCEL) {
+    connection->cancelInflightRequest(req_protocol->req_id_);
+    return nullptr;
+  }
 
-  rsp_protocol->msg_id_ = req_protocol->msg_id_;
-  rsp_protocol->method_name_ = req_protocol->method_name_;
+  // 请求在到达前或排队期间已经超过客户端的 deadline，客户端不会再等结果，直接丢弃
+  if (req_protocol->deadline_ms_ > 0 && getNowMs() >= req_protocol->deadline_ms_) {
+    expiredCounter()->inc();
+    INFOLOG("%lu | request[%s] expired before dispatch, drop it", req_protocol->req_id_, req_protocol->method_name_.c_str());
+    return nullptr;
+  }
 
-  if (!parseServiceFullName(method_full_name, service_name, method_name)) {
-    setTinyPBError(rsp_protocol, ERROR_PARSE_SERVICE_NAME, "parse service name error");
-    return;
+  if (req_protocol->msg_type_ == TinyPBProtocol::MSG_BATCH) {
+    return dispatchBatch(req_protocol, connection);
   }
 
-  auto it = service_map_.find(service_name);
-  if (it == service_map_.end()) {
-    ERRORLOG("%s | sericve neame[%s] not found", req_protocol->msg_id_.c_str(), service_name.c_str());
-    setTinyPBError(rsp_protocol, ERROR_SERVICE_NOT_FOUND, "service not found");
-    return;
+  if (req_protocol->msg_type_ == TinyPBProtocol::MSG_STREAM_OPEN) {
+    return dispatchStream(req_protocol, connection);
   }
 
-  service_s_ptr service = (*it).second;
+  std::shared_ptr<RpcController> rpc_controller = ObjectPool<RpcController>::Get();
+  connection->addInflightRequest(req_protocol->req_id_, rpc_controller);
 
-  const google::protobuf::MethodDescriptor* method = service->GetDescriptor()->FindMethodByName(method_name);
-  if (method == NULL) {
-    ERRORLOG("%s | method neame[%s] not found in service[%s]", req_protocol->msg_id_.c_str(), method_name.c_str(), service_name.c_str());
-    setTinyPBError(rsp_protocol, ERROR_SERVICE_NOT_FOUND, "method not found");
-    return;
+  // 回调可能在连接断开后才执行，只持有连接的弱引用
+  std::weak_ptr<TcpConnection> weak_connection = connection;
+  uint64_t req_id = req_protocol->req_id_;
+  ReplyCallback reply = [weak_connection, req_id](std::shared_ptr<TinyPBProtocol> rsp) {
+    TcpConnection::s_ptr connection = weak_connection.lock();
+    if (!connection) {
+      return;
+    }
+    connection->removeInflightRequest(req_id);
+    if (rsp) {
+      std::vector<AbstractProtocol::s_ptr> replay_messages;
+      replay_messages.emplace_back(rsp);
+      connection->reply(replay_messages);
+    }
+  };
+
+  if (!callMethod(req_protocol, rsp_protocol, rpc_controller, connection, reply)) {
+    return nullptr;
+  }
+  return rpc_controller;
+}
+
+std::shared_ptr<RpcController> RpcDispatcher::dispatchBatch(std::shared_ptr<TinyPBProtocol> req_protocol, std::shared_ptr<TcpConnection> connection) {
+  std::vector<std::shared_ptr<TinyPBProtocol>> calls;
+  if (!TinyPBCoder::decodeBatch(req_protocol->pb_data_, calls)) {
+    replyError(req_protocol, connection, ERROR_FAILED_DESERIALIZE, "batch deserilize error");
+    return nullptr;
+  }
+  DEBUGLOG("%lu | get batch request, %lu calls", req_protocol->req_id_, calls.size());
+
+  std::shared_ptr<BatchContext> batch = std::make_shared<BatchContext>();
+  batch->request = req_protocol;
+  batch->connection = connection;
+  batch->controller = ObjectPool<RpcController>::Get();
+  batch->controller->SetReqId(req_protocol->req_id_);
+  batch->controller->SetMsgId(req_protocol->msg_id_);
+  batch->controller->SetDeadline(req_protocol->deadline_ms_);
+  batch->controller->SetPriority(req_protocol->priority_);
+  batch->responses.resize(calls.size());
+  batch->remaining = calls.size();
+  connection->addInflightRequest(req_protocol->req_id_, batch->controller);
+
+  if (calls.empty()) {
+    finishBatch(batch);
+    return batch->controller;
+  }
+
+  for (size_t i = 0; i < calls.size(); ++i) {
+    batch->children.push_back(ObjectPool<RpcController>::Get());
+  }
+  batch->controller->NotifyOnCancel(google::protobuf::NewCallback(&cancelBatch, batch));
+
+  // 子调用继承批量请求的 deadline 和优先级，结果全部返回后合并为一个响应
+  for (size_t i = 0; i < calls.size(); ++i) {
+    std::shared_ptr<TinyPBProtocol> call = calls[i];
+    call->timeout_ms_ = req_protocol->timeout_ms_;
+    call->deadline_ms_ = req_protocol->deadline_ms_;
+    call->priority_ = req_protocol->priority_;
+    call->client_id_ = req_protocol->client_id_;
+    call->msg_id_ = req_protocol->msg_id_;
+
+    ReplyCallback reply = [batch, i](std::shared_ptr<TinyPBProtocol> rsp) {
+      onBatchReply(batch, i, rsp);
+    };
+    callMethod(call, ObjectPool<TinyPBProtocol>::Get(), batch->children[i], connection, reply);
+  }
+  return batch->controller;
+}
+
+static asio::awaitable<void> runStreamHandler(RpcDispatcher::StreamHandler handler, std::shared_ptr<RpcStream> stream) {
+  try {
+    co_await handler(stream);
+  } catch (RocketException& e) {
+    ERRORLOG("%lu | RocketException exception[%s] in stream handler", stream->getReqId(), e.what());
+    stream->finish(e.errorCode(), e.errorInfo());
+  } catch (std::exception& e) {
+    ERRORLOG("%lu | std::exception[%s] in stream handler", stream->getReqId(), e.what());
+    stream->finish(-1, "unkonwn std::exception");
+  }
+  stream->finish();
+}
+
+std::shared_ptr<RpcController> RpcDispatcher::dispatchStream(std::shared_ptr<TinyPBProtocol> req_protocol, std::shared_ptr<TcpConnection> connection) {
+  auto it = stream_handlers_.find(req_protocol->method_name_);
+  if (it == stream_handlers_.end()) {
+    ERRORLOG("%lu | stream method[%s] not found", req_protocol->req_id_, req_protocol->method_name_.c_str());
+    std::shared_ptr<TinyPBProtocol> rsp_protocol = makeErrorResponse(req_protocol, ERROR_METHOD_NOT_FOUND, "stream method not found");
+    rsp_protocol->msg_type_ = TinyPBProtocol::MSG_STREAM_END;
+    std::vector<AbstractProtocol::s_ptr> replay_messages;
+    replay_messages.emplace_back(rsp_protocol);
+    connection->reply(replay_messages);
+    return nullptr;
+  }
+
+  std::shared_ptr<RpcController> rpc_controller = ObjectPool<RpcController>::Get();
+  rpc_controller->SetLocalAddr(connection->getLocalAddr());
+  rpc_controller->SetPeerAddr(connection->getPeerAddr());
+  rpc_controller->SetReqId(req_protocol->req_id_);
+  rpc_controller->SetMsgId(req_protocol->msg_id_);
+  rpc_controller->SetDeadline(req_protocol->deadline_ms_);
+  rpc_controller->SetPriority(req_protocol->priority_);
+
+  int window = Config::GetGlobalConfig() ? Config::GetGlobalConfig()->stream_config_.window : 32;
+  std::shared_ptr<RpcStream> stream = std::make_shared<RpcStream>(RpcStream::Side::Server, connection, req_protocol->req_id_, window);
+  stream->method_name_ = req_protocol->method_name_;
+  connection->registerStream(req_protocol->req_id_, stream);
+  connection->addInflightRequest(req_protocol->req_id_, rpc_controller);
+  stream->accept(rpc_controller, req_protocol->credit_);
+  DEBUGLOG("%lu | open stream[%s]", req_protocol->req_id_, req_protocol->method_name_.c_str());
+
+  asio::co_spawn(*EventLoop::getThreadEventLoop()->getIOContext(), runStreamHandler(it->second, stream), asio::detached);
+  return rpc_controller;
+}
+
+// 执行协程方法，结束后通过闭包回包；RunTime 由 ContextExecutor 在每次恢复执行时设置
+static asio::awaitable<void> runCoroutineMethod(const MethodEntry* entry, std::shared_ptr<RpcController> controller,
+    const google::protobuf::Message* request, google::protobuf::Message* response, RpcClosure* done) {
+  try {
+    co_await entry->co_method(controller.get(), request, response);
+  } catch (RocketException& e) {
+    ERRORLOG("%lu | RocketException exception[%s] in coroutine method[%s]", controller->GetReqId(), e.what(), entry->full_name.c_str());
+    controller->SetError(e.errorCode(), e.errorInfo());
+  } catch (std::exception& e) {
+    ERRORLOG("%lu | std::exception[%s] in coroutine method[%s]", controller->GetReqId(), e.what(), entry->full_name.c_str());
+    controller->SetError(-1, "unkonwn std::exception");
+  }
+  done->Run();
+}
+
+bool RpcDispatcher::callMethod(std::shared_ptr<TinyPBProtocol> req_protocol, std::shared_ptr<TinyPBProtocol> rsp_protocol,
+    std::shared_ptr<RpcController> rpc_controller, std::shared_ptr<TcpConnection> connection, ReplyCallback reply) {
+
+  rsp_protocol->req_id_ = req_protocol->req_id_;
+  rsp_protocol->legacy_id_ = req_protocol->legacy_id_;
+  rsp_protocol->method_name_ = req_protocol->method_name_;
+
+  // 调度器已经解析过方法时直接按下标取出，否则按 id 或方法名查找
+  const MethodEntry* entry = resolveMethod(req_protocol);
+  if (entry == NULL) {
+    replyMethodNotFound(req_protocol, reply);
+    return false;
   }
 
-  google::protobuf::Message* req_msg = service->GetRequestPrototype(method).New();
+  // 幂等方法按请求内容命中缓存时直接回复序列化好的响应，不再解析请求和执行业务
+  if (entry->cache_policy) {
+    if (ResponseCache::GetInstance()->lookup(req_protocol->method_index_, req_protocol->pb_data_, rsp_protocol->pb_data_)) {
+      entry->cache_policy->hits->inc();
+      DEBUGLOG("%lu | response cache hit, method[%s]", req_protocol->req_id_, entry->full_name.c_str());
+      rsp_protocol->err_code_ = 0;
+      rsp_protocol->err_info_ = "";
+      rpc_controller->SetReqId(req_protocol->req_id_);
+      rpc_controller->SetFinished(true);
+      reply(rsp_protocol);
+      return true;
+    }
+    entry->cache_policy->misses->inc();
+  }
+
+  service_s_ptr service = entry->service;
+  const google::protobuf::MethodDescriptor* method = entry->method;
+  const std::string& method_name = entry->method_name;
+  const std::string& service_name = entry->service_name;
+
+  // 请求/响应消息和闭包都分配在请求的 Arena 上，闭包执行完(回包之后)一次性释放
+  RequestArena* request_arena = new RequestArena();
+  google::protobuf::Arena* arena = request_arena->get();
+
+  google::protobuf::Message* req_msg = service->GetRequestPrototype(method).New(arena);
 
   // 反序列化，将 pb_data 反序列化为 req_msg
   if (!req_msg->ParseFromString(req_protocol->pb_data_)) {
-    ERRORLOG("%s | deserilize error", req_protocol->msg_id_.c_str(), method_name.c_str(), service_name.c_str());
-    setTinyPBError(rsp_protocol, ERROR_FAILED_DESERIALIZE, "deserilize error");
-    DELETE_RESOURCE(req_msg);
-    return;
+    ERRORLOG("%lu | deserilize error, method[%s] service[%s]", req_protocol->req_id_, method_name.c_str(), service_name.c_str());
+    reply(makeErrorResponse(req_protocol, ERROR_FAILED_DESERIALIZE, "deserilize error"));
+    delete request_arena;
+    return false;
   }
 
-  DEBUGLOG("%s | get rpc request[%s]", req_protocol->msg_id_.c_str(), req_msg->ShortDebugString().c_str());
+  DEBUGLOG("%lu | get rpc request[%s]", req_protocol->req_id_, req_msg->ShortDebugString().c_str());
 
-  google::protobuf::Message* rsp_msg = service->GetResponsePrototype(method).New();
+  google::protobuf::Message* rsp_msg = service->GetResponsePrototype(method).New(arena);
 
-  RpcController* rpc_controller = new RpcController();
   rpc_controller->SetLocalAddr(connection->getLocalAddr());
   rpc_controller->SetPeerAddr(connection->getPeerAddr());
+  rpc_controller->SetReqId(req_protocol->req_id_);
   rpc_controller->SetMsgId(req_protocol->msg_id_);
+  rpc_controller->SetDeadline(req_protocol->deadline_ms_);
+  rpc_controller->SetPriority(req_protocol->priority_);
+  if (req_protocol->timeout_ms_ > 0) {
+    rpc_controller->SetTimeout(req_protocol->timeout_ms_);
+  }
 
-  RunTime::GetRunTime()->msgid_ = req_protocol->msg_id_;
-  RunTime::GetRunTime()->method_name_ = method_name;
+  std::shared_ptr<RequestContext> context = std::make_shared<RequestContext>();
+  context->req_id = req_protocol->req_id_;
+  context->msgid = req_protocol->msg_id_;
+  context->method_name = method_name;
+  context->deadline_ms = req_protocol->deadline_ms_;
+
+  // 闭包可能在连接断开后才执行，只持有连接的弱引用
+  std::weak_ptr<TcpConnection> weak_connection = connection;
+
+  RpcClosure* closure = google::protobuf::Arena::Create<RpcClosure>(arena, nullptr, [req_msg, rsp_msg, req_protocol, rsp_protocol, weak_connection, rpc_controller, reply, entry, this]() mutable {
+    // 请求已被客户端取消或连接已断开，不再序列化和回包
+    if (rpc_controller->IsCanceled() || weak_connection.expired()) {
+      DEBUGLOG("%lu | request canceled, skip reply", req_protocol->req_id_);
+      rpc_controller->SetFinished(true);
+      reply(nullptr);
+      return;
+    }
+    rpc_controller->SetFinished(true);
 
-  RpcClosure* closure = new RpcClosure(nullptr, [req_msg, rsp_msg, req_protocol, rsp_protocol, connection, rpc_controller, this]() mutable {
-    if (!rsp_msg->SerializeToString(&(rsp_protocol->pb_data_))) {
-      ERRORLOG("%s | serilize error, origin message [%s]", req_protocol->msg_id_.c_str(), rsp_msg->ShortDebugString().c_str());
+    if (rpc_controller->GetErrorCode() != 0) {
+      ERRORLOG("%lu | method failed, error_code[%d], error_info[%s]", req_protocol->req_id_, rpc_controller->GetErrorCode(), rpc_controller->GetErrorInfo().c_str());
+      setTinyPBError(rsp_protocol, rpc_controller->GetErrorCode(), rpc_controller->GetErrorInfo());
+    } else if (!rsp_msg->SerializeToString(&(rsp_protocol->pb_data_))) {
+      ERRORLOG("%lu | serilize error, origin message [%s]", req_protocol->req_id_, rsp_msg->ShortDebugString().c_str());
       setTinyPBError(rsp_protocol, ERROR_FAILED_SERIALIZE, "serilize error");
     } else {
       rsp_protocol->err_code_ = 0;
       rsp_protocol->err_info_ = "";
-      DEBUGLOG("%s | dispatch success, requesut[%s], response[%s]", req_protocol->msg_id_.c_str(), req_msg->ShortDebugString().c_str(), rsp_msg->ShortDebugString().c_str());
+      if (entry->cache_policy) {
+        ResponseCache::GetInstance()->insert(req_protocol->method_index_, req_protocol->pb_data_, rsp_protocol->pb_data_, entry->cache_policy->ttl_ms);
+      }
+      DEBUGLOG("%lu | dispatch success, requesut[%s], response[%s]", req_protocol->req_id_, req_msg->ShortDebugString().c_str(), rsp_msg->ShortDebugString().c_str());
     }
 
-    std::vector<AbstractProtocol::s_ptr> replay_messages;
-    replay_messages.emplace_back(rsp_protocol);
-    connection->reply(replay_messages);
-
+    reply(rsp_protocol);
+  });
+  closure->setRelease([request_arena]() {
+    delete request_arena;
   });
 
-  service->CallMethod(method, rpc_controller, req_msg, rsp_msg, closure);
-  
+  // 协程挂起期间同一线程会处理其他请求，每次恢复执行时重新设置 RunTime；
+  // 普通方法只在 CallMethod 期间设置，之后异步发起的下游调用需要通过 controller 获取剩余时间
+  if (entry->co_method) {
+    ContextExecutor<asio::io_context::executor_type> executor(connection->getIOContext()->get_executor(), context);
+    asio::co_spawn(executor, runCoroutineMethod(entry, rpc_controller, req_msg, rsp_msg, closure), asio::detached);
+  } else {
+    ScopedRunTime scope(*context);
+    service->CallMethod(method, rpc_controller.get(), req_msg, rsp_msg, closure);
+  }
+  return true;
+}
+
+
+bool RpcDispatcher::hasService(const std::string& service_name) const {
+  return service_map_.find(service_name) != service_map_.end();
+}
+
+const MethodEntry* RpcDispatcher::resolveMethod(std::shared_ptr<TinyPBProtocol> request) const {
+  int index = request->method_index_;
+  if (index < 0 && request->method_id_ != 0) {
+    index = method_table_.findById(request->method_id_);
+  }
+  if (index < 0 && !request->method_name_.empty()) {
+    index = method_table_.findByName(request->method_name_);
+  }
+  if (index < 0) {
+    return NULL;
+  }
+  request->method_index_ = index;
+  return &method_table_.at(index);
 }
 
+void RpcDispatcher::replyMethodNotFound(std::shared_ptr<TinyPBProtocol> req_protocol, ReplyCallback& reply) {
+  // 方法表中没有时按名字解析，区分具体的错误
+  if (req_protocol->method_name_.empty()) {
+    ERRORLOG("%lu | method id[%u] not found", req_protocol->req_id_, req_protocol->method_id_);
+    reply(makeErrorResponse(req_protocol, ERROR_METHOD_NOT_FOUND, "method id not found"));
+    return;
+  }
+
+  std::string service_name;
+  std::string method_name;
+  if (!parseServiceFullName(req_protocol->method_name_, service_name, method_name)) {
+    reply(makeErrorResponse(req_protocol, ERROR_PARSE_SERVICE_NAME, "parse service name error"));
+    return;
+  }
+  if (service_map_.find(service_name) == service_map_.end()) {
+    ERRORLOG("%lu | sericve neame[%s] not found", req_protocol->req_id_, service_name.c_str());
+    reply(makeErrorResponse(req_protocol, ERROR_SERVICE_NOT_FOUND, "service not found"));
+    return;
+  }
+  ERRORLOG("%lu | method neame[%s] not found in service[%s]", req_protocol->req_id_, method_name.c_str(), service_name.c_str());
+  reply(makeErrorResponse(req_protocol, ERROR_SERVICE_NOT_FOUND, "method not found"));
+}
 
 bool RpcDispatcher::parseServiceFullName(const std::string& full_name, std::string& service_name, std::string& method_name) {
   if (full_name.empty()) {
@@ -129,7 +461,61 @@ bool RpcDispatcher::parseServiceFullName(const std::string& full_name, std::stri
 void RpcDispatcher::registerService(service_s_ptr service) {
   std::string service_name = service->GetDescriptor()->full_name();
   service_map_[service_name] = service;
+  method_table_.addService(service);
+
+  if (Config::GetGlobalConfig()) {
+    const google::protobuf::ServiceDescriptor* descriptor = service->GetDescriptor();
+    const std::map<std::string, int>& method_ttl_ms = Config::GetGlobalConfig()->response_cache_config_.method_ttl_ms;
+    for (int i = 0; i < descriptor->method_count(); ++i) {
+      auto it = method_ttl_ms.find(descriptor->method(i)->full_name());
+      if (it != method_ttl_ms.end()) {
+        enableResponseCache(it->first, it->second);
+      }
+    }
+  }
+
+}
+
+void RpcDispatcher::registerStreamMethod(const std::string& method_full_name, StreamHandler handler) {
+  stream_handlers_[method_full_name] = handler;
+}
+
+bool RpcDispatcher::registerCoroutineMethod(const std::string& method_full_name, CoroutineMethod handler) {
+  if (!method_table_.setCoroutineMethod(method_full_name, std::move(handler))) {
+    ERRORLOG("register coroutine method[%s] failed, method not found in registered services", method_full_name.c_str());
+    return false;
+  }
+  return true;
+}
 
+bool RpcDispatcher::enableResponseCache(const std::string& method_full_name, int ttl_ms) {
+  if (!ResponseCache::GetInstance()->enabled() || ttl_ms <= 0) {
+    ERRORLOG("enable response cache for method[%s] failed, cache disabled or ttl[%d] invalid", method_full_name.c_str(), ttl_ms);
+    return false;
+  }
+  if (!method_table_.setCachePolicy(method_full_name, ResponseCache::NewPolicy(method_full_name, ttl_ms))) {
+    ERRORLOG("enable response cache for method[%s] failed, method not found in registered services", method_full_name.c_str());
+    return false;
+  }
+  INFOLOG("response cache enabled for method[%s], ttl %d ms", method_full_name.c_str(), ttl_ms);
+  return true;
+}
+
+bool RpcDispatcher::checkMethodType(const std::string& method_full_name, const google::protobuf::Descriptor* request_type,
+    const google::protobuf::Descriptor* response_type) const {
+  int index = method_table_.findByName(method_full_name);
+  if (index < 0) {
+    ERRORLOG("register coroutine method[%s] failed, method not found in registered services", method_full_name.c_str());
+    return false;
+  }
+  const google::protobuf::MethodDescriptor* method = method_table_.at(index).method;
+  if (method->input_type() != request_type || method->output_type() != response_type) {
+    ERRORLOG("register coroutine method[%s] failed, expect [%s -> %s], got [%s -> %s]", method_full_name.c_str(),
+        method->input_type()->full_name().c_str(), method->output_type()->full_name().c_str(),
+        request_type->full_name().c_str(), response_type->full_name().c_str());
+    return false;
+  }
+  return true;
 }
 
 void RpcDispatcher::setTinyPBError(std::shared_ptr<TinyPBProtocol> msg, int32_t err_code, const std::string err_info) {
@@ -138,4 +524,19 @@ void RpcDispatcher::setTinyPBError(std::shared_ptr<TinyPBProtocol> msg, int32_t
   msg->err_info_len_ = err_info.length();
 }
 
+std::shared_ptr<TinyPBProtocol> RpcDispatcher::makeErrorResponse(std::shared_ptr<TinyPBProtocol> request, int32_t err_code, const std::string& err_info) {
+  std::shared_ptr<TinyPBProtocol> rsp_protocol = ObjectPool<TinyPBProtocol>::Get();
+  rsp_protocol->req_id_ = request->req_id_;
+  rsp_protocol->legacy_id_ = request->legacy_id_;
+  rsp_protocol->method_name_ = request->method_name_;
+  setTinyPBError(rsp_protocol, err_code, err_info);
+  return rsp_protocol;
+}
+
+void RpcDispatcher::replyError(std::shared_ptr<TinyPBProtocol> request, std::shared_ptr<TcpConnection> connection, int32_t err_code, const std::string& err_info) {
+  std::vector<AbstractProtocol::s_ptr> replay_messages;
+  replay_messages.emplace_back(makeErrorResponse(request, err_code, err_info));
+  connection->reply(replay_messages);
+}
+
 }
\ No newline at end of file
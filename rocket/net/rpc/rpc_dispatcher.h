@@ -1,16 +1,21 @@
 #ifndef ROCKET_NET_RPC_RPC_DISPATCHER_H
 #define ROCKET_NET_RPC_RPC_DISPATCHER_H
 
+#include <functional>
 #include <map>
 #include <memory>
+#include <asio/awaitable.hpp>
 #include <google/protobuf/service.h>
 
 #include "rocket/net/coder/abstract_protocol.h"
 #include "rocket/net/coder/tinypb_protocol.h"
+#include "rocket/net/rpc/method_table.h"
 
 namespace rocket {
 
 class TcpConnection;
+class RpcController;
+class RpcStream;
 
 class RpcDispatcher {
 
@@ -22,17 +27,84 @@ class RpcDispatcher {
 
   typedef std::shared_ptr<google::protobuf::Service> service_s_ptr;
 
-  void dispatch(AbstractProtocol::s_ptr request, AbstractProtocol::s_ptr response, TcpConnection* connection);
+  // 单个调用的结果(包括错误响应)，每个调用恰好回调一次，调用被取消时参数为 nullptr
+  typedef std::function<void(std::shared_ptr<TinyPBProtocol>)> ReplyCallback;
+
+  // 流式调用的处理函数，在连接所属的 IO 线程中以协程执行，返回时流以成功状态结束(如果还没有 finish)
+  typedef std::function<asio::awaitable<void>(std::shared_ptr<RpcStream>)> StreamHandler;
+
+  // 返回本次请求的 RpcController，请求没有交给业务处理(取消帧、过期、解析失败等)时返回 nullptr
+  // 批量请求返回汇总的 RpcController，所有子调用完成后才结束
+  std::shared_ptr<RpcController> dispatch(AbstractProtocol::s_ptr request, AbstractProtocol::s_ptr response, std::shared_ptr<TcpConnection> connection);
 
   void registerService(service_s_ptr service);
 
+  // 注册流式方法，method_full_name 形如 "Order.watchOrders"，需要在服务启动前注册
+  void registerStreamMethod(const std::string& method_full_name, StreamHandler handler);
+
+  /**
+   * 把已注册服务中的方法替换为协程实现，需要在 registerService 之后、服务启动前注册
+   * 协程在连接所属的 IO 线程中执行，co_await 下游调用时不阻塞 IO 线程，协程结束时自动序列化 response 并回包；
+   * 协程抛出异常或调用 controller->SetError 时回复错误响应
+   */
+  bool registerCoroutineMethod(const std::string& method_full_name, CoroutineMethod handler);
+
+  // 类型化的协程方法，例如 registerCoroutineMethod<makeOrderRequest, makeOrderResponse>("Order.makeOrder", handler)
+  template <typename Request, typename Response>
+  bool registerCoroutineMethod(const std::string& method_full_name,
+      std::function<asio::awaitable<void>(RpcController*, const Request*, Response*)> handler) {
+    if (!checkMethodType(method_full_name, Request::descriptor(), Response::descriptor())) {
+      return false;
+    }
+    return registerCoroutineMethod(method_full_name, CoroutineMethod(
+        [handler](RpcController* controller, const google::protobuf::Message* request, google::protobuf::Message* response) {
+          return handler(controller, static_cast<const Request*>(request), static_cast<Response*>(response));
+        }));
+  }
+
+  // 为已注册服务中的幂等方法开启响应缓存，需要在服务启动前调用；<response_cache> 中配置的方法在 registerService 时自动开启
+  bool enableResponseCache(const std::string& method_full_name, int ttl_ms);
+
+  // 服务在启动时注册，之后只读，可以在 IO 线程中直接查询
+  bool hasService(const std::string& service_name) const;
+
+  // 按方法 id(优先)或方法名找到请求对应的方法，结果记录在 request->method_index_ 中，找不到返回 nullptr
+  const MethodEntry* resolveMethod(std::shared_ptr<TinyPBProtocol> request) const;
+
+  // 是否可以在握手中声明 FEATURE_METHOD_ID
+  bool methodIdUsable() const { return method_table_.idUsable(); }
+
   void setTinyPBError(std::shared_ptr<TinyPBProtocol> msg, int32_t err_code, const std::string err_info);
 
+  // 不经过 protobuf 直接回复错误响应，用于过载拒绝等场景
+  void replyError(std::shared_ptr<TinyPBProtocol> request, std::shared_ptr<TcpConnection> connection, int32_t err_code, const std::string& err_info);
+
  private:
+  // 解析并执行单个调用，没有交给业务处理时返回 false
+  bool callMethod(std::shared_ptr<TinyPBProtocol> request, std::shared_ptr<TinyPBProtocol> response,
+      std::shared_ptr<RpcController> controller, std::shared_ptr<TcpConnection> connection, ReplyCallback reply);
+
+  // 把批量请求拆成多个调用分别执行，结果汇总到一个响应中
+  std::shared_ptr<RpcController> dispatchBatch(std::shared_ptr<TinyPBProtocol> request, std::shared_ptr<TcpConnection> connection);
+
+  // 打开流并启动处理协程，返回的 controller 在流结束时 finished
+  std::shared_ptr<RpcController> dispatchStream(std::shared_ptr<TinyPBProtocol> request, std::shared_ptr<TcpConnection> connection);
+
+  // 请求的方法不存在时回复错误
+  void replyMethodNotFound(std::shared_ptr<TinyPBProtocol> request, ReplyCallback& reply);
+
+  std::shared_ptr<TinyPBProtocol> makeErrorResponse(std::shared_ptr<TinyPBProtocol> request, int32_t err_code, const std::string& err_info);
+
+  // 方法存在且请求/响应类型与注册的服务一致
+  bool checkMethodType(const std::string& method_full_name, const google::protobuf::Descriptor* request_type,
+      const google::protobuf::Descriptor* response_type) const;
+
   bool parseServiceFullName(const std::string& full_name, std::string& service_name, std::string& method_name);
 
  private:
   std::map<std::string, service_s_ptr> service_map_;
+  MethodTable method_table_;
+  std::map<std::string, StreamHandler> stream_handlers_;
 };
 
 
@@ -0,0 +1,133 @@
+#include "rocket/net/rpc/rpc_fanout.h"
+#include "rocket/common/error_code.h"
+#include "rocket/common/util.h"
+#include "rocket/logger/log.h"
+#include "rocket/net/rpc/co_call.h"
+#include <algorithm>
+#include <google/protobuf/stubs/callback.h>
+
+namespace rocket {
+
+// 扇出的汇总状态，所有调用都在发起协程所在的线程中完成
+struct FanoutState {
+  std::vector<FanoutCall> *calls{nullptr};
+  std::shared_ptr<RpcController> group;   // 达到结束条件时 finished，唤醒等待的协程
+  std::vector<bool> started;
+  std::vector<bool> counted;              // 结果是否已经计入 result，被取消的调用在取消前置位
+  size_t need{0};
+  bool fail_fast{false};
+  FanoutResult result;
+};
+
+static void onFanoutCallDone(std::shared_ptr<FanoutState> state, size_t index) {
+  if (state->counted[index]) {
+    return;
+  }
+  state->counted[index] = true;
+  // 达到结束条件后、协程恢复之前完成的调用仍然计数，只有唤醒是一次性的
+  FanoutResult &result = state->result;
+  if ((*state->calls)[index].controller()->Failed()) {
+    result.failed++;
+  } else {
+    result.succeeded++;
+    result.success_order.push_back(index);
+  }
+
+  size_t total = state->calls->size();
+  bool done = result.succeeded + result.failed >= total;
+  if (state->fail_fast) {
+    done = done || result.succeeded >= state->need ||
+           result.failed > total - state->need;
+  }
+  if (done && !state->group->Finished()) {
+    state->group->SetFinished(true);
+  }
+}
+
+static asio::awaitable<FanoutResult> fanout(std::vector<FanoutCall> &calls, size_t need,
+                                            bool fail_fast, int timeout_ms) {
+  std::shared_ptr<FanoutState> state = std::make_shared<FanoutState>();
+  state->calls = &calls;
+  state->group = ObjectPool<RpcController>::Get();
+  state->started.resize(calls.size(), false);
+  state->counted.resize(calls.size(), false);
+  state->need = std::min(need, calls.size());
+  state->fail_fast = fail_fast;
+
+  if (calls.empty() || (fail_fast && state->need == 0)) {
+    state->result.satisfied = true;
+    co_return state->result;
+  }
+
+  // 共享的 deadline 折算为每个调用的超时
+  int64_t deadline_ms = timeout_ms > 0 ? getNowMs() + timeout_ms : 0;
+
+  co_await asyncFinish(state->group.get(), [state, deadline_ms]() {
+    std::vector<FanoutCall> &calls = *state->calls;
+    for (size_t i = 0; i < calls.size(); ++i) {
+      // 前面的调用同步失败或成功后已经满足结束条件，其余调用不再发起
+      if (state->group->Finished()) {
+        break;
+      }
+      RpcController *controller = calls[i].controller();
+      if (deadline_ms > 0) {
+        int64_t remain = std::max<int64_t>(1, deadline_ms - getNowMs());
+        if (remain < controller->GetTimeout()) {
+          controller->SetTimeout(remain);
+        }
+      }
+      controller->NotifyOnCancel(google::protobuf::NewCallback(&onFanoutCallDone, state, i));
+      state->started[i] = true;
+      calls[i].channel->CallMethod(calls[i].method, controller,
+                                   calls[i].channel->getRequest(),
+                                   calls[i].channel->getResponse(), nullptr);
+    }
+  });
+
+  // 取消还没有结束的调用，没有发起的调用直接置为取消
+  FanoutResult &result = state->result;
+  for (size_t i = 0; i < calls.size(); ++i) {
+    RpcController *controller = calls[i].controller();
+    if (state->counted[i]) {
+      continue;
+    }
+    state->counted[i] = true;
+    result.canceled++;
+    if (state->started[i]) {
+      calls[i].channel->Cancel();
+    } else {
+      controller->SetError(ERROR_RPC_CANCELED, "rpc call canceled before send");
+      controller->SetFinished(true);
+    }
+  }
+  result.satisfied = result.succeeded >= state->need;
+  DEBUGLOG("fanout done, %lu calls, %lu succeeded, %lu failed, %lu canceled",
+           calls.size(), result.succeeded, result.failed, result.canceled);
+  co_return result;
+}
+
+FanoutCall newFanoutCall(const std::string &addr,
+                         const google::protobuf::MethodDescriptor *method,
+                         std::shared_ptr<RpcController> controller,
+                         std::shared_ptr<google::protobuf::Message> request,
+                         std::shared_ptr<google::protobuf::Message> response) {
+  FanoutCall call;
+  call.channel = std::make_shared<RpcChannel>(RpcChannel::FindAddr(addr));
+  call.channel->Init(controller, request, response, nullptr);
+  call.method = method;
+  return call;
+}
+
+asio::awaitable<FanoutResult> whenAll(std::vector<FanoutCall> &calls, int timeout_ms) {
+  co_return co_await fanout(calls, calls.size(), false, timeout_ms);
+}
+
+asio::awaitable<FanoutResult> whenAny(std::vector<FanoutCall> &calls, int timeout_ms) {
+  co_return co_await fanout(calls, 1, true, timeout_ms);
+}
+
+asio::awaitable<FanoutResult> whenN(std::vector<FanoutCall> &calls, size_t n, int timeout_ms) {
+  co_return co_await fanout(calls, n, true, timeout_ms);
+}
+
+} // namespace rocket
@@ -0,0 +1,68 @@
+#ifndef ROCKET_NET_RPC_RPC_FANOUT_H
+#define ROCKET_NET_RPC_RPC_FANOUT_H
+
+#include <asio/awaitable.hpp>
+#include <google/protobuf/descriptor.h>
+#include <google/protobuf/message.h>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "rocket/net/rpc/rpc_channel.h"
+#include "rocket/net/rpc/rpc_controller.h"
+
+namespace rocket {
+
+// 扇出中的一个调用，channel 已经 Init 了 controller、request 和 response
+struct FanoutCall {
+  std::shared_ptr<RpcChannel> channel;
+  const google::protobuf::MethodDescriptor *method{nullptr};
+
+  RpcController *controller() const {
+    return static_cast<RpcController *>(channel->getController());
+  }
+
+  // 调用已经成功返回，response 可用
+  bool ok() const { return controller()->Finished() && !controller()->Failed(); }
+};
+
+// 按地址(或服务名)创建一个扇出调用
+FanoutCall newFanoutCall(const std::string &addr,
+                         const google::protobuf::MethodDescriptor *method,
+                         std::shared_ptr<RpcController> controller,
+                         std::shared_ptr<google::protobuf::Message> request,
+                         std::shared_ptr<google::protobuf::Message> response);
+
+// succeeded + failed + canceled 等于调用总数
+struct FanoutResult {
+  size_t succeeded{0};
+  size_t failed{0};      // 失败或超时
+  size_t canceled{0};    // 达到目标后被取消，或者还没有发起
+  std::vector<size_t> success_order;   // 成功调用的下标，按完成先后排列
+  bool satisfied{false};               // 是否拿到了要求数量的成功结果
+};
+
+/**
+ * @brief 扇出调用的组合器，在当前线程的 EventLoop 上并发发起所有调用
+ *
+ * timeout_ms > 0 时所有调用共享同一个 deadline，每个调用的超时不超过剩余时间；
+ * 正在处理的上游请求的 deadline 由 RpcChannel 自动继承。
+ * 每个调用的结果(包括部分成功时的失败原因)记录在各自的 controller 和 response 中。
+ *
+ *   std::vector<FanoutCall> calls;
+ *   calls.push_back(newFanoutCall("Order", method, controller, request, response));
+ *   FanoutResult result = co_await whenN(calls, 2, 100);
+ */
+
+// 等待所有调用结束，失败的调用不影响其他调用
+asio::awaitable<FanoutResult> whenAll(std::vector<FanoutCall> &calls, int timeout_ms = 0);
+
+// 第一个成功的调用返回后取消其余调用，全部失败时返回 satisfied = false
+asio::awaitable<FanoutResult> whenAny(std::vector<FanoutCall> &calls, int timeout_ms = 0);
+
+// n 个调用成功后取消其余调用；失败的调用过多、已经不可能凑够 n 个时提前返回
+asio::awaitable<FanoutResult> whenN(std::vector<FanoutCall> &calls, size_t n, int timeout_ms = 0);
+
+} // namespace rocket
+
+#endif
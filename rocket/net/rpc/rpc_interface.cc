@@ -24,39 +24,32 @@ void RpcInterface::reply() {
   // reply to client
   // you should call is when you wan to set response back
   // it means this rpc method done 
+  // done 只能执行一次，执行后请求 Arena 被释放，请求/响应消息不能再访问
   if (done_) {
-    done_->Run();
+    RpcClosure* done = done_;
+    done_ = NULL;
+    req_base_ = NULL;
+    rsp_base_ = NULL;
+    done->Run();
   }
 
 }
 
 std::shared_ptr<RpcClosure> RpcInterface::newRpcClosure(std::function<void()>& cb) {
-  return std::make_shared<RpcClosure>(shared_from_this(), cb);
+  std::shared_ptr<RpcClosure> closure = ObjectPool<RpcClosure>::Get();
+  closure->init(shared_from_this(), cb);
+  return closure;
 }
 
 
 void RpcInterface::destroy() {
-  if (req_base_) {
-    delete req_base_;
-    req_base_ = NULL;
-  }
-
-  if (rsp_base_) {
-    delete rsp_base_;
-    rsp_base_ = NULL;
-  }
-
-  if (done_) {
-    delete done_;
-    done_ = NULL;
-  }
-
-  if (controller_) {
-    delete controller_;
-    controller_ = NULL;
-  }
-
+  // 请求/响应消息和闭包分配在 RpcDispatcher 的请求 Arena 上，controller 由 shared_ptr 管理，
+  // 都不归 RpcInterface 所有，这里只解除引用
+  req_base_ = NULL;
+  rsp_base_ = NULL;
+  done_ = NULL;
+  controller_ = NULL;
 }
 
 
-}
\ No newline at end of file
+}
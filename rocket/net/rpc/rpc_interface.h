@@ -24,7 +24,7 @@ class RpcInterface : public std::enable_shared_from_this<RpcInterface> {
   // reply to client
   void reply();
 
-  // free resourse
+  // free resourse, the messages and closure are owned by RpcDispatcher
   void destroy();
 
   // alloc a closure object which handle by this interface
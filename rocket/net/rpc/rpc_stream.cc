@@ -0,0 +1,297 @@
+#include "rocket/net/rpc/rpc_stream.h"
+#include "rocket/common/config.h"
+#include "rocket/common/error_code.h"
+#include "rocket/common/msg_id_util.h"
+#include "rocket/common/run_time.h"
+#include "rocket/logger/log.h"
+#include "rocket/net/rpc/outlier_detector.h"
+#include "rocket/net/rpc/rpc_controller.h"
+#include <asio/redirect_error.hpp>
+#include <asio/use_awaitable.hpp>
+#include <algorithm>
+#include <chrono>
+#include <google/protobuf/stubs/callback.h>
+
+namespace rocket {
+
+RpcStream::RpcStream(Side side, TcpConnection::s_ptr connection,
+                     uint64_t req_id, int window)
+    : side_(side), connection_(connection), req_id_(req_id),
+      window_(std::max(window, 1)), read_timer_(*connection->getIOContext()),
+      write_timer_(*connection->getIOContext()) {
+  DEBUGLOG("%lu | RpcStream", req_id_);
+}
+
+RpcStream::~RpcStream() {
+  DEBUGLOG("%lu | ~RpcStream", req_id_);
+  // 客户端没有等到流结束就释放了流，通知服务端停止处理
+  if (side_ == Side::Client && !closed_) {
+    std::shared_ptr<TinyPBProtocol> frame = ObjectPool<TinyPBProtocol>::Get();
+    frame->req_id_ = req_id_;
+    frame->msg_type_ = TinyPBProtocol::MSG_CANCEL;
+    sendFrame(frame);
+  }
+  TcpConnection::s_ptr connection = connection_.lock();
+  if (connection) {
+    connection->removeStream(req_id_);
+  }
+}
+
+asio::awaitable<RpcStream::s_ptr>
+RpcStream::Open(const std::vector<tcp::endpoint> &peer_addrs,
+                const std::string &method_full_name,
+                std::shared_ptr<RpcController> controller) {
+  tcp::endpoint peer_addr;
+  if (!OutlierDetector::GetInstance()->selectEndpoint(peer_addrs, peer_addr)) {
+    ERRORLOG("failed get peer addr for stream[%s]", method_full_name.c_str());
+    controller->SetError(ERROR_RPC_PEER_ADDR, "peer addr nullptr");
+    co_return nullptr;
+  }
+
+  TcpClient::s_ptr client = std::make_shared<TcpClient>(peer_addr);
+  co_await client->connect();
+  if (client->getConnectErrorCode() != 0) {
+    ERRORLOG("open stream[%s] connect error, error code[%d], error info[%s]",
+             method_full_name.c_str(), client->getConnectErrorCode(),
+             client->getConnectErrorInfo().c_str());
+    controller->SetError(client->getConnectErrorCode(),
+                         client->getConnectErrorInfo());
+    co_return nullptr;
+  }
+
+  controller->SetReqId(MsgIDUtil::GenReqId());
+  if (controller->GetMsgId().empty()) {
+    controller->SetMsgId(RunTime::GetRunTime()->msgid_);
+  }
+  int window = 32;
+  if (Config::GetGlobalConfig()) {
+    window = Config::GetGlobalConfig()->stream_config_.window;
+  }
+
+  TcpConnection::s_ptr connection = client->getConnection();
+  s_ptr stream = std::make_shared<RpcStream>(Side::Client, connection,
+                                             controller->GetReqId(), window);
+  stream->client_ = client;
+  stream->method_name_ = method_full_name;
+  stream->controller_ = controller;
+  connection->registerStream(stream->req_id_, stream);
+
+  // 打开帧带上本端的接收窗口，服务端据此确定初始发送额度
+  std::shared_ptr<TinyPBProtocol> frame = ObjectPool<TinyPBProtocol>::Get();
+  frame->req_id_ = stream->req_id_;
+  frame->msg_id_ = controller->GetMsgId();
+  frame->method_name_ = method_full_name;
+  frame->msg_type_ = TinyPBProtocol::MSG_STREAM_OPEN;
+  frame->priority_ = controller->GetPriority();
+  frame->credit_ = stream->window_;
+  if (Config::GetGlobalConfig()) {
+    frame->client_id_ = Config::GetGlobalConfig()->client_id_;
+  }
+  stream->sendFrame(frame);
+
+  DEBUGLOG("%lu | open stream[%s] to peer addr[%s:%u]", stream->req_id_,
+           method_full_name.c_str(), peer_addr.address().to_string().c_str(),
+           peer_addr.port());
+  co_return stream;
+}
+
+static void onStreamCanceled(std::weak_ptr<RpcStream> weak_stream) {
+  RpcStream::s_ptr stream = weak_stream.lock();
+  if (stream && !stream->isClosed() && stream->getController()->IsCanceled()) {
+    stream->cancel();
+  }
+}
+
+void RpcStream::accept(std::shared_ptr<RpcController> controller, int32_t credit) {
+  controller_ = controller;
+  send_credit_ = credit;
+  // 客户端取消或连接断开时结束流，controller 结束时也会回调，此时流已经关闭
+  controller_->NotifyOnCancel(google::protobuf::NewCallback(
+      &onStreamCanceled, std::weak_ptr<RpcStream>(shared_from_this())));
+  sendCredit(window_);
+}
+
+asio::awaitable<bool> RpcStream::read(google::protobuf::Message &message) {
+  // 对端结束前已经收到的消息仍然可以读取
+  while (inbox_.empty()) {
+    if (closed_ || remote_done_) {
+      co_return false;
+    }
+    co_await wait(read_timer_);
+  }
+
+  std::shared_ptr<TinyPBProtocol> frame = inbox_.front();
+  inbox_.pop_front();
+
+  // 读取过半窗口后一次性补充额度，减少额度帧的数量
+  if (++unacked_ >= (window_ + 1) / 2 && !closed_ && !remote_done_) {
+    sendCredit(unacked_);
+    unacked_ = 0;
+  }
+
+  if (!message.ParseFromString(frame->pb_data_)) {
+    ERRORLOG("%lu | stream message deserialize error", req_id_);
+    abort(ERROR_FAILED_DESERIALIZE, "stream message deserialize error");
+    co_return false;
+  }
+  co_return true;
+}
+
+asio::awaitable<bool> RpcStream::write(const google::protobuf::Message &message) {
+  while (send_credit_ <= 0 && !closed_ && !local_done_) {
+    co_await wait(write_timer_);
+  }
+  if (closed_ || local_done_) {
+    co_return false;
+  }
+
+  std::shared_ptr<TinyPBProtocol> frame = makeFrame(TinyPBProtocol::MSG_STREAM_DATA);
+  if (!message.SerializeToString(&(frame->pb_data_))) {
+    ERRORLOG("%lu | stream message serialize error", req_id_);
+    co_return false;
+  }
+  send_credit_--;
+  sendFrame(frame);
+  co_return true;
+}
+
+void RpcStream::writesDone() {
+  if (side_ != Side::Client || local_done_ || closed_) {
+    return;
+  }
+  local_done_ = true;
+  sendFrame(makeFrame(TinyPBProtocol::MSG_STREAM_END));
+  notify(write_timer_);
+}
+
+void RpcStream::finish(int32_t err_code, const std::string &err_info) {
+  if (side_ != Side::Server || closed_) {
+    return;
+  }
+  local_done_ = true;
+  std::shared_ptr<TinyPBProtocol> frame = makeFrame(TinyPBProtocol::MSG_STREAM_END);
+  frame->err_code_ = err_code;
+  frame->err_info_ = err_info;
+  frame->err_info_len_ = err_info.length();
+  sendFrame(frame);
+  close(err_code, err_info);
+}
+
+void RpcStream::cancel() {
+  abort(ERROR_RPC_STREAM_CLOSED, "stream canceled");
+}
+
+void RpcStream::abort(int32_t err_code, const std::string &err_info) {
+  if (closed_) {
+    return;
+  }
+  inbox_.clear();
+  if (side_ == Side::Server) {
+    finish(err_code, err_info);
+    return;
+  }
+  std::shared_ptr<TinyPBProtocol> frame = makeFrame(TinyPBProtocol::MSG_CANCEL);
+  sendFrame(frame);
+  close(err_code, err_info);
+}
+
+void RpcStream::onMessage(std::shared_ptr<TinyPBProtocol> message) {
+  switch (message->msg_type_) {
+    case TinyPBProtocol::MSG_STREAM_DATA:
+      if (closed_ || remote_done_) {
+        return;
+      }
+      // 对端还没有拿到额度的消息数不能超过窗口
+      if ((int)inbox_.size() + unacked_ >= window_) {
+        ERRORLOG("%lu | peer exceeds stream flow control window[%d]",
+                 req_id_, window_);
+        abort(ERROR_RPC_STREAM_FLOW_CONTROL, "peer exceeds flow control window");
+        return;
+      }
+      inbox_.push_back(message);
+      notify(read_timer_);
+      break;
+    case TinyPBProtocol::MSG_STREAM_CREDIT:
+      send_credit_ += message->credit_;
+      notify(write_timer_);
+      break;
+    case TinyPBProtocol::MSG_STREAM_END:
+      remote_done_ = true;
+      if (side_ == Side::Client) {
+        // 服务端结束整个流，err_code 为最终状态
+        close(message->err_code_, message->err_info_);
+      } else {
+        notify(read_timer_);
+      }
+      break;
+    default:
+      DEBUGLOG("%lu | ignore stream message type[%d]", req_id_,
+               message->msg_type_);
+      break;
+  }
+}
+
+void RpcStream::onConnectionClosed() {
+  close(ERROR_PEER_CLOSED, "connection closed");
+}
+
+std::shared_ptr<TinyPBProtocol> RpcStream::makeFrame(uint8_t msg_type) {
+  std::shared_ptr<TinyPBProtocol> frame = ObjectPool<TinyPBProtocol>::Get();
+  frame->req_id_ = req_id_;
+  frame->msg_type_ = msg_type;
+  return frame;
+}
+
+void RpcStream::sendFrame(std::shared_ptr<TinyPBProtocol> frame) {
+  TcpConnection::s_ptr connection = connection_.lock();
+  if (!connection || !connection->is_open()) {
+    return;
+  }
+  std::vector<AbstractProtocol::s_ptr> messages;
+  messages.emplace_back(frame);
+  connection->reply(messages);
+}
+
+void RpcStream::sendCredit(int32_t credit) {
+  std::shared_ptr<TinyPBProtocol> frame = makeFrame(TinyPBProtocol::MSG_STREAM_CREDIT);
+  frame->credit_ = credit;
+  sendFrame(frame);
+}
+
+void RpcStream::close(int32_t err_code, const std::string &err_info) {
+  if (closed_) {
+    return;
+  }
+  closed_ = true;
+  err_code_ = err_code;
+  err_info_ = err_info;
+  DEBUGLOG("%lu | stream closed, error code[%d], error info[%s]", req_id_,
+           err_code, err_info.c_str());
+
+  TcpConnection::s_ptr connection = connection_.lock();
+  if (connection) {
+    connection->removeStream(req_id_);
+    if (side_ == Side::Server) {
+      connection->removeInflightRequest(req_id_);
+    }
+  }
+  if (controller_) {
+    if (err_code != 0) {
+      controller_->SetError(err_code, err_info);
+    }
+    controller_->SetFinished(true);
+  }
+
+  notify(read_timer_);
+  notify(write_timer_);
+}
+
+asio::awaitable<void> RpcStream::wait(asio::steady_timer &timer) {
+  timer.expires_at(std::chrono::steady_clock::time_point::max());
+  asio::error_code ec;
+  co_await timer.async_wait(asio::redirect_error(asio::use_awaitable, ec));
+}
+
+void RpcStream::notify(asio::steady_timer &timer) { timer.cancel(); }
+
+} // namespace rocket
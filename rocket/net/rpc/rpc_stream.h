@@ -0,0 +1,136 @@
+#ifndef ROCKET_NET_RPC_RPC_STREAM_H
+#define ROCKET_NET_RPC_RPC_STREAM_H
+
+#include "rocket/net/coder/tinypb_protocol.h"
+#include "rocket/net/tcp/tcp_client.h"
+#include "rocket/net/tcp/tcp_connection.h"
+#include <asio/awaitable.hpp>
+#include <asio/steady_timer.hpp>
+#include <google/protobuf/message.h>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace rocket {
+
+class RpcController;
+
+/**
+ * @brief 流式调用，一个 req_id 上双向传输多条消息，支持服务端流和双向流
+ *
+ * 1. 客户端通过 Open 建立连接并发送 MSG_STREAM_OPEN，服务端找到注册的流处理函数后回复初始额度
+ * 2. 双方通过 MSG_STREAM_DATA 发送消息，每发送一条消耗一个额度，额度用完时 write 挂起等待
+ * 3. 接收方读取的消息数达到窗口的一半时通过 MSG_STREAM_CREDIT 补充对端额度，
+ *    对端超过额度发送时视为协议错误并取消流
+ * 4. 客户端 writesDone 发送 MSG_STREAM_END 半关闭写方向，服务端 finish 发送带状态的 MSG_STREAM_END 结束整个流
+ * 5. 客户端可以通过 cancel 发送 MSG_CANCEL，连接断开时两端的流都会结束
+ *
+ * 所有操作都在连接所属的 IO 线程中执行，read/write 各自最多一个协程等待
+ */
+class RpcStream : public std::enable_shared_from_this<RpcStream> {
+public:
+  typedef std::shared_ptr<RpcStream> s_ptr;
+
+  enum class Side {
+    Client = 1,
+    Server = 2,
+  };
+
+  RpcStream(Side side, TcpConnection::s_ptr connection, uint64_t req_id,
+            int window);
+
+  ~RpcStream();
+
+  RpcStream(const RpcStream &) = delete;
+  RpcStream &operator=(const RpcStream &) = delete;
+
+  // 客户端打开流，失败时返回 nullptr，错误记录在 controller 中
+  // controller 可以指定 trace id 和优先级
+  static asio::awaitable<s_ptr> Open(const std::vector<tcp::endpoint> &peer_addrs,
+                                     const std::string &method_full_name,
+                                     std::shared_ptr<RpcController> controller);
+
+  // 读取下一条消息，对端发送完毕或流已经结束时返回 false
+  asio::awaitable<bool> read(google::protobuf::Message &message);
+
+  // 发送一条消息，没有额度时等待，流已经结束或本端已经发送完毕时返回 false
+  asio::awaitable<bool> write(const google::protobuf::Message &message);
+
+  // 客户端：不再发送消息
+  void writesDone();
+
+  // 服务端：以指定状态结束整个流，重复调用无效
+  void finish(int32_t err_code = 0, const std::string &err_info = "");
+
+  // 取消流，客户端会通知服务端
+  void cancel();
+
+  bool isClosed() const { return closed_; }
+
+  // 流的最终状态，服务端 finish 的状态或本地错误
+  int32_t getErrorCode() const { return err_code_; }
+
+  std::string getErrorInfo() const { return err_info_; }
+
+  uint64_t getReqId() const { return req_id_; }
+
+  // 服务端流对应的 controller，流结束时 finished，用于调度和准入统计
+  std::shared_ptr<RpcController> getController() { return controller_; }
+
+  // 以下由 TcpConnection 调用
+  void onMessage(std::shared_ptr<TinyPBProtocol> message);
+
+  void onConnectionClosed();
+
+private:
+  friend class RpcDispatcher;
+
+  // 服务端接受流，credit 为客户端的接收窗口，回复本端的初始额度
+  void accept(std::shared_ptr<RpcController> controller, int32_t credit);
+
+  // 出错时结束流：客户端发送取消帧，服务端以错误状态结束
+  void abort(int32_t err_code, const std::string &err_info);
+
+  std::shared_ptr<TinyPBProtocol> makeFrame(uint8_t msg_type);
+
+  void sendFrame(std::shared_ptr<TinyPBProtocol> frame);
+
+  void sendCredit(int32_t credit);
+
+  // 本地结束流，唤醒所有等待者
+  void close(int32_t err_code, const std::string &err_info);
+
+  asio::awaitable<void> wait(asio::steady_timer &timer);
+
+  void notify(asio::steady_timer &timer);
+
+private:
+  Side side_;
+  std::weak_ptr<TcpConnection> connection_;
+  TcpClient::s_ptr client_;   // 客户端持有连接
+  uint64_t req_id_{0};
+  std::string method_name_;
+  std::shared_ptr<RpcController> controller_;
+
+  int window_{0};
+  int send_credit_{0};        // 本端还可以发送的消息数
+  int unacked_{0};            // 已读取但还没有给对端补充额度的消息数
+
+  std::deque<std::shared_ptr<TinyPBProtocol>> inbox_;
+
+  bool remote_done_{false};   // 对端不再发送
+  bool local_done_{false};    // 本端不再发送
+  bool closed_{false};
+
+  int32_t err_code_{0};
+  std::string err_info_;
+
+  asio::steady_timer read_timer_;
+  asio::steady_timer write_timer_;
+};
+
+} // namespace rocket
+
+#endif
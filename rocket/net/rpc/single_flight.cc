@@ -0,0 +1,58 @@
+#include "rocket/net/rpc/single_flight.h"
+#include "rocket/common/config.h"
+#include "rocket/logger/log.h"
+
+namespace rocket {
+
+static Gauge *flightsGauge() {
+  static Gauge *gauge = MetricsRegistry::GetInstance()->getGauge("rocket_singleflight_inflight");
+  return gauge;
+}
+
+SingleFlight::SingleFlight() {
+  if (Config::GetGlobalConfig()) {
+    for (const std::string &method : Config::GetGlobalConfig()->single_flight_config_.methods) {
+      enableMethod(method);
+    }
+  }
+}
+
+void SingleFlight::enableMethod(const std::string &method_full_name) {
+  methods_[method_full_name] = MetricsRegistry::GetInstance()->getCounter(
+      "rocket_singleflight_shared_total{method=\"" + method_full_name + "\"}");
+}
+
+bool SingleFlight::join(const std::string &method_full_name, const std::string &key, Waiter waiter) {
+  std::scoped_lock<std::mutex> lock(mutex_);
+  std::vector<Waiter> &waiters = flights_[key];
+  waiters.push_back(std::move(waiter));
+  if (waiters.size() == 1) {
+    flightsGauge()->add(1);
+    return true;
+  }
+  auto it = methods_.find(method_full_name);
+  if (it != methods_.end()) {
+    it->second->inc();
+  }
+  return false;
+}
+
+void SingleFlight::finish(const std::string &key, std::shared_ptr<const FlightResult> result) {
+  std::vector<Waiter> waiters;
+  {
+    std::scoped_lock<std::mutex> lock(mutex_);
+    auto it = flights_.find(key);
+    if (it == flights_.end()) {
+      return;
+    }
+    waiters.swap(it->second);
+    flights_.erase(it);
+    flightsGauge()->add(-1);
+  }
+  DEBUGLOG("singleflight done, %lu waiters, error code[%d]", waiters.size(), result->error_code);
+  for (Waiter &waiter : waiters) {
+    waiter(result);
+  }
+}
+
+} // namespace rocket
@@ -0,0 +1,60 @@
+#ifndef ROCKET_NET_RPC_SINGLE_FLIGHT_H
+#define ROCKET_NET_RPC_SINGLE_FLIGHT_H
+
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "rocket/common/metrics.h"
+#include "rocket/common/singleton.h"
+
+namespace rocket {
+
+// 一次合并调用的结果，所有等待者共享，完成后只读
+struct FlightResult {
+  int32_t error_code{0};
+  std::string error_info;
+  std::string pb_data;   // 成功时为序列化的响应，每个等待者各自解析
+};
+
+/**
+ * @brief 客户端在途调用合并(singleflight)
+ *
+ * key 为方法名加序列化后的请求，key 相同的调用只向服务端发送第一个，其余调用挂在它上面等待，
+ * 结束时所有等待者拿到同一份结果(包括错误和超时)。由 RpcChannel 在发送请求前使用，
+ * 只对配置或 enableMethod 开启的方法生效。
+ */
+class SingleFlight : public Singleton<SingleFlight> {
+public:
+  typedef std::function<void(std::shared_ptr<const FlightResult>)> Waiter;
+
+  SingleFlight();
+
+  // 开启方法的合并，需要在发起调用前调用
+  void enableMethod(const std::string &method_full_name);
+
+  bool enabled(const std::string &method_full_name) const {
+    return !methods_.empty() && methods_.find(method_full_name) != methods_.end();
+  }
+
+  // 加入 key 相同的在途调用，返回 true 表示当前没有在途调用，调用方需要发起请求并在结束时调用 finish
+  bool join(const std::string &method_full_name, const std::string &key, Waiter waiter);
+
+  // 唤醒所有等待者，等待者在调用 finish 的线程中执行
+  void finish(const std::string &key, std::shared_ptr<const FlightResult> result);
+
+private:
+  std::map<std::string, Counter *> methods_;   // 方法名 -> 被合并的调用数
+
+  std::mutex mutex_;
+  std::unordered_map<std::string, std::vector<Waiter>> flights_;
+};
+
+} // namespace rocket
+
+#endif
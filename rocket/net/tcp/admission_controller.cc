@@ -0,0 +1,111 @@
+#include "rocket/net/tcp/admission_controller.h"
+#include "rocket/logger/log.h"
+
+namespace rocket {
+
+AdmissionController::Ticket::Ticket(
+    std::shared_ptr<std::atomic<int>> connection_inflight, int64_t bytes)
+    : connection_inflight_(connection_inflight), bytes_(bytes) {}
+
+AdmissionController::Ticket::~Ticket() {
+  AdmissionController::GetInstance()->releaseRequest(*connection_inflight_,
+                                                     bytes_);
+}
+
+AdmissionController::AdmissionController() {
+  if (Config::GetGlobalConfig()) {
+    config_ = Config::GetGlobalConfig()->admission_config_;
+  }
+
+  MetricsRegistry *registry = MetricsRegistry::GetInstance();
+  connections_gauge_ = registry->getGauge("rocket_server_connections");
+  inflight_gauge_ = registry->getGauge("rocket_server_inflight_requests");
+  pending_bytes_gauge_ = registry->getGauge("rocket_server_pending_bytes");
+
+  std::string name = "rocket_server_admission_rejects_total";
+  connection_rejects_ = registry->getCounter(name + "{reason=\"connections\"}");
+  thread_connection_rejects_ =
+      registry->getCounter(name + "{reason=\"thread_connections\"}");
+  inflight_rejects_ = registry->getCounter(name + "{reason=\"inflight\"}");
+  connection_inflight_rejects_ =
+      registry->getCounter(name + "{reason=\"connection_inflight\"}");
+  pending_bytes_rejects_ = registry->getCounter(name + "{reason=\"pending_bytes\"}");
+}
+
+AdmissionController::ConnectionResult
+AdmissionController::tryAcquireConnection(std::atomic<int> &thread_connections) {
+  if (config_.max_connections > 0 &&
+      connections_.load(std::memory_order_relaxed) >= config_.max_connections) {
+    return ConnectionResult::GlobalLimit;
+  }
+  if (config_.max_connections_per_thread > 0 &&
+      thread_connections.load(std::memory_order_relaxed) >=
+          config_.max_connections_per_thread) {
+    return ConnectionResult::ThreadLimit;
+  }
+
+  // 只有 accept 线程增加连接数，检查和增加之间不会被其他线程抢占名额
+  connections_.fetch_add(1, std::memory_order_relaxed);
+  thread_connections.fetch_add(1, std::memory_order_relaxed);
+  connections_gauge_->add(1);
+  return ConnectionResult::Accepted;
+}
+
+void AdmissionController::releaseConnection(
+    std::atomic<int> &thread_connections) {
+  connections_.fetch_sub(1, std::memory_order_relaxed);
+  thread_connections.fetch_sub(1, std::memory_order_relaxed);
+  connections_gauge_->add(-1);
+}
+
+void AdmissionController::onConnectionRejected(ConnectionResult reason) {
+  if (reason == ConnectionResult::GlobalLimit) {
+    connection_rejects_->inc();
+  } else if (reason == ConnectionResult::ThreadLimit) {
+    thread_connection_rejects_->inc();
+  }
+}
+
+AdmissionController::TicketPtr AdmissionController::admitRequest(
+    std::shared_ptr<std::atomic<int>> connection_inflight, int64_t bytes) {
+  // 先占用再检查，超过上限时回滚，多个 IO 线程并发准入时不会超发
+  int64_t inflight = inflight_.fetch_add(1, std::memory_order_relaxed) + 1;
+  int connection_count =
+      connection_inflight->fetch_add(1, std::memory_order_relaxed) + 1;
+  int64_t pending_bytes =
+      pending_bytes_.fetch_add(bytes, std::memory_order_relaxed) + bytes;
+
+  Counter *reject = nullptr;
+  if (config_.max_inflight > 0 && inflight > config_.max_inflight) {
+    reject = inflight_rejects_;
+  } else if (config_.max_inflight_per_connection > 0 &&
+             connection_count > config_.max_inflight_per_connection) {
+    reject = connection_inflight_rejects_;
+  } else if (config_.max_pending_bytes > 0 &&
+             pending_bytes > config_.max_pending_bytes) {
+    reject = pending_bytes_rejects_;
+  }
+
+  if (reject != nullptr) {
+    inflight_.fetch_sub(1, std::memory_order_relaxed);
+    connection_inflight->fetch_sub(1, std::memory_order_relaxed);
+    pending_bytes_.fetch_sub(bytes, std::memory_order_relaxed);
+    reject->inc();
+    return nullptr;
+  }
+
+  inflight_gauge_->add(1);
+  pending_bytes_gauge_->add(bytes);
+  return std::make_shared<Ticket>(connection_inflight, bytes);
+}
+
+void AdmissionController::releaseRequest(std::atomic<int> &connection_inflight,
+                                         int64_t bytes) {
+  inflight_.fetch_sub(1, std::memory_order_relaxed);
+  connection_inflight.fetch_sub(1, std::memory_order_relaxed);
+  pending_bytes_.fetch_sub(bytes, std::memory_order_relaxed);
+  inflight_gauge_->add(-1);
+  pending_bytes_gauge_->add(-bytes);
+}
+
+} // namespace rocket
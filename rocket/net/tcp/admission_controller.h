@@ -0,0 +1,82 @@
+#ifndef ROCKET_NET_TCP_ADMISSION_CONTROLLER_H
+#define ROCKET_NET_TCP_ADMISSION_CONTROLLER_H
+
+#include "rocket/common/config.h"
+#include "rocket/common/metrics.h"
+#include "rocket/common/singleton.h"
+#include <atomic>
+#include <cstdint>
+#include <memory>
+
+namespace rocket {
+
+/**
+ * @brief 服务端准入控制
+ *
+ * 1. 连接数：全局上限和每个 IO 线程的上限，超过时 accept 后直接关闭
+ * 2. 请求：全局和每个连接正在处理(排队+执行)的请求数，以及这些请求占用的字节数，
+ *    超过时请求不再排队，直接回复过载错误
+ * 请求准入成功返回 Ticket，请求结束(回包、取消、丢弃)时 Ticket 析构归还资源
+ */
+class AdmissionController : public Singleton<AdmissionController> {
+public:
+  enum class ConnectionResult {
+    Accepted = 1,
+    GlobalLimit = 2,
+    ThreadLimit = 3,
+  };
+
+  class Ticket {
+  public:
+    Ticket(std::shared_ptr<std::atomic<int>> connection_inflight,
+           int64_t bytes);
+
+    ~Ticket();
+
+    Ticket(const Ticket &) = delete;
+    Ticket &operator=(const Ticket &) = delete;
+
+  private:
+    std::shared_ptr<std::atomic<int>> connection_inflight_;
+    int64_t bytes_{0};
+  };
+
+  typedef std::shared_ptr<Ticket> TicketPtr;
+
+  AdmissionController();
+
+  // 占用一个连接名额，thread_connections 为目标 IO 线程的连接计数
+  ConnectionResult tryAcquireConnection(std::atomic<int> &thread_connections);
+
+  void releaseConnection(std::atomic<int> &thread_connections);
+
+  void onConnectionRejected(ConnectionResult reason);
+
+  // 请求准入，返回 nullptr 表示拒绝
+  TicketPtr admitRequest(std::shared_ptr<std::atomic<int>> connection_inflight,
+                         int64_t bytes);
+
+private:
+  void releaseRequest(std::atomic<int> &connection_inflight, int64_t bytes);
+
+private:
+  AdmissionConfig config_;
+
+  std::atomic<int64_t> connections_{0};
+  std::atomic<int64_t> inflight_{0};
+  std::atomic<int64_t> pending_bytes_{0};
+
+  Gauge *connections_gauge_{nullptr};
+  Gauge *inflight_gauge_{nullptr};
+  Gauge *pending_bytes_gauge_{nullptr};
+
+  Counter *connection_rejects_{nullptr};
+  Counter *thread_connection_rejects_{nullptr};
+  Counter *inflight_rejects_{nullptr};
+  Counter *connection_inflight_rejects_{nullptr};
+  Counter *pending_bytes_rejects_{nullptr};
+};
+
+} // namespace rocket
+
+#endif
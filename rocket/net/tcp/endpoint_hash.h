@@ -0,0 +1,28 @@
+#ifndef ROCKET_NET_TCP_ENDPOINT_HASH_H
+#define ROCKET_NET_TCP_ENDPOINT_HASH_H
+
+#include <asio/ip/tcp.hpp>
+#include <cstddef>
+#include <functional>
+
+namespace rocket {
+
+// tcp::endpoint 的哈希函数，用于以节点地址为 key 的无序容器
+struct EndpointHash {
+  std::size_t operator()(const asio::ip::tcp::endpoint &addr) const noexcept {
+    std::size_t h = 0;
+    if (addr.address().is_v4()) {
+      h = addr.address().to_v4().to_uint();
+    } else {
+      auto bytes = addr.address().to_v6().to_bytes();
+      for (auto b : bytes) {
+        h = h * 31 + b;
+      }
+    }
+    return h * 65599 + addr.port();
+  }
+};
+
+} // namespace rocket
+
+#endif
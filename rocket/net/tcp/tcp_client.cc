@@ -1,5 +1,6 @@
 #include "rocket/net/tcp/tcp_client.h"
 #include "event_loop.h"
+#include "rocket/common/error_code.h"
 #include "rocket/logger/log.h"
 #include "tcp_connection.h"
 #include <asio/awaitable.hpp>
@@ -30,6 +31,7 @@ asio::awaitable<void> TcpClient::connect() {
     connection_->start();
   } catch (std::exception &e) {
     INFOLOG("tcp connect error %s", e.what());
+    connect_error_code_ = ERROR_FAILED_CONNECT;
     connect_error_info_ = std::string("tcp connect exception: ") + e.what();
   }
 }
@@ -55,17 +57,25 @@ void TcpClient::writeMessage(
 
 // 异步的读取 message
 // 如果读取 message 成功，会调用 done 函数， 函数的入参就是 message 对象
-void TcpClient::readMessage(const std::string &msg_id,
+void TcpClient::readMessage(uint64_t req_id,
                             std::function<void(AbstractProtocol::s_ptr)> done) {
   // 1. 监听可读事件
-  // 2. 从 buffer 里 decode 得到 message 对象, 判断是否 msg_id
+  // 2. 从 buffer 里 decode 得到 message 对象, 判断是否 req_id
   // 相等，相等则读成功，执行其回调
   if (connection_) {
-    connection_->pushReadMessage(msg_id, done);
+    connection_->pushReadMessage(req_id, done);
     connection_->listenRead();
   }
 }
 
+void TcpClient::cancelReadMessage(uint64_t req_id) {
+  if (connection_) {
+    connection_->cancelReadMessage(req_id);
+  }
+}
+
+bool TcpClient::isConnected() { return connection_ && connection_->is_open(); }
+
 int TcpClient::getConnectErrorCode() { return connect_error_code_; }
 
 std::string TcpClient::getConnectErrorInfo() { return connect_error_info_; }
@@ -31,9 +31,17 @@ public:
 
   // 异步的读取 message
   // 如果读取 message 成功，会调用 done 函数， 函数的入参就是 message 对象
-  void readMessage(const std::string &msg_id,
+  void readMessage(uint64_t req_id,
                    std::function<void(AbstractProtocol::s_ptr)> done);
 
+  // 不再等待 req_id 对应的响应
+  void cancelReadMessage(uint64_t req_id);
+
+  bool isConnected();
+
+  // 连接成功后有效，流式调用直接在连接上收发消息
+  TcpConnection::s_ptr getConnection() { return connection_; }
+
   void stop();
 
   int getConnectErrorCode();
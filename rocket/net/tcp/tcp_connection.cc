@@ -1,6 +1,10 @@
 #include "rocket/net/tcp/tcp_connection.h"
+#include "rocket/common/config.h"
 #include "rocket/logger/log.h"
 #include "rocket/net/coder/tinypb_coder.h"
+#include "rocket/net/rpc/request_scheduler.h"
+#include "rocket/net/rpc/rpc_controller.h"
+#include "rocket/net/rpc/rpc_stream.h"
 #include <asio/awaitable.hpp>
 #include <asio/buffer.hpp>
 #include <asio/co_spawn.hpp>
@@ -8,7 +12,9 @@
 #include <asio/io_context.hpp>
 #include <asio/read.hpp>
 #include <asio/write.hpp>
+#include <algorithm>
 #include <chrono>
+#include <iterator>
 #include <memory>
 #include <sys/stat.h>
 #include <unistd.h>
@@ -27,6 +33,13 @@ TcpConnection::TcpConnection(asio::io_context *io_context, tcp::socket socket,
   peer_addr_ = socket_.remote_endpoint();
   timer_.expires_at(std::chrono::steady_clock::time_point::max());
   coder_ = std::make_unique<TinyPBCoder>();
+
+  // 本机回环连接可信，按配置跳过校验
+  Config *config = Config::GetGlobalConfig();
+  if (config && config->checksum_config_.skip_loopback &&
+      peer_addr_.address().is_loopback()) {
+    setVerifyChecksum(false);
+  }
 }
 
 TcpConnection::~TcpConnection() {
@@ -38,6 +51,15 @@ TcpConnection::~TcpConnection() {
 void TcpConnection::start() {
 
   state_.store(State::Connected, std::memory_order_relaxed);
+
+  // 客户端先发送握手帧，不等待回复：回复到达前按旧版本协议收发，对端不支持握手时一直如此
+  Config *config = Config::GetGlobalConfig();
+  if (connection_type_ == ConnectionType::TcpConnectionByClient &&
+      (config == nullptr || config->protocol_config_.hello)) {
+    pushSendMessage(tinypbCoder()->makeHello(), [](AbstractProtocol::s_ptr) {});
+    listenWrite();
+  }
+
   asio::co_spawn(
       *io_context_,
       [self = shared_from_this()]() -> awaitable<void> {
@@ -98,17 +120,42 @@ void TcpConnection::execute() {
     // 将 RPC 请求执行业务逻辑，获取 RPC 响应, 再把 RPC 响应发送回去
     std::vector<AbstractProtocol::s_ptr> result;
     coder_->decode(result, in_buffer_);
+    // 同一批解码出的请求共用一个到达时间
+    int64_t arrive_us = result.empty() ? 0 : getSteadyNowUs();
     for (size_t i = 0; i < result.size(); ++i) {
       // 1. 针对每一个请求，调用 rpc 方法，获取响应 message
       // 2. 将响应 message 放入到发送缓冲区，监听可写事件回包
-      DEBUGLOG("success get request[%s] from client[%s]",
-               result[i]->msg_id_.c_str(),
+      DEBUGLOG("success get request[%lu] from client[%s]",
+               result[i]->req_id_,
                peer_addr_.address().to_string().c_str());
 
-      std::shared_ptr<TinyPBProtocol> message =
-          std::make_shared<TinyPBProtocol>();
+      std::shared_ptr<TinyPBProtocol> request =
+          std::dynamic_pointer_cast<TinyPBProtocol>(result[i]);
+      request->arrive_us_ = arrive_us;
+      RequestScheduler *scheduler = RequestScheduler::GetThreadScheduler();
+
+      if (handleHello(request)) {
+        continue;
+      }
+
+      // 已经打开的流上的消息直接交给流处理
+      if (dispatchStreamMessage(request)) {
+        continue;
+      }
 
-      RpcDispatcher::GetRpcDispatcher()->dispatch(result[i], message, this);
+      // 取消帧不排队：请求还在队列中直接删除，否则通知正在处理的请求
+      if (request->msg_type_ == TinyPBProtocol::MSG_CANCEL) {
+        if (!scheduler->cancel(this, request->req_id_)) {
+          std::shared_ptr<TinyPBProtocol> message =
+              ObjectPool<TinyPBProtocol>::Get();
+          RpcDispatcher::GetRpcDispatcher()->dispatch(request, message,
+                                                      shared_from_this());
+        }
+        continue;
+      }
+
+      // 请求先进入本线程的调度队列，按优先级分发
+      scheduler->enqueue(request, shared_from_this());
     }
 
   } else {
@@ -117,16 +164,78 @@ void TcpConnection::execute() {
     coder_->decode(result, in_buffer_);
 
     for (size_t i = 0; i < result.size(); ++i) {
-      std::string msg_id = result[i]->msg_id_;
-      auto it = read_dones_.find(msg_id);
+      if (handleHello(result[i]) || dispatchStreamMessage(result[i])) {
+        continue;
+      }
+      auto it = read_dones_.find(result[i]->req_id_);
       if (it != read_dones_.end()) {
-        it->second(result[i]);
+        // 回调中可能释放连接的持有者，先从 map 中取出再执行
+        auto done = std::move(it->second);
         read_dones_.erase(it);
+        done(result[i]);
       }
     }
   }
 }
 
+bool TcpConnection::handleHello(AbstractProtocol::s_ptr message) {
+  std::shared_ptr<TinyPBProtocol> frame =
+      std::static_pointer_cast<TinyPBProtocol>(message);
+
+  if (connection_type_ == ConnectionType::TcpConnectionByServer) {
+    // 服务端只按帧类型识别握手，旧版本客户端的请求号为 0 时仍按普通请求处理
+    if (frame->msg_type_ != TinyPBProtocol::MSG_HELLO) {
+      return false;
+    }
+    // 先按对端能力协商，握手回复就可以使用协商后的格式
+    features_ = tinypbCoder()->applyHello(*frame);
+    std::shared_ptr<TinyPBProtocol> hello = tinypbCoder()->makeHello();
+    // 所有方法的 id 互不冲突时，客户端可以只发送方法 id
+    if (RpcDispatcher::GetRpcDispatcher()->methodIdUsable()) {
+      hello->features_ |= TinyPBProtocol::FEATURE_METHOD_ID;
+    }
+    std::vector<AbstractProtocol::s_ptr> replies;
+    replies.emplace_back(hello);
+    reply(replies);
+  } else if (frame->req_id_ != TinyPBProtocol::HELLO_REQ_ID) {
+    return false;
+  } else if (frame->msg_type_ == TinyPBProtocol::MSG_HELLO) {
+    features_ = tinypbCoder()->applyHello(*frame);
+  } else {
+    // 不支持握手但出错时会回包的服务端，对握手帧回复了错误；更早的服务端不回复，连接保持旧版本协议
+    features_ = tinypbCoder()->applyLegacy();
+  }
+
+  INFOLOG("protocol negotiated with peer[%s], version[%d], codecs[0x%x], "
+          "peer max frame size[%d], peer features[0x%x]",
+          peer_addr_.address().to_string().c_str(), features_.version,
+          features_.codecs, features_.peer_max_frame_size,
+          features_.peer_features);
+  return true;
+}
+
+bool TcpConnection::dispatchStreamMessage(AbstractProtocol::s_ptr message) {
+  std::shared_ptr<TinyPBProtocol> frame =
+      std::dynamic_pointer_cast<TinyPBProtocol>(message);
+  if (!frame || (frame->msg_type_ != TinyPBProtocol::MSG_STREAM_DATA &&
+                 frame->msg_type_ != TinyPBProtocol::MSG_STREAM_CREDIT &&
+                 frame->msg_type_ != TinyPBProtocol::MSG_STREAM_END)) {
+    return false;
+  }
+
+  auto it = streams_.find(frame->req_id_);
+  std::shared_ptr<RpcStream> stream;
+  if (it != streams_.end()) {
+    stream = it->second.lock();
+  }
+  if (stream) {
+    stream->onMessage(frame);
+  } else {
+    DEBUGLOG("%lu | stream not found, ignore stream message", frame->req_id_);
+  }
+  return true;
+}
+
 /*
  * 服务端回复客户端
  */
@@ -145,6 +254,7 @@ awaitable<void> TcpConnection::writer() {
   while (is_open()) {
 
     if (out_buffer_.dataSize() > 0 || write_dones_.size() > 0) {
+      size_t encoded_count = 0;
       // 客户端需要编码消息
       if (connection_type_ == ConnectionType::TcpConnectionByClient) {
         // 1. 将 message encode 得到字节流
@@ -154,6 +264,7 @@ awaitable<void> TcpConnection::writer() {
         for (size_t i = 0; i < write_dones_.size(); ++i) {
           messages.push_back(write_dones_[i].first);
         }
+        encoded_count = write_dones_.size();
 
         coder_->encode(messages, out_buffer_);
       }
@@ -182,10 +293,18 @@ awaitable<void> TcpConnection::writer() {
       DEBUGLOG("write bytes: %ld, to endpoint[%s]", bytes_write,
                peer_addr_.address().to_string().c_str());
       if (connection_type_ == ConnectionType::TcpConnectionByClient) {
-        for (size_t i = 0; i < write_dones_.size(); ++i) {
-          write_dones_[i].second(write_dones_[i].first);
+        // 写的过程中可能有新消息加入，只回调本次已经编码发送的消息
+        // 回调中可能释放连接的持有者，先把回调取出来再执行
+        encoded_count = std::min(encoded_count, write_dones_.size());
+        std::vector<std::pair<AbstractProtocol::s_ptr,
+                              std::function<void(AbstractProtocol::s_ptr)>>>
+            dones(std::make_move_iterator(write_dones_.begin()),
+                  std::make_move_iterator(write_dones_.begin() + encoded_count));
+        write_dones_.erase(write_dones_.begin(),
+                           write_dones_.begin() + encoded_count);
+        for (size_t i = 0; i < dones.size(); ++i) {
+          dones[i].second(dones[i].first);
         }
-        write_dones_.clear();
       }
     } else {
       asio::error_code ec;
@@ -229,6 +348,35 @@ void TcpConnection::shutdown() {
   // 清空缓冲区和回调列表
   write_dones_.clear();
   read_dones_.clear();
+
+  // 对端已经断开，没有人再等待在途请求的结果
+  std::unordered_map<uint64_t, std::shared_ptr<RpcController>> inflight;
+  {
+    std::scoped_lock<std::mutex> lock(inflight_mutex_);
+    inflight.swap(inflight_requests_);
+  }
+  for (auto &it : inflight) {
+    it.second->StartCancel();
+  }
+
+  std::unordered_map<uint64_t, std::weak_ptr<RpcStream>> streams;
+  streams.swap(streams_);
+  for (auto &it : streams) {
+    std::shared_ptr<RpcStream> stream = it.second.lock();
+    if (stream) {
+      stream->onConnectionClosed();
+    }
+  }
+
+  if (close_callback_) {
+    auto cb = std::move(close_callback_);
+    close_callback_ = nullptr;
+    cb();
+  }
+}
+
+void TcpConnection::setVerifyChecksum(bool verify) {
+  tinypbCoder()->setVerifyChecksum(verify);
 }
 
 void TcpConnection::setConnectionType(ConnectionType type) {
@@ -246,9 +394,53 @@ void TcpConnection::pushSendMessage(
 }
 
 void TcpConnection::pushReadMessage(
-    const std::string &msg_id,
+    uint64_t req_id,
     std::function<void(AbstractProtocol::s_ptr)> done) {
-  read_dones_.insert(std::make_pair(msg_id, done));
+  read_dones_.insert(std::make_pair(req_id, done));
+}
+
+void TcpConnection::registerStream(uint64_t req_id,
+                                   std::weak_ptr<RpcStream> stream) {
+  streams_[req_id] = stream;
+}
+
+void TcpConnection::removeStream(uint64_t req_id) {
+  streams_.erase(req_id);
+}
+
+void TcpConnection::setCloseCallback(std::function<void()> cb) {
+  close_callback_ = std::move(cb);
+}
+
+void TcpConnection::cancelReadMessage(uint64_t req_id) {
+  read_dones_.erase(req_id);
+}
+
+void TcpConnection::addInflightRequest(
+    uint64_t req_id, std::shared_ptr<RpcController> controller) {
+  std::scoped_lock<std::mutex> lock(inflight_mutex_);
+  inflight_requests_[req_id] = controller;
+}
+
+void TcpConnection::removeInflightRequest(uint64_t req_id) {
+  std::scoped_lock<std::mutex> lock(inflight_mutex_);
+  inflight_requests_.erase(req_id);
+}
+
+void TcpConnection::cancelInflightRequest(uint64_t req_id) {
+  std::shared_ptr<RpcController> controller;
+  {
+    std::scoped_lock<std::mutex> lock(inflight_mutex_);
+    auto it = inflight_requests_.find(req_id);
+    if (it == inflight_requests_.end()) {
+      return;
+    }
+    controller = it->second;
+    inflight_requests_.erase(it);
+  }
+  DEBUGLOG("%lu | cancel inflight request from client[%s]", req_id,
+           peer_addr_.address().to_string().c_str());
+  controller->StartCancel();
 }
 
 tcp::endpoint TcpConnection::getLocalAddr() { return local_addr_; }
@@ -2,6 +2,7 @@
 #define ROCKET_NET_TCP_TCP_CONNECTION_H
 
 #include "rocket/net/coder/abstract_coder.h"
+#include "rocket/net/coder/tinypb_coder.h"
 #include "rocket/net/rpc/rpc_dispatcher.h"
 #include "tcp_buffer.h"
 #include <asio/awaitable.hpp>
@@ -12,11 +13,17 @@
 #include <asio/steady_timer.hpp>
 #include <asio/use_awaitable.hpp>
 #include <atomic>
+#include <functional>
 #include <map>
 #include <memory>
+#include <mutex>
+#include <unordered_map>
 
 namespace rocket {
 
+class RpcController;
+class RpcStream;
+
 using asio::awaitable;
 using asio::redirect_error;
 using asio::use_awaitable;
@@ -64,6 +71,12 @@ public:
 
   void setConnectionType(ConnectionType type);
 
+  // 是否校验收到的报文的校验和，默认按配置，本机回环连接可以跳过
+  void setVerifyChecksum(bool verify);
+
+  // 握手协商出的特性，握手完成前为旧版本协议的默认值
+  const ProtocolFeatures &getFeatures() const { return features_; }
+
   // 启动监听可写事件
   void listenWrite();
 
@@ -73,9 +86,33 @@ public:
   void pushSendMessage(AbstractProtocol::s_ptr message,
                        std::function<void(AbstractProtocol::s_ptr)> done);
 
-  void pushReadMessage(const std::string &msg_id,
+  void pushReadMessage(uint64_t req_id,
                        std::function<void(AbstractProtocol::s_ptr)> done);
 
+  // 不再等待 req_id 对应的响应
+  void cancelReadMessage(uint64_t req_id);
+
+  // 服务端在途请求，用于响应对端发来的取消帧，连接断开时全部取消
+  void addInflightRequest(uint64_t req_id,
+                          std::shared_ptr<RpcController> controller);
+
+  void removeInflightRequest(uint64_t req_id);
+
+  void cancelInflightRequest(uint64_t req_id);
+
+  // 流式调用，流相关的帧按 req_id 直接交给对应的流，不经过调度队列
+  void registerStream(uint64_t req_id, std::weak_ptr<RpcStream> stream);
+
+  void removeStream(uint64_t req_id);
+
+  // 连接关闭时回调，只会调用一次
+  void setCloseCallback(std::function<void()> cb);
+
+  // 本连接正在处理的请求数，用于准入控制
+  std::shared_ptr<std::atomic<int>> inflightCounter() { return inflight_count_; }
+
+  asio::io_context *getIOContext() { return io_context_; }
+
   tcp::endpoint getLocalAddr();
 
   tcp::endpoint getPeerAddr();
@@ -83,6 +120,15 @@ public:
   void reply(std::vector<AbstractProtocol::s_ptr> &replay_messages);
 
 private:
+  // 流相关的帧交给对应的流处理，返回 false 表示不是流的帧
+  bool dispatchStreamMessage(AbstractProtocol::s_ptr message);
+
+  // 处理握手帧，返回 false 表示不是握手帧
+  bool handleHello(AbstractProtocol::s_ptr message);
+
+  // coder_ 只会是 TinyPBCoder
+  TinyPBCoder *tinypbCoder() { return static_cast<TinyPBCoder *>(coder_.get()); }
+
   awaitable<void> reader();
   awaitable<void> writer();
 
@@ -110,9 +156,25 @@ private:
                         std::function<void(AbstractProtocol::s_ptr)>>>
       write_dones_;
 
-  // key 为 msg_id
-  std::map<std::string, std::function<void(AbstractProtocol::s_ptr)>>
+  // key 为 req_id
+  std::unordered_map<uint64_t, std::function<void(AbstractProtocol::s_ptr)>>
       read_dones_;
+
+  // key 为 req_id，业务处理可能在其他线程完成，需要加锁
+  std::mutex inflight_mutex_;
+  std::unordered_map<uint64_t, std::shared_ptr<RpcController>>
+      inflight_requests_;
+
+  // key 为 req_id，只在 IO 线程访问
+  std::unordered_map<uint64_t, std::weak_ptr<RpcStream>> streams_;
+
+  std::shared_ptr<std::atomic<int>> inflight_count_{
+      std::make_shared<std::atomic<int>>(0)};
+
+  std::function<void()> close_callback_;
+
+  // 只在 IO 线程修改
+  ProtocolFeatures features_;
 };
 
 } // namespace rocket
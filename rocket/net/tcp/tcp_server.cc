@@ -3,6 +3,7 @@
 #include "rocket/common/config.h"
 #include "rocket/logger/log.h"
 #include "rocket/net/io_thread_group.h"
+#include "rocket/net/tcp/admission_controller.h"
 #include "rocket/net/tcp/tcp_connection.h"
 #include "rocket/net/pending_connection.h"
 #include <asio/awaitable.hpp>
@@ -55,8 +56,25 @@ awaitable<void> TcpServer::listener() {
       co_return;
     }
 
-    // Round-robin 选择一个 IO 线程
-    IOThread* io_thread = io_thread_group_->getIOThread();
+    // Round-robin 选择一个 IO 线程，跳过连接数已满的线程
+    AdmissionController* admission = AdmissionController::GetInstance();
+    AdmissionController::ConnectionResult result =
+        AdmissionController::ConnectionResult::ThreadLimit;
+    IOThread* io_thread = nullptr;
+    for (int i = 0; i < io_thread_group_->size() &&
+                    result == AdmissionController::ConnectionResult::ThreadLimit;
+         ++i) {
+      io_thread = io_thread_group_->getIOThread();
+      result = admission->tryAcquireConnection(io_thread->connectionCount());
+    }
+    if (result != AdmissionController::ConnectionResult::Accepted) {
+      admission->onConnectionRejected(result);
+      INFOLOG("TcpServer reject client[%s], too many connections",
+              socket.remote_endpoint(ec).address().to_string().c_str());
+      socket.close(ec);
+      continue;
+    }
+
     EventLoop* run_event_loop = io_thread->getEventLoop();
     auto run_io_context = run_event_loop->getIOContext();
 
@@ -64,9 +82,21 @@ awaitable<void> TcpServer::listener() {
             socket.remote_endpoint().address().to_string().c_str());
 
     // 在 accept 线程中创建 TcpConnection 对象（轻量级操作）
-    std::shared_ptr<TcpConnection> connection =
-        std::make_shared<TcpConnection>(run_io_context, std::move(socket), 128);
+    std::shared_ptr<TcpConnection> connection;
+    try {
+      connection = std::make_shared<TcpConnection>(run_io_context, std::move(socket), 128);
+    } catch (std::exception& e) {
+      // 对端在 accept 之后立即断开，取地址会失败
+      ERRORLOG("TcpServer create connection error: %s", e.what());
+      admission->releaseConnection(io_thread->connectionCount());
+      continue;
+    }
+
 
+    connection->setCloseCallback([io_thread]() {
+      AdmissionController::GetInstance()->releaseConnection(
+          io_thread->connectionCount());
+    });
 
     clients_.insert(connection);
 
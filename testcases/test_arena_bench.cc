@@ -0,0 +1,127 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <new>
+#include <string>
+#include "rocket/common/config.h"
+#include "rocket/logger/log.h"
+#include "rocket/net/rpc/request_arena.h"
+#include "rocket/net/rpc/rpc_closure.h"
+#include "proto/order.pb.h"
+
+// 对比服务端处理一次请求时消息分配在堆上和请求 Arena 上的内存分配次数和耗时
+// 模拟 RpcDispatcher::callMethod：解析请求、填充响应、序列化、执行闭包后释放
+
+static std::atomic<int64_t> g_allocs{0};
+
+void* operator new(size_t size) {
+  g_allocs.fetch_add(1, std::memory_order_relaxed);
+  void* p = std::malloc(size ? size : 1);
+  if (!p) {
+    throw std::bad_alloc();
+  }
+  return p;
+}
+
+void operator delete(void* p) noexcept { std::free(p); }
+
+void operator delete(void* p, size_t) noexcept { std::free(p); }
+
+int g_iterations = 1000000;
+
+static void handle(const std::string& pb_data, google::protobuf::Message* req_msg, google::protobuf::Message* rsp_msg, std::string& out) {
+  req_msg->ParseFromString(pb_data);
+  makeOrderRequest* request = static_cast<makeOrderRequest*>(req_msg);
+  makeOrderResponse* response = static_cast<makeOrderResponse*>(rsp_msg);
+  response->set_ret_code(0);
+  response->set_res_info("OK, goods " + request->goods());
+  response->set_order_id("20240101123456");
+  response->SerializeToString(&out);
+}
+
+static void report(const char* name, int64_t allocs, double seconds) {
+  std::cout << std::left << std::setw(6) << name << std::fixed << std::setprecision(2)
+            << "allocs/rpc: " << (double)allocs / g_iterations << ", "
+            << "ns/rpc: " << seconds * 1e9 / g_iterations << "\n";
+}
+
+static void runHeap(const std::string& pb_data) {
+  std::string out;
+  int64_t allocs = g_allocs.load();
+  auto begin = std::chrono::steady_clock::now();
+  for (int i = 0; i < g_iterations; ++i) {
+    google::protobuf::Message* req_msg = makeOrderRequest::default_instance().New();
+    google::protobuf::Message* rsp_msg = makeOrderResponse::default_instance().New();
+    rocket::RpcClosure* closure = new rocket::RpcClosure(nullptr, [req_msg, rsp_msg, &pb_data, &out]() {
+      handle(pb_data, req_msg, rsp_msg, out);
+    });
+    closure->Run();
+    delete closure;
+    delete req_msg;
+    delete rsp_msg;
+  }
+  double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+  report("heap", g_allocs.load() - allocs, seconds);
+}
+
+static void runArena(const std::string& pb_data) {
+  std::string out;
+  int64_t allocs = g_allocs.load();
+  auto begin = std::chrono::steady_clock::now();
+  for (int i = 0; i < g_iterations; ++i) {
+    rocket::RequestArena* request_arena = new rocket::RequestArena();
+    google::protobuf::Arena* arena = request_arena->get();
+    google::protobuf::Message* req_msg = makeOrderRequest::default_instance().New(arena);
+    google::protobuf::Message* rsp_msg = makeOrderResponse::default_instance().New(arena);
+    rocket::RpcClosure* closure = google::protobuf::Arena::Create<rocket::RpcClosure>(arena, nullptr, [req_msg, rsp_msg, &pb_data, &out]() {
+      handle(pb_data, req_msg, rsp_msg, out);
+    });
+    closure->setRelease([request_arena]() {
+      delete request_arena;
+    });
+    closure->Run();
+  }
+  double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+  report("arena", g_allocs.load() - allocs, seconds);
+}
+
+void printUsage(const char* program) {
+  std::cout << "Usage: " << program << " [-n <iterations>]\n";
+  std::cout << "Example: " << program << " -n 1000000\n";
+}
+
+int main(int argc, char* argv[]) {
+  for (int i = 1; i < argc; i += 2) {
+    if (i + 1 >= argc) {
+      printUsage(argv[0]);
+      return 1;
+    }
+    std::string arg = argv[i];
+    if (arg == "-n") {
+      g_iterations = std::max(1, std::atoi(argv[i + 1]));
+    } else {
+      printUsage(argv[0]);
+      return 1;
+    }
+  }
+
+  rocket::Config::SetGlobalConfig("../conf/rocket.xml");
+  rocket::Logger::InitGlobalLogger(0);
+
+  size_t goods_lens[] = {8, 256, 4096};
+  for (size_t len : goods_lens) {
+    makeOrderRequest request;
+    request.set_price(100);
+    request.set_goods(std::string(len, 'g'));
+    std::string pb_data;
+    request.SerializeToString(&pb_data);
+
+    std::cout << "goods: " << len << " bytes\n";
+    runHeap(pb_data);
+    runArena(pb_data);
+  }
+  return 0;
+}
@@ -63,16 +63,16 @@ asio::awaitable<void> test_tcp_client() {
 
   std::shared_ptr<rocket::TinyPBProtocol> message =
       std::make_shared<rocket::TinyPBProtocol>();
-  message->msg_id_ = "123456789";
+  message->req_id_ = 123456789;
   message->pb_data_ = "test pb data";
   client.writeMessage(message, [](rocket::AbstractProtocol::s_ptr msg_ptr) {
     DEBUGLOG("send message success");
   });
 
-  client.readMessage("123456789", [](rocket::AbstractProtocol::s_ptr msg_ptr) {
+  client.readMessage(123456789, [](rocket::AbstractProtocol::s_ptr msg_ptr) {
     std::shared_ptr<rocket::TinyPBProtocol> message =
         std::dynamic_pointer_cast<rocket::TinyPBProtocol>(msg_ptr);
-    DEBUGLOG("msg_id[%s], get response %s", message->msg_id_.c_str(),
+    DEBUGLOG("req_id[%lu], get response %s", message->req_id_,
              message->pb_data_.c_str());
   });
   // sleep 10 s
@@ -0,0 +1,109 @@
+#include <algorithm>
+#include <ctime>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+#include "rocket/common/config.h"
+#include "rocket/logger/log.h"
+#include "rocket/net/coder/compressor.h"
+#include "rocket/net/coder/tinypb_coder.h"
+#include "proto/order.pb.h"
+
+// 测量各压缩算法在订单响应上的压缩率和每 MB 的 CPU 耗时
+// 负载为 n 个 makeOrderResponse 组成的批量响应，与 RpcBatch 返回的 pb_data 相同
+
+int g_total_mb = 64;   // 每种负载每个算法处理的数据量
+
+static std::string makePayload(int count) {
+  std::vector<std::shared_ptr<rocket::TinyPBProtocol>> calls;
+  for (int i = 0; i < count; ++i) {
+    makeOrderResponse response;
+    response.set_ret_code(0);
+    response.set_res_info("OK");
+    response.set_order_id("20240101" + std::to_string(100000 + i * 7));
+
+    std::shared_ptr<rocket::TinyPBProtocol> call = std::make_shared<rocket::TinyPBProtocol>();
+    call->req_id_ = 123456789 + i;
+    response.SerializeToString(&(call->pb_data_));
+    calls.push_back(call);
+  }
+  std::string payload;
+  rocket::TinyPBCoder::encodeBatch(calls, payload);
+  return payload;
+}
+
+static double cpuMs(std::clock_t begin, std::clock_t end) {
+  return 1000.0 * (end - begin) / CLOCKS_PER_SEC;
+}
+
+static void runCodec(const rocket::Compressor *compressor, const std::string &payload) {
+  int iterations = std::max<int>(1, (int64_t)g_total_mb * 1024 * 1024 / payload.length());
+  double total_mb = (double)payload.length() * iterations / (1024 * 1024);
+
+  std::vector<char> compressed(compressor->maxCompressedLength(payload.length()));
+  size_t compressed_len = 0;
+  std::clock_t begin = std::clock();
+  for (int i = 0; i < iterations; ++i) {
+    compressor->compress(payload.data(), payload.length(), compressed.data(), compressed_len);
+  }
+  double compress_ms = cpuMs(begin, std::clock());
+
+  std::string decompressed(payload.length(), '\0');
+  bool ok = true;
+  begin = std::clock();
+  for (int i = 0; i < iterations; ++i) {
+    ok = compressor->decompress(compressed.data(), compressed_len, &decompressed[0], payload.length()) && ok;
+  }
+  double decompress_ms = cpuMs(begin, std::clock());
+  ok = ok && decompressed == payload;
+
+  std::cout << std::left << std::setw(6) << compressor->name() << std::fixed << std::setprecision(3)
+            << "ratio: " << (double)payload.length() / compressed_len << ", "
+            << "compress: " << compress_ms / total_mb << " ms/MB, "
+            << "decompress: " << decompress_ms / total_mb << " ms/MB"
+            << (ok ? "" : ", ROUND TRIP FAILED") << "\n";
+}
+
+void printUsage(const char *program) {
+  std::cout << "Usage: " << program << " [-m <MB per codec>]\n";
+  std::cout << "Example: " << program << " -m 64\n";
+}
+
+int main(int argc, char *argv[]) {
+  for (int i = 1; i < argc; i += 2) {
+    if (i + 1 >= argc) {
+      printUsage(argv[0]);
+      return 1;
+    }
+    std::string arg = argv[i];
+    if (arg == "-m") {
+      g_total_mb = std::max(1, std::atoi(argv[i + 1]));
+    } else {
+      printUsage(argv[0]);
+      return 1;
+    }
+  }
+
+  rocket::Config::SetGlobalConfig("../conf/rocket_client.xml");
+  rocket::Logger::InitGlobalLogger(0);
+
+  rocket::CompressorRegistry *registry = rocket::CompressorRegistry::GetInstance();
+  std::vector<const rocket::Compressor *> compressors;
+  for (uint8_t type = 1; type < 8; ++type) {
+    if (registry->get(type)) {
+      compressors.push_back(registry->get(type));
+    }
+  }
+
+  int counts[] = {1, 32, 1024, 16384};
+  for (int count : counts) {
+    std::string payload = makePayload(count);
+    std::cout << "responses: " << count << ", payload: " << payload.length() << " bytes\n";
+    for (const rocket::Compressor *compressor : compressors) {
+      runCodec(compressor, payload);
+    }
+  }
+  return 0;
+}
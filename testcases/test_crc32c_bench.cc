@@ -0,0 +1,71 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+#include "rocket/common/crc32c.h"
+
+// 测量 CRC32C 校验和的吞吐，对比硬件指令和查表实现
+
+int64_t g_total_mb = 1024;   // 每种长度处理的数据量
+
+typedef uint32_t (*Crc32cFunc)(const char *, size_t);
+
+static double measure(Crc32cFunc func, const std::string &data, uint32_t &result) {
+  int64_t iterations = std::max<int64_t>(1, g_total_mb * 1024 * 1024 / data.length());
+  uint32_t crc = 0;
+  auto begin = std::chrono::steady_clock::now();
+  for (int64_t i = 0; i < iterations; ++i) {
+    crc ^= func(data.data(), data.length());
+  }
+  double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+  result = crc;
+  return seconds > 0 ? (double)data.length() * iterations / seconds / 1e9 : 0;
+}
+
+void printUsage(const char *program) {
+  std::cout << "Usage: " << program << " [-m <MB per size>]\n";
+  std::cout << "Example: " << program << " -m 1024\n";
+}
+
+int main(int argc, char *argv[]) {
+  for (int i = 1; i < argc; i += 2) {
+    if (i + 1 >= argc) {
+      printUsage(argv[0]);
+      return 1;
+    }
+    std::string arg = argv[i];
+    if (arg == "-m") {
+      g_total_mb = std::max(1, std::atoi(argv[i + 1]));
+    } else {
+      printUsage(argv[0]);
+      return 1;
+    }
+  }
+
+  // 标准测试向量
+  if (rocket::crc32c("123456789", 9) != 0xe3069283 || rocket::crc32cPortable("123456789", 9) != 0xe3069283) {
+    std::cout << "crc32c check value mismatch\n";
+    return 1;
+  }
+
+  std::cout << "hardware crc32c: " << (rocket::crc32cHardwareSupported() ? "yes" : "no") << "\n";
+  size_t sizes[] = {64, 1024, 16 * 1024, 1024 * 1024};
+  for (size_t size : sizes) {
+    std::string data(size, '\0');
+    for (size_t i = 0; i < size; ++i) {
+      data[i] = static_cast<char>(i * 131 + 7);
+    }
+    uint32_t hardware_crc = 0;
+    uint32_t portable_crc = 0;
+    double hardware = measure(rocket::crc32c, data, hardware_crc);
+    double portable = measure(rocket::crc32cPortable, data, portable_crc);
+    std::cout << std::left << std::setw(10) << (std::to_string(size) + "B") << std::fixed << std::setprecision(2)
+              << "crc32c: " << hardware << " GB/s, "
+              << "portable: " << portable << " GB/s"
+              << (hardware_crc == portable_crc ? "" : ", RESULT MISMATCH") << "\n";
+  }
+  return 0;
+}
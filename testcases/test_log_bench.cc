@@ -0,0 +1,81 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include "rocket/common/config.h"
+#include "rocket/logger/log.h"
+
+// 测量每行日志的耗时(ns)：会输出的日志、按运行时级别关闭的日志和按编译期级别去掉的日志
+// 日志写入线程本地缓冲区，由日志线程异步落盘，这里只统计调用方线程的耗时
+
+int64_t g_lines = 1000000;
+
+static int64_t g_evaluated = 0;
+
+// 用于确认关闭的日志不会对参数求值
+static int countEvaluated(int value) {
+  g_evaluated++;
+  return value;
+}
+
+template <typename Func>
+static double measure(Func func) {
+  auto begin = std::chrono::steady_clock::now();
+  for (int64_t i = 0; i < g_lines; ++i) {
+    func(i);
+  }
+  double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - begin).count();
+  return ns / g_lines;
+}
+
+void printUsage(const char *program) {
+  std::cout << "Usage: " << program << " <config xml> [-n <lines>]\n";
+  std::cout << "Example: " << program << " ../conf/rocket.xml -n 1000000\n";
+}
+
+int main(int argc, char *argv[]) {
+  if (argc < 2) {
+    printUsage(argv[0]);
+    return 1;
+  }
+  for (int i = 2; i < argc; i += 2) {
+    if (i + 1 >= argc) {
+      printUsage(argv[0]);
+      return 1;
+    }
+    std::string arg = argv[i];
+    if (arg == "-n") {
+      g_lines = std::max(1, std::atoi(argv[i + 1]));
+    } else {
+      printUsage(argv[0]);
+      return 1;
+    }
+  }
+
+  rocket::Config::SetGlobalConfig(argv[1]);
+  rocket::Logger::InitGlobalLogger();
+  rocket::LogLevel level = rocket::Logger::GetGlobalLogger()->getLogLevel();
+
+  std::string method = "Order.makeOrder";
+  double enabled = measure([&](int64_t i) {
+    ERRORLOG("%lu | call method[%s] failed, error code[%d]", (uint64_t)i, method.c_str(), countEvaluated(1));
+  });
+
+  int64_t evaluated = g_evaluated;
+  double disabled = measure([&](int64_t i) {
+    DEBUGLOG("%lu | call method[%s] failed, error code[%d]", (uint64_t)i, method.c_str(), countEvaluated(1));
+  });
+  bool debug_enabled = rocket::Logger::GetGlobalLogger()->isEnabled(rocket::Debug) && ROCKET_MIN_LOG_LEVEL <= 1;
+
+  std::cout << "runtime log level: " << rocket::LogLevelName(level)
+            << ", compile-time min level: " << ROCKET_MIN_LOG_LEVEL << "\n";
+  std::cout << std::fixed << std::setprecision(1)
+            << "ERRORLOG (emitted): " << enabled << " ns/line\n"
+            << "DEBUGLOG (" << (debug_enabled ? "emitted" : "disabled") << "): " << disabled << " ns/line, "
+            << "arguments evaluated " << (g_evaluated - evaluated) << " times\n";
+
+  rocket::Logger::GetGlobalLogger()->flush();
+  return 0;
+}
@@ -0,0 +1,190 @@
+#include <algorithm>
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+#include <asio/redirect_error.hpp>
+#include <asio/steady_timer.hpp>
+#include <asio/use_awaitable.hpp>
+#include "rocket/common/config.h"
+#include "rocket/logger/log.h"
+#include "rocket/net/event_loop.h"
+#include "rocket/net/rpc/etcd_registry.h"
+#include "rocket/net/rpc/rpc_batch.h"
+#include "rocket/net/rpc/rpc_channel.h"
+#include "rocket/net/rpc/rpc_closure.h"
+#include "order.rocket.h"
+#include "rpc_controller.h"
+
+// 对比三种方式完成 N 个小调用的耗时：
+// 1. 串行：逐个 co_await，每个调用一个往返
+// 2. 并发：N 个调用同时发出，全部返回后结束
+// 3. 批量：N 个调用合并为一个批量帧
+
+std::string g_addr = "Order";
+int g_batch_size = 100;
+int g_rounds = 100;
+
+struct RoundStats {
+  std::vector<int64_t> latencies_us;
+  int64_t failed_calls = 0;
+};
+
+static void fillRequest(makeOrderRequest &request, int i) {
+  request.set_price(100 + i % 100);
+  request.set_goods("item_" + std::to_string(i));
+}
+
+asio::awaitable<void> sequentialRound(RoundStats &stats) {
+  for (int i = 0; i < g_batch_size; ++i) {
+    NEWRPCCHANNEL(g_addr, channel);
+    NEWMESSAGE(makeOrderRequest, request);
+    NEWMESSAGE(makeOrderResponse, response);
+    NEWRPCCONTROLLER(controller);
+    fillRequest(*request, i);
+    controller->SetTimeout(5000);
+
+    channel->Init(controller, request, response, nullptr);
+    co_await CoOrderStub(channel.get())
+        .coMakeOrder(controller.get(), request.get(), response.get());
+    if (controller->Failed()) {
+      stats.failed_calls++;
+    }
+  }
+}
+
+asio::awaitable<void> concurrentRound(RoundStats &stats) {
+  rocket::EventLoop *event_loop = rocket::EventLoop::getThreadEventLoop();
+  asio::steady_timer timer(*event_loop->getIOContext(),
+                           std::chrono::steady_clock::time_point::max());
+  int remaining = g_batch_size;
+
+  std::vector<std::shared_ptr<rocket::RpcController>> controllers;
+  for (int i = 0; i < g_batch_size; ++i) {
+    NEWMESSAGE(makeOrderRequest, request);
+    NEWMESSAGE(makeOrderResponse, response);
+    NEWRPCCONTROLLER(controller);
+    fillRequest(*request, i);
+    controller->SetTimeout(5000);
+    controllers.push_back(controller);
+
+    // 全部返回后唤醒等待的协程
+    std::shared_ptr<rocket::RpcClosure> closure = std::make_shared<rocket::RpcClosure>(
+        nullptr, [&remaining, &timer]() {
+          if (--remaining == 0) {
+            timer.cancel();
+          }
+        });
+    CALLRPRC(g_addr, Order_Stub, makeOrder, controller, request, response, closure);
+  }
+
+  if (remaining > 0) {
+    asio::error_code ec;
+    co_await timer.async_wait(asio::redirect_error(asio::use_awaitable, ec));
+  }
+  for (auto &controller : controllers) {
+    if (controller->Failed()) {
+      stats.failed_calls++;
+    }
+  }
+}
+
+asio::awaitable<void> batchRound(RoundStats &stats) {
+  rocket::RpcBatch batch(rocket::RpcChannel::FindAddr(g_addr));
+  Order_Stub stub(&batch);
+
+  std::vector<std::shared_ptr<rocket::RpcController>> controllers;
+  std::vector<std::shared_ptr<makeOrderRequest>> requests;
+  std::vector<std::shared_ptr<makeOrderResponse>> responses;
+  for (int i = 0; i < g_batch_size; ++i) {
+    NEWMESSAGE(makeOrderRequest, request);
+    NEWMESSAGE(makeOrderResponse, response);
+    NEWRPCCONTROLLER(controller);
+    fillRequest(*request, i);
+    stub.makeOrder(controller.get(), request.get(), response.get(), nullptr);
+    controllers.push_back(controller);
+    requests.push_back(request);
+    responses.push_back(response);
+  }
+
+  NEWRPCCONTROLLER(batch_controller);
+  batch_controller->SetTimeout(5000);
+  co_await batch.commit(batch_controller);
+
+  for (auto &controller : controllers) {
+    if (controller->Failed()) {
+      stats.failed_calls++;
+    }
+  }
+}
+
+template <typename Round>
+asio::awaitable<void> runRounds(const char *name, Round round) {
+  RoundStats stats;
+  auto begin = std::chrono::steady_clock::now();
+  for (int r = 0; r < g_rounds; ++r) {
+    auto start = std::chrono::steady_clock::now();
+    co_await round(stats);
+    stats.latencies_us.push_back(std::chrono::duration_cast<std::chrono::microseconds>(
+                                     std::chrono::steady_clock::now() - start)
+                                     .count());
+  }
+  int64_t total_us = std::chrono::duration_cast<std::chrono::microseconds>(
+                         std::chrono::steady_clock::now() - begin)
+                         .count();
+
+  std::sort(stats.latencies_us.begin(), stats.latencies_us.end());
+  size_t count = stats.latencies_us.size();
+  double calls_per_sec = total_us > 0 ? 1e6 * g_rounds * g_batch_size / total_us : 0;
+  std::cout << std::left << std::setw(12) << name << std::fixed << std::setprecision(2)
+            << "round P50: " << stats.latencies_us[count * 50 / 100] / 1000.0 << " ms, "
+            << "P99: " << stats.latencies_us[count * 99 / 100] / 1000.0 << " ms, "
+            << "calls/s: " << calls_per_sec << ", "
+            << "failed calls: " << stats.failed_calls << "\n";
+}
+
+asio::awaitable<void> runBenchmark() {
+  std::cout << "batch size: " << g_batch_size << ", rounds: " << g_rounds << "\n";
+  co_await runRounds("sequential", sequentialRound);
+  co_await runRounds("concurrent", concurrentRound);
+  co_await runRounds("batch", batchRound);
+  rocket::EventLoop::getThreadEventLoop()->stop();
+}
+
+void printUsage(const char *program) {
+  std::cout << "Usage: " << program << " [-a <addr>] [-n <batch_size>] [-r <rounds>]\n";
+  std::cout << "Example: " << program << " -a 127.0.0.1:12345 -n 100 -r 100\n";
+}
+
+int main(int argc, char *argv[]) {
+  for (int i = 1; i < argc; i += 2) {
+    if (i + 1 >= argc) {
+      printUsage(argv[0]);
+      return 1;
+    }
+    std::string arg = argv[i];
+    if (arg == "-a") {
+      g_addr = argv[i + 1];
+    } else if (arg == "-n") {
+      g_batch_size = std::max(1, std::atoi(argv[i + 1]));
+    } else if (arg == "-r") {
+      g_rounds = std::max(1, std::atoi(argv[i + 1]));
+    } else {
+      printUsage(argv[0]);
+      return 1;
+    }
+  }
+
+  rocket::Config::SetGlobalConfig("../conf/rocket_client.xml");
+  rocket::Logger::InitGlobalLogger();
+  rocket::EtcdRegistry::initAsClient("127.0.0.1", 2379, "root", "123456");
+
+  rocket::EventLoop *event_loop = rocket::EventLoop::getThreadEventLoop();
+  event_loop->addCoroutine(runBenchmark);
+  event_loop->run();
+
+  rocket::EtcdRegistry::GetInstance()->stopWatcher();
+  return 0;
+}
@@ -7,11 +7,12 @@
 #include <iomanip>
 #include <memory>
 #include "rocket/common/config.h"
+#include "rocket/common/metrics.h"
 #include "rocket/logger/log.h"
 #include "rocket/net/event_loop.h"
 #include "rocket/net/rpc/etcd_registry.h"
 #include "rocket/net/rpc/rpc_channel.h"
-#include "proto/co_stub/co_order_stub.h"
+#include "order.rocket.h"
 #include "rpc_controller.h"
 
 // 线程本地统计结构
@@ -157,12 +158,11 @@ asio::awaitable<void> sendSingleRequest(int req_id) {
     request->set_goods("item_" + std::to_string(req_id));
 
     NEWRPCCONTROLLER(controller);
-    controller->SetMsgId(std::to_string(req_id));
     controller->SetTimeout(5000);
 
     channel->Init(controller, request, response, nullptr);
     co_await CoOrderStub(channel.get())
-        .coMakeOrder(controller.get(), request.get(), response.get(), nullptr);
+        .coMakeOrder(controller.get(), request.get(), response.get());
 
     if (!controller->Failed()) {
       success = true;
@@ -403,6 +403,9 @@ int main(int argc, char* argv[]) {
   // 打印统计信息
   g_stats.printStats(actual_duration > 0 ? actual_duration : 1);
 
+  std::cout << "\n========== Metrics ==========\n";
+  std::cout << rocket::MetricsRegistry::GetInstance()->dump();
+
 
 
   return 0;
@@ -4,6 +4,9 @@
 #include "rocket/net/event_loop.h"
 #include "rocket/net/rpc/etcd_registry.h"
 #include "rocket/net/rpc/rpc_channel.h"
+#include "rocket/net/rpc/rpc_fanout.h"
+#include "rocket/net/rpc/rpc_stream.h"
+#include "rocket/net/rpc/single_flight.h"
 #include <arpa/inet.h>
 #include <asio/awaitable.hpp>
 #include <fcntl.h>
@@ -15,7 +18,7 @@
 #include <sys/socket.h>
 #include <unistd.h>
 
-#include "proto/co_stub/co_order_stub.h"
+#include "order.rocket.h"
 #include "rpc_controller.h"
 
 asio::awaitable<void> test_rpc_channel() {
@@ -37,7 +40,7 @@ asio::awaitable<void> test_rpc_channel() {
 
   channel->Init(controller, request, response, nullptr);
   co_await CoOrderStub(channel.get())
-      .coMakeOrder(controller.get(), request.get(), response.get(), nullptr);
+      .coMakeOrder(controller.get(), request.get(), response.get());
   if (!controller->Failed()) {
     std::cout << "response order id: " << response->order_id()
               << " ,res info " << response->res_info() << std::endl;
@@ -47,6 +50,75 @@ asio::awaitable<void> test_rpc_channel() {
   }
 }
 
+asio::awaitable<void> test_rpc_stream() {
+  NEWRPCCONTROLLER(controller);
+  std::shared_ptr<rocket::RpcStream> stream = co_await rocket::RpcStream::Open(
+      rocket::RpcChannel::FindAddr("Order"), "Order.listOrders", controller);
+  if (!stream) {
+    std::cout << "open stream failed, error_code: " << controller->GetErrorCode()
+              << ", error_info: " << controller->GetErrorInfo() << std::endl;
+    co_return;
+  }
+
+  makeOrderRequest request;
+  request.set_price(100);
+  request.set_goods("apple");
+  co_await stream->write(request);
+  stream->writesDone();
+
+  makeOrderResponse response;
+  int count = 0;
+  while (co_await stream->read(response)) {
+    count++;
+  }
+  std::cout << "stream end, read " << count << " orders, error_code: "
+            << stream->getErrorCode() << std::endl;
+}
+
+// 扇出示例：同时向 3 个节点下单，拿到 2 个结果后取消其余调用
+asio::awaitable<void> test_rpc_fanout() {
+  std::vector<rocket::FanoutCall> calls;
+  std::vector<std::shared_ptr<makeOrderResponse>> responses;
+  for (int i = 0; i < 3; ++i) {
+    NEWMESSAGE(makeOrderRequest, request);
+    NEWMESSAGE(makeOrderResponse, response);
+    NEWRPCCONTROLLER(controller);
+    request->set_price(100);
+    request->set_goods("apple_" + std::to_string(i));
+    calls.push_back(rocket::newFanoutCall(
+        "Order", Order::descriptor()->FindMethodByName("makeOrder"),
+        controller, request, response));
+    responses.push_back(response);
+  }
+
+  rocket::FanoutResult result = co_await rocket::whenN(calls, 2, 1000);
+  std::cout << "fanout satisfied: " << result.satisfied
+            << ", succeeded: " << result.succeeded
+            << ", failed: " << result.failed
+            << ", canceled: " << result.canceled << std::endl;
+  for (size_t index : result.success_order) {
+    std::cout << "fanout response order id: " << responses[index]->order_id()
+              << std::endl;
+  }
+}
+
+// 合并示例：10 个协程同时发起相同的调用，只有一个请求发往服务端
+asio::awaitable<void> test_rpc_singleflight() {
+  NEWRPCCHANNEL("Order", channel);
+  NEWMESSAGE(makeOrderRequest, request);
+  NEWMESSAGE(makeOrderResponse, response);
+  NEWRPCCONTROLLER(controller);
+  request->set_price(100);
+  request->set_goods("banana");
+  controller->SetTimeout(1000);
+
+  channel->Init(controller, request, response, nullptr);
+  co_await CoOrderStub(channel.get())
+      .coMakeOrder(controller.get(), request.get(), response.get());
+  std::cout << "singleflight error_code: " << controller->GetErrorCode()
+            << ", order id: " << response->order_id() << std::endl;
+}
+
 int main(int argc, char *argv[]) {
 
   if (argc != 2) {
@@ -64,6 +136,12 @@ int main(int argc, char *argv[]) {
 
   rocket::EventLoop* event_loop = rocket::EventLoop::getThreadEventLoop();
   event_loop->addCoroutine(test_rpc_channel);
+  event_loop->addCoroutine(test_rpc_stream);
+  event_loop->addCoroutine(test_rpc_fanout);
+  rocket::SingleFlight::GetInstance()->enableMethod("Order.makeOrder");
+  for (int i = 0; i < 10; ++i) {
+    event_loop->addCoroutine(test_rpc_singleflight);
+  }
   event_loop->run();
 
   // 停止etcd watcher以避免gRPC断言错误
@@ -1,8 +1,10 @@
 #include "proto/order.pb.h"
+#include "order.rocket.h"
 #include "rocket/common/config.h"
 #include "rocket/logger/log.h"
 #include "rocket/net/rpc/etcd_registry.h"
 #include "rocket/net/rpc/rpc_dispatcher.h"
+#include "rocket/net/rpc/rpc_stream.h"
 #include "rocket/net/tcp/tcp_server.h"
 #include <arpa/inet.h>
 #include <asio/ip/address.hpp>
@@ -15,26 +17,37 @@
 #include <sys/socket.h>
 #include <unistd.h>
 
-class OrderImpl : public Order {
+// 由 protoc-gen-rocket 生成的协程服务端基类，方法中可以 co_await 下游调用或定时器，不阻塞 IO 线程，返回时自动回包
+class OrderImpl : public CoOrderService {
 public:
-  void makeOrder(google::protobuf::RpcController *controller,
-                 const ::makeOrderRequest *request,
-                 ::makeOrderResponse *response,
-                 ::google::protobuf::Closure *done) {
+  asio::awaitable<void> coMakeOrder(rocket::RpcController *controller,
+                                    const ::makeOrderRequest *request,
+                                    ::makeOrderResponse *response) override {
     if (request->price() < 10) {
       response->set_ret_code(-1);
       response->set_res_info("short balance");
-      return;
+      co_return;
     }
     response->set_order_id("20230514");
-    if (done) {
-      done->Run();
-      delete done;
-      done = NULL;
-    }
   }
 };
 
+// 服务端流示例：读取一个请求，按 price 返回多条订单
+asio::awaitable<void> listOrders(std::shared_ptr<rocket::RpcStream> stream) {
+  makeOrderRequest request;
+  if (!co_await stream->read(request)) {
+    co_return;
+  }
+  for (int i = 0; i < request.price(); ++i) {
+    makeOrderResponse response;
+    response.set_order_id(request.goods() + "_" + std::to_string(i));
+    if (!co_await stream->write(response)) {
+      co_return;
+    }
+  }
+  stream->finish();
+}
+
 int main(int argc, char *argv[]) {
 
   if (argc != 2) {
@@ -52,8 +65,9 @@ int main(int argc, char *argv[]) {
   rocket::EtcdRegistry::initAsServerFromConfig();
 
   std::shared_ptr<OrderImpl> service = std::make_shared<OrderImpl>();
-  // 注册服务实现到RPC分发器
-  rocket::RpcDispatcher::GetRpcDispatcher()->registerService(service);
+  // 注册服务实现到RPC分发器，所有方法以协程执行
+  CoOrderService::Register(service);
+  rocket::RpcDispatcher::GetRpcDispatcher()->registerStreamMethod("Order.listOrders", listOrders);
 
   asio::ip::address addr = asio::ip::address::from_string("192.168.124.128");
   asio::ip::tcp::endpoint endpoint =
@@ -0,0 +1,269 @@
+/**
+ * protoc 插件，为 .proto 中的每个 service 生成协程客户端 stub 和协程服务端基类
+ *
+ *   protoc --plugin=protoc-gen-rocket=./protoc-gen-rocket --cpp_out=. --rocket_out=. order.proto
+ *
+ * 对 order.proto 生成 order.rocket.h / order.rocket.cc：
+ *   CoOrderStub     每个 rpc 一个 co<Method>(controller, request, response)，返回 asio::awaitable<void>
+ *   CoOrderService  继承 protobuf 生成的 Order，每个 rpc 一个纯虚的协程方法，Register 时注册为协程方法
+ * 需要 option cc_generic_services = true。
+ */
+#include <google/protobuf/compiler/code_generator.h>
+#include <google/protobuf/compiler/plugin.h>
+#include <google/protobuf/descriptor.h>
+#include <google/protobuf/io/printer.h>
+#include <google/protobuf/io/zero_copy_stream.h>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+using google::protobuf::Descriptor;
+using google::protobuf::FileDescriptor;
+using google::protobuf::MethodDescriptor;
+using google::protobuf::ServiceDescriptor;
+using google::protobuf::compiler::CodeGenerator;
+using google::protobuf::compiler::GeneratorContext;
+using google::protobuf::io::Printer;
+using google::protobuf::io::ZeroCopyOutputStream;
+
+namespace {
+
+std::string stripProto(const std::string& filename) {
+  const std::string suffix = ".proto";
+  if (filename.size() >= suffix.size() &&
+      filename.compare(filename.size() - suffix.size(), suffix.size(), suffix) == 0) {
+    return filename.substr(0, filename.size() - suffix.size());
+  }
+  return filename;
+}
+
+std::vector<std::string> splitPackage(const std::string& package) {
+  std::vector<std::string> parts;
+  size_t start = 0;
+  while (start < package.size()) {
+    size_t end = package.find('.', start);
+    if (end == std::string::npos) {
+      end = package.size();
+    }
+    parts.push_back(package.substr(start, end - start));
+    start = end + 1;
+  }
+  return parts;
+}
+
+// 与 protoc 的 C++ 生成器一致：包名转为命名空间，嵌套消息用 '_' 连接
+std::string className(const Descriptor* descriptor) {
+  std::string name = descriptor->name();
+  for (const Descriptor* parent = descriptor->containing_type(); parent; parent = parent->containing_type()) {
+    name = parent->name() + "_" + name;
+  }
+  std::string ns = "::";
+  for (const std::string& part : splitPackage(descriptor->file()->package())) {
+    ns += part + "::";
+  }
+  return ns + name;
+}
+
+// makeOrder -> coMakeOrder
+std::string coMethodName(const MethodDescriptor* method) {
+  std::string name = method->name();
+  if (!name.empty() && name[0] >= 'a' && name[0] <= 'z') {
+    name[0] = name[0] - 'a' + 'A';
+  }
+  return "co" + name;
+}
+
+std::string headerGuard(const std::string& filename) {
+  std::string guard = "ROCKET_GEN_";
+  for (char c : filename) {
+    if ((c >= 'a' && c <= 'z')) {
+      guard += static_cast<char>(c - 'a' + 'A');
+    } else if ((c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9')) {
+      guard += c;
+    } else {
+      guard += '_';
+    }
+  }
+  return guard;
+}
+
+std::map<std::string, std::string> methodVars(const MethodDescriptor* method, int index) {
+  std::map<std::string, std::string> vars;
+  vars["service"] = method->service()->name();
+  vars["method"] = method->name();
+  vars["co_method"] = coMethodName(method);
+  vars["request"] = className(method->input_type());
+  vars["response"] = className(method->output_type());
+  vars["index"] = std::to_string(index);
+  return vars;
+}
+
+void openNamespace(Printer& printer, const FileDescriptor* file) {
+  for (const std::string& part : splitPackage(file->package())) {
+    printer.Print("namespace $ns$ {\n", "ns", part);
+  }
+  if (!file->package().empty()) {
+    printer.Print("\n");
+  }
+}
+
+void closeNamespace(Printer& printer, const FileDescriptor* file) {
+  std::vector<std::string> parts = splitPackage(file->package());
+  for (auto it = parts.rbegin(); it != parts.rend(); ++it) {
+    printer.Print("}  // namespace $ns$\n", "ns", *it);
+  }
+  if (!parts.empty()) {
+    printer.Print("\n");
+  }
+}
+
+void printHeader(Printer& printer, const FileDescriptor* file, const std::string& base) {
+  std::string guard = headerGuard(base + ".rocket.h");
+  printer.Print(
+      "// Generated by protoc-gen-rocket. DO NOT EDIT!\n"
+      "// source: $source$\n"
+      "\n"
+      "#ifndef $guard$\n"
+      "#define $guard$\n"
+      "\n"
+      "#include <memory>\n"
+      "#include <asio/awaitable.hpp>\n"
+      "#include \"$base$.pb.h\"\n"
+      "#include \"rocket/net/rpc/rpc_controller.h\"\n"
+      "\n",
+      "source", file->name(), "guard", guard, "base", base);
+  openNamespace(printer, file);
+
+  for (int i = 0; i < file->service_count(); ++i) {
+    const ServiceDescriptor* service = file->service(i);
+    printer.Print(
+        "// $service$ 的协程客户端，channel 需要先 Init，结果记录在 controller 和 response 中\n"
+        "class Co$service$Stub {\n"
+        " public:\n"
+        "  explicit Co$service$Stub(::google::protobuf::RpcChannel* channel) : channel_(channel) {}\n"
+        "\n",
+        "service", service->name());
+    printer.Indent();
+    for (int j = 0; j < service->method_count(); ++j) {
+      printer.Print(methodVars(service->method(j), j),
+          "asio::awaitable<void> $co_method$(::rocket::RpcController* controller,\n"
+          "    const $request$* request, $response$* response);\n"
+          "\n");
+    }
+    printer.Outdent();
+    printer.Print(
+        " private:\n"
+        "  ::google::protobuf::RpcChannel* channel_;\n"
+        "};\n"
+        "\n");
+
+    printer.Print(
+        "// $service$ 的协程服务端基类，方法返回时自动回包\n"
+        "class Co$service$Service : public $service$ {\n"
+        " public:\n",
+        "service", service->name());
+    printer.Indent();
+    for (int j = 0; j < service->method_count(); ++j) {
+      printer.Print(methodVars(service->method(j), j),
+          "virtual asio::awaitable<void> $co_method$(::rocket::RpcController* controller,\n"
+          "    const $request$* request, $response$* response) = 0;\n"
+          "\n");
+    }
+    printer.Print(
+        "// 注册到 RpcDispatcher，所有方法注册为协程方法\n"
+        "static bool Register(std::shared_ptr<Co$service$Service> service);\n",
+        "service", service->name());
+    printer.Outdent();
+    printer.Print("};\n\n");
+  }
+
+  closeNamespace(printer, file);
+  printer.Print("#endif  // $guard$\n", "guard", guard);
+}
+
+void printSource(Printer& printer, const FileDescriptor* file, const std::string& base) {
+  std::string header = base + ".rocket.h";
+  printer.Print(
+      "// Generated by protoc-gen-rocket. DO NOT EDIT!\n"
+      "// source: $source$\n"
+      "\n"
+      "#include \"$header$\"\n"
+      "#include \"rocket/net/rpc/co_call.h\"\n"
+      "#include \"rocket/net/rpc/rpc_dispatcher.h\"\n"
+      "\n",
+      "source", file->name(), "header", header);
+  openNamespace(printer, file);
+
+  for (int i = 0; i < file->service_count(); ++i) {
+    const ServiceDescriptor* service = file->service(i);
+    for (int j = 0; j < service->method_count(); ++j) {
+      printer.Print(methodVars(service->method(j), j),
+          "asio::awaitable<void> Co$service$Stub::$co_method$(::rocket::RpcController* controller,\n"
+          "    const $request$* request, $response$* response) {\n"
+          "  return ::rocket::asyncCallMethod(channel_, $service$::descriptor()->method($index$),\n"
+          "      controller, request, response);\n"
+          "}\n"
+          "\n");
+    }
+
+    printer.Print(
+        "bool Co$service$Service::Register(std::shared_ptr<Co$service$Service> service) {\n"
+        "  ::rocket::RpcDispatcher* dispatcher = ::rocket::RpcDispatcher::GetRpcDispatcher();\n"
+        "  dispatcher->registerService(service);\n"
+        "  bool ok = true;\n",
+        "service", service->name());
+    printer.Indent();
+    for (int j = 0; j < service->method_count(); ++j) {
+      printer.Print(methodVars(service->method(j), j),
+          "ok = dispatcher->registerCoroutineMethod(\n"
+          "    $service$::descriptor()->method($index$)->full_name(),\n"
+          "    [service](::rocket::RpcController* controller, const ::google::protobuf::Message* request,\n"
+          "        ::google::protobuf::Message* response) {\n"
+          "      return service->$co_method$(controller, static_cast<const $request$*>(request),\n"
+          "          static_cast<$response$*>(response));\n"
+          "    }) && ok;\n");
+    }
+    printer.Outdent();
+    printer.Print(
+        "  return ok;\n"
+        "}\n"
+        "\n");
+  }
+
+  closeNamespace(printer, file);
+}
+
+class RocketGenerator : public CodeGenerator {
+ public:
+  bool Generate(const FileDescriptor* file, const std::string& parameter,
+                GeneratorContext* context, std::string* error) const override {
+    if (file->service_count() == 0) {
+      return true;
+    }
+    if (!file->options().cc_generic_services()) {
+      *error = file->name() + ": protoc-gen-rocket requires option cc_generic_services = true";
+      return false;
+    }
+
+    std::string base = stripProto(file->name());
+    {
+      std::unique_ptr<ZeroCopyOutputStream> output(context->Open(base + ".rocket.h"));
+      Printer printer(output.get(), '$');
+      printHeader(printer, file, base);
+    }
+    {
+      std::unique_ptr<ZeroCopyOutputStream> output(context->Open(base + ".rocket.cc"));
+      Printer printer(output.get(), '$');
+      printSource(printer, file, base);
+    }
+    return true;
+  }
+};
+
+}
+
+int main(int argc, char* argv[]) {
+  RocketGenerator generator;
+  return google::protobuf::compiler::PluginMain(argc, argv, &generator);
+}